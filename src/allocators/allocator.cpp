@@ -41,6 +41,9 @@
 #include "selalloc.hpp"
 #include "separable_input_first.hpp"
 #include "separable_output_first.hpp"
+#include "islip_bitmask.hpp"
+#include "wavefront_bitmask.hpp"
+#include "separable_bitmask.hpp"
 //
 /////////////////////////////////////////////////////////////////////////
 
@@ -469,6 +472,21 @@ Allocator *Allocator::NewAllocator( Module *parent, const string& name,
     string arb_type = param_str.empty() ? (config ? config->GetStr("arb_type") : "round_robin") : param_str;
     a = new SeparableOutputFirstAllocator( parent, name, inputs, outputs,
 					   arb_type );
+  } else if ( alloc_name == "islip_bitmask" ) {
+    int iters = param_str.empty() ? (config ? config->GetInt("alloc_iters") : 1) : atoi(param_str.c_str());
+    a = new iSLIP_Bitmask( parent, name, inputs, outputs, iters );
+  } else if ( alloc_name == "wavefront_bitmask" ) {
+    a = new Wavefront_Bitmask( parent, name, inputs, outputs );
+  } else if ( alloc_name == "rr_wavefront_bitmask" ) {
+    a = new Wavefront_Bitmask( parent, name, inputs, outputs, true );
+  } else if (alloc_name == "separable_input_first_bitmask") {
+    string arb_type = param_str.empty() ? (config ? config->GetStr("arb_type") : "round_robin") : param_str;
+    a = new SeparableInputFirstBitmaskAllocator( parent, name, inputs, outputs,
+						 arb_type );
+  } else if (alloc_name == "separable_output_first_bitmask") {
+    string arb_type = param_str.empty() ? (config ? config->GetStr("arb_type") : "round_robin") : param_str;
+    a = new SeparableOutputFirstBitmaskAllocator( parent, name, inputs, outputs,
+						  arb_type );
   }
 
 //==================================================
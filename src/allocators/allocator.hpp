@@ -35,6 +35,7 @@
 
 #include "module.hpp"
 #include "config_utils.hpp"
+#include "checkpoint.hpp"
 
 class Allocator : public Module {
 protected:
@@ -81,6 +82,10 @@ public:
   virtual void PrintRequests( ostream * os = NULL ) const = 0;
   void PrintGrants( ostream * os = NULL ) const;
 
+  // requests and grants only live for a single cycle; allocators that 
+  // carry state (e.g. round-robin pointers) across cycles save it here
+  virtual void Serialize( Checkpoint & cp ) { }
+
   static Allocator *NewAllocator( Module *parent, const string& name,
 				  const string &alloc_type, 
 				  int inputs, int outputs, 
@@ -0,0 +1,251 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// ----------------------------------------------------------------------
+//
+//  BitmaskAllocator: Allocator Base Class with Packed Request Matrices
+//
+// ----------------------------------------------------------------------
+
+#include "booksim.hpp"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+#include "bitmask_allocator.hpp"
+
+BitmaskAllocator::BitmaskAllocator( Module *parent, const string& name,
+				    int inputs, int outputs ) :
+  Allocator( parent, name, inputs, outputs )
+{
+  _in_words  = ( _inputs + WORD_BITS - 1 ) / WORD_BITS;
+  _out_words = ( _outputs + WORD_BITS - 1 ) / WORD_BITS;
+
+  _request.resize( _inputs * _outputs );
+
+  _in_req.resize( _inputs * _out_words, 0 );
+  _out_req.resize( _outputs * _in_words, 0 );
+
+  _in_occ.resize( _in_words, 0 );
+  _out_occ.resize( _out_words, 0 );
+}
+
+void BitmaskAllocator::Clear( )
+{
+  // only the rows and columns of ports with requests can be non-zero
+  for ( int w = 0; w < _in_words; ++w ) {
+    for ( tWord occ = _in_occ[w]; occ; occ &= occ - 1 ) {
+      int const in = w * WORD_BITS + _FirstBit( occ );
+      for ( int i = 0; i < _out_words; ++i ) {
+	_in_req[in * _out_words + i] = 0;
+      }
+    }
+    _in_occ[w] = 0;
+  }
+  for ( int w = 0; w < _out_words; ++w ) {
+    for ( tWord occ = _out_occ[w]; occ; occ &= occ - 1 ) {
+      int const out = w * WORD_BITS + _FirstBit( occ );
+      for ( int i = 0; i < _in_words; ++i ) {
+	_out_req[out * _in_words + i] = 0;
+      }
+    }
+    _out_occ[w] = 0;
+  }
+  _priorities.clear( );
+  Allocator::Clear( );
+}
+
+int BitmaskAllocator::_RoundRobin( tWord const * bits, tWord const * exclude,
+				   int words, int start )
+{
+  // scan from the word holding the pointer to the end and wrap around,
+  // visiting the bits below the pointer in its own word last
+  int const start_word = start / WORD_BITS;
+  tWord const above = ~0ULL << ( start % WORD_BITS );
+  for ( int i = 0; i <= words; ++i ) {
+    int const w = ( start_word + i ) % words;
+    tWord candidates = exclude ? ( bits[w] & ~exclude[w] ) : bits[w];
+    if ( i == 0 ) {
+      candidates &= above;
+    } else if ( i == words ) {
+      candidates &= ~above;
+    }
+    if ( candidates ) {
+      return w * WORD_BITS + _FirstBit( candidates );
+    }
+  }
+  return -1;
+}
+
+int BitmaskAllocator::ReadRequest( int in, int out ) const
+{
+  assert( ( in >= 0 ) && ( in < _inputs ) );
+  assert( ( out >= 0 ) && ( out < _outputs ) );
+
+  if ( !_TestBit( _InputRow( in ), out ) ) {
+    return -1;
+  }
+  return _request[in * _outputs + out].label;
+}
+
+bool BitmaskAllocator::ReadRequest( sRequest &req, int in, int out ) const
+{
+  assert( ( in >= 0 ) && ( in < _inputs ) );
+  assert( ( out >= 0 ) && ( out < _outputs ) );
+
+  if ( !_TestBit( _InputRow( in ), out ) ) {
+    return false;
+  }
+  req = _request[in * _outputs + out];
+  return true;
+}
+
+void BitmaskAllocator::AddRequest( int in, int out, int label, 
+				   int in_pri, int out_pri )
+{
+  Allocator::AddRequest( in, out, label, in_pri, out_pri );
+  assert( !_TestBit( _InputRow( in ), out ) );
+
+  sRequest & req = _request[in * _outputs + out];
+  req.port    = out;
+  req.label   = label;
+  req.in_pri  = in_pri;
+  req.out_pri = out_pri;
+
+  _SetBit( &_in_req[in * _out_words], out );
+  _SetBit( &_out_req[out * _in_words], in );
+  _SetBit( &_in_occ[0], in );
+  _SetBit( &_out_occ[0], out );
+
+  pair<int, int> const pri( out_pri, in_pri );
+  bool found = false;
+  for ( size_t i = 0; i < _priorities.size( ); ++i ) {
+    if ( _priorities[i] == pri ) {
+      found = true;
+      break;
+    }
+  }
+  if ( !found ) {
+    _priorities.push_back( pri );
+  }
+}
+
+void BitmaskAllocator::RemoveRequest( int in, int out, int label )
+{
+  assert( ( in >= 0 ) && ( in < _inputs ) );
+  assert( ( out >= 0 ) && ( out < _outputs ) ); 
+  assert( _TestBit( _InputRow( in ), out ) );
+  assert( _request[in * _outputs + out].label == label );
+
+  _ClearBit( &_in_req[in * _out_words], out );
+  _ClearBit( &_out_req[out * _in_words], in );
+
+  if ( !InputHasRequests( in ) ) {
+    _ClearBit( &_in_occ[0], in );
+  }
+  if ( !OutputHasRequests( out ) ) {
+    _ClearBit( &_out_occ[0], out );
+  }
+}
+
+bool BitmaskAllocator::InputHasRequests( int in ) const
+{
+  tWord const * const row = _InputRow( in );
+  for ( int w = 0; w < _out_words; ++w ) {
+    if ( row[w] ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BitmaskAllocator::OutputHasRequests( int out ) const
+{
+  tWord const * const column = _OutputColumn( out );
+  for ( int w = 0; w < _in_words; ++w ) {
+    if ( column[w] ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int BitmaskAllocator::NumInputRequests( int in ) const
+{
+  tWord const * const row = _InputRow( in );
+  int result = 0;
+  for ( int w = 0; w < _out_words; ++w ) {
+    result += __builtin_popcountll( row[w] );
+  }
+  return result;
+}
+
+int BitmaskAllocator::NumOutputRequests( int out ) const
+{
+  tWord const * const column = _OutputColumn( out );
+  int result = 0;
+  for ( int w = 0; w < _in_words; ++w ) {
+    result += __builtin_popcountll( column[w] );
+  }
+  return result;
+}
+
+void BitmaskAllocator::PrintRequests( ostream * os ) const
+{
+  if(!os) os = &cout;
+
+  *os << "Input requests = [ ";
+  for ( int input = 0; input < _inputs; ++input ) {
+    bool print = false;
+    ostringstream ss;
+    for ( int output = 0; output < _outputs; ++output ) {
+      if ( _TestBit( _InputRow( input ), output ) ) {
+	print = true;
+	ss << output << "@" << _request[input * _outputs + output].in_pri << " ";
+      }
+    }
+    if(print) {
+      *os << input << " -> [ " << ss.str() << "]  ";
+    }
+  }
+  *os << "], output requests = [ ";
+  for ( int output = 0; output < _outputs; ++output ) {
+    bool print = false;
+    ostringstream ss;
+    for ( int input = 0; input < _inputs; ++input ) {
+      if ( _TestBit( _OutputColumn( output ), input ) ) {
+	print = true;
+	ss << input << "@" << _request[input * _outputs + output].out_pri << " ";
+      }
+    }
+    if(print) {
+      *os << output << " -> [ " << ss.str() << "]  ";
+    }
+  }
+  *os << "]." << endl;
+}
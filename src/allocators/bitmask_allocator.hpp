@@ -0,0 +1,117 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// ----------------------------------------------------------------------
+//
+//  BitmaskAllocator: Allocator Base Class with Packed Request Matrices
+//
+//  Requests are kept both as rows (one bit per output for each input)
+//  and as columns (one bit per input for each output), packed into
+//  64-bit words, so that round-robin arbitration reduces to masking
+//  off the bits below the pointer and counting trailing zeros.
+//
+// ----------------------------------------------------------------------
+
+#ifndef _BITMASK_ALLOCATOR_HPP_
+#define _BITMASK_ALLOCATOR_HPP_
+
+#include <vector>
+
+#include "allocator.hpp"
+
+class BitmaskAllocator : public Allocator {
+
+protected:
+
+  typedef unsigned long long tWord;
+
+  static int const WORD_BITS = 64;
+
+  // number of words in a column (over inputs) and in a row (over outputs)
+  int _in_words;
+  int _out_words;
+
+  vector<sRequest> _request;
+
+  vector<tWord> _in_req;
+  vector<tWord> _out_req;
+
+  vector<tWord> _in_occ;
+  vector<tWord> _out_occ;
+
+  // distinct (out_pri, in_pri) pairs among the current requests
+  vector<pair<int, int> > _priorities;
+
+  inline tWord const * _InputRow( int in ) const {
+    return &_in_req[in * _out_words];
+  }
+  inline tWord const * _OutputColumn( int out ) const {
+    return &_out_req[out * _in_words];
+  }
+
+  static inline bool _TestBit( tWord const * bits, int i ) {
+    return ( bits[i / WORD_BITS] >> ( i % WORD_BITS ) ) & 1;
+  }
+  static inline void _SetBit( tWord * bits, int i ) {
+    bits[i / WORD_BITS] |= ( 1ULL << ( i % WORD_BITS ) );
+  }
+  static inline void _ClearBit( tWord * bits, int i ) {
+    bits[i / WORD_BITS] &= ~( 1ULL << ( i % WORD_BITS ) );
+  }
+  static inline int _FirstBit( tWord bits ) {
+    return __builtin_ctzll( bits );
+  }
+
+  static int _RoundRobin( tWord const * bits, tWord const * exclude,
+			  int words, int start );
+
+public:
+
+  BitmaskAllocator( Module *parent, const string& name,
+		    int inputs, int outputs );
+
+  void Clear( );
+  
+  int  ReadRequest( int in, int out ) const;
+  bool ReadRequest( sRequest &req, int in, int out ) const;
+
+  void AddRequest( int in, int out, int label = 1, 
+		   int in_pri = 0, int out_pri = 0 );
+  void RemoveRequest( int in, int out, int label = 1 );
+
+  bool OutputHasRequests( int out ) const;
+  bool InputHasRequests( int in ) const;
+
+  int NumOutputRequests( int out ) const;
+  int NumInputRequests( int in ) const;
+
+  void PrintRequests( ostream * os = NULL ) const;
+
+};
+
+#endif
@@ -181,3 +181,9 @@ void iSLIP_Sparse::Allocate( )
   cout << endl;
 #endif
 }
+
+void iSLIP_Sparse::Serialize( Checkpoint & cp )
+{
+  cp.Item( _gptrs );
+  cp.Item( _aptrs );
+}
@@ -32,7 +32,7 @@
 
 #include "allocator.hpp"
 
-class iSLIP_Sparse : public SparseAllocator {
+class iSLIP_Sparse final : public SparseAllocator {
   int _iSLIP_iter;
 
   vector<int> _gptrs;
@@ -43,6 +43,8 @@ public:
 		int inputs, int outputs, int iters );
 
   void Allocate( );
+
+  virtual void Serialize( Checkpoint & cp );
 };
 
 #endif 
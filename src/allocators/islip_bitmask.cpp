@@ -0,0 +1,119 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// ----------------------------------------------------------------------
+//
+//  iSLIP_Bitmask: iSLIP Allocator on Packed Request Matrices
+//
+// ----------------------------------------------------------------------
+
+#include "booksim.hpp"
+
+#include "islip_bitmask.hpp"
+
+iSLIP_Bitmask::iSLIP_Bitmask( Module *parent, const string& name,
+			      int inputs, int outputs, int iters ) :
+  BitmaskAllocator( parent, name, inputs, outputs ),
+  _iSLIP_iter(iters)
+{
+  _gptrs.resize(_outputs, 0);
+  _aptrs.resize(_inputs, 0);
+
+  _in_matched.resize(_in_words, 0);
+  _out_matched.resize(_out_words, 0);
+  _grants.resize(_inputs * _out_words, 0);
+  _granted.resize(_in_words, 0);
+}
+
+void iSLIP_Bitmask::Allocate( )
+{
+  _in_matched.assign(_in_words, 0);
+  _out_matched.assign(_out_words, 0);
+
+  for ( int iter = 0; iter < _iSLIP_iter; ++iter ) {
+
+    // Grant phase: each unmatched output picks the first unmatched
+    // requesting input at or after its grant pointer
+
+    for ( int w = 0; w < _out_words; ++w ) {
+      for ( tWord outputs = _out_occ[w] & ~_out_matched[w]; outputs;
+	    outputs &= outputs - 1 ) {
+	int const output = w * WORD_BITS + _FirstBit( outputs );
+	int const input = _RoundRobin( _OutputColumn( output ), &_in_matched[0],
+				       _in_words, _gptrs[output] );
+	if ( input >= 0 ) {
+	  _SetBit( &_grants[input * _out_words], output );
+	  _SetBit( &_granted[0], input );
+	}
+      }
+    }
+
+    // Accept phase: each input that received grants accepts the first
+    // one at or after its accept pointer
+
+    bool matched = false;
+
+    for ( int w = 0; w < _in_words; ++w ) {
+      for ( tWord inputs = _granted[w]; inputs; inputs &= inputs - 1 ) {
+	int const input = w * WORD_BITS + _FirstBit( inputs );
+	tWord * const grants = &_grants[input * _out_words];
+	int const output = _RoundRobin( grants, NULL, _out_words,
+					_aptrs[input] );
+	assert( output >= 0 );
+
+	_inmatch[input]   = output;
+	_outmatch[output] = input;
+	_SetBit( &_in_matched[0], input );
+	_SetBit( &_out_matched[0], output );
+	matched = true;
+
+	// Only update pointers if accepted during the 1st iteration
+	if ( iter == 0 ) {
+	  _gptrs[output] = ( input + 1 ) % _inputs;
+	  _aptrs[input]  = ( output + 1 ) % _outputs;
+	}
+
+	for ( int i = 0; i < _out_words; ++i ) {
+	  grants[i] = 0;
+	}
+      }
+      _granted[w] = 0;
+    }
+
+    // later iterations cannot find anything new either
+    if ( !matched ) {
+      break;
+    }
+  }
+}
+
+void iSLIP_Bitmask::Serialize( Checkpoint & cp )
+{
+  cp.Item( _gptrs );
+  cp.Item( _aptrs );
+}
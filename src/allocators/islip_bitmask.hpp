@@ -0,0 +1,66 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// ----------------------------------------------------------------------
+//
+//  iSLIP_Bitmask: iSLIP Allocator on Packed Request Matrices
+//
+//  Makes the same grants as iSLIP_Sparse.
+//
+// ----------------------------------------------------------------------
+
+#ifndef _ISLIP_BITMASK_HPP_
+#define _ISLIP_BITMASK_HPP_
+
+#include <vector>
+
+#include "bitmask_allocator.hpp"
+
+class iSLIP_Bitmask : public BitmaskAllocator {
+  int _iSLIP_iter;
+
+  vector<int> _gptrs;
+  vector<int> _aptrs;
+
+  // per-iteration state: ports matched so far, the grants each input
+  // received (as a row) and the inputs that received any
+  vector<tWord> _in_matched;
+  vector<tWord> _out_matched;
+  vector<tWord> _grants;
+  vector<tWord> _granted;
+
+public:
+  iSLIP_Bitmask( Module *parent, const string& name,
+		 int inputs, int outputs, int iters );
+
+  void Allocate( );
+
+  virtual void Serialize( Checkpoint & cp );
+};
+
+#endif 
@@ -109,4 +109,8 @@ void LOA::Allocate( )
 
 }
 
-
+void LOA::Serialize( Checkpoint & cp )
+{
+  cp.Item( _rptr );
+  cp.Item( _gptr );
+}
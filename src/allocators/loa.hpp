@@ -44,6 +44,8 @@ public:
        int inputs, int outputs );
 
   void Allocate( );
+
+  virtual void Serialize( Checkpoint & cp );
 };
 
 #endif
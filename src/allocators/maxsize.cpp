@@ -208,3 +208,8 @@ bool MaxSizeMatch::_ShortestAugmenting( )
 
   return true;
 }
+
+void MaxSizeMatch::Serialize( Checkpoint & cp )
+{
+  cp.Item( _prio );
+}
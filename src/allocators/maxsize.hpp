@@ -46,6 +46,8 @@ public:
   ~MaxSizeMatch( );
   
   void Allocate( );
+
+  virtual void Serialize( Checkpoint & cp );
 };
 
 #endif 
@@ -252,3 +252,9 @@ void SelAlloc::PrintRequests( ostream * os ) const
   *os << "]." << endl;
 }
 
+void SelAlloc::Serialize( Checkpoint & cp )
+{
+  cp.Item( _aptrs );
+  cp.Item( _gptrs );
+  cp.Item( _outmask );
+}
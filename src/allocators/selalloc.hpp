@@ -46,6 +46,8 @@ public:
 
   void Allocate( );
 
+  virtual void Serialize( Checkpoint & cp );
+
   void MaskOutput( int out, int mask = 1 );
 
   virtual void PrintRequests( ostream * os = NULL ) const;
@@ -0,0 +1,230 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// ----------------------------------------------------------------------
+//
+//  SeparableBitmaskAllocator: Separable Allocators on Packed Request
+//  Matrices
+//
+// ----------------------------------------------------------------------
+
+#include "separable_bitmask.hpp"
+
+#include "booksim.hpp"
+
+SeparableBitmaskAllocator::
+SeparableBitmaskAllocator( Module* parent, const string& name, int inputs,
+			   int outputs, const string& arb_type )
+  : BitmaskAllocator( parent, name, inputs, outputs )
+{
+  if(arb_type != "round_robin") {
+    Error("Bitmask allocators only support round-robin arbiters.");
+  }
+  _input_ptrs.resize(_inputs, 0);
+  _output_ptrs.resize(_outputs, 0);
+}
+
+int SeparableBitmaskAllocator::_InputArbitrate( int input,
+						tWord const * outputs ) const
+{
+  int const start = _input_ptrs[input];
+  if(_priorities.size() <= 1) {
+    return _RoundRobin(outputs, NULL, _out_words, start);
+  }
+
+  // the first request (in round-robin order) with the highest priority wins
+  int best = -1;
+  int best_pri = 0;
+  int const start_word = start / WORD_BITS;
+  tWord const above = ~0ULL << ( start % WORD_BITS );
+  for ( int i = 0; i <= _out_words; ++i ) {
+    int const w = ( start_word + i ) % _out_words;
+    tWord candidates = outputs[w];
+    if ( i == 0 ) {
+      candidates &= above;
+    } else if ( i == _out_words ) {
+      candidates &= ~above;
+    }
+    for ( ; candidates; candidates &= candidates - 1 ) {
+      int const output = w * WORD_BITS + _FirstBit( candidates );
+      int const pri = _request[input * _outputs + output].in_pri;
+      if ( ( best < 0 ) || ( pri > best_pri ) ) {
+	best = output;
+	best_pri = pri;
+      }
+    }
+  }
+  return best;
+}
+
+int SeparableBitmaskAllocator::_OutputArbitrate( int output,
+						 tWord const * inputs ) const
+{
+  int const start = _output_ptrs[output];
+  if(_priorities.size() <= 1) {
+    return _RoundRobin(inputs, NULL, _in_words, start);
+  }
+
+  // the first request (in round-robin order) with the highest priority wins
+  int best = -1;
+  int best_pri = 0;
+  int const start_word = start / WORD_BITS;
+  tWord const above = ~0ULL << ( start % WORD_BITS );
+  for ( int i = 0; i <= _in_words; ++i ) {
+    int const w = ( start_word + i ) % _in_words;
+    tWord candidates = inputs[w];
+    if ( i == 0 ) {
+      candidates &= above;
+    } else if ( i == _in_words ) {
+      candidates &= ~above;
+    }
+    for ( ; candidates; candidates &= candidates - 1 ) {
+      int const input = w * WORD_BITS + _FirstBit( candidates );
+      int const pri = _request[input * _outputs + output].out_pri;
+      if ( ( best < 0 ) || ( pri > best_pri ) ) {
+	best = input;
+	best_pri = pri;
+      }
+    }
+  }
+  return best;
+}
+
+void SeparableBitmaskAllocator::_Grant( int input, int output )
+{
+  assert((_inmatch[input] == -1) && (_outmatch[output] == -1));
+
+  _inmatch[input] = output;
+  _outmatch[output] = input;
+
+  // both arbiters move their pointer past the winner
+  _input_ptrs[input] = ( output + 1 ) % _outputs;
+  _output_ptrs[output] = ( input + 1 ) % _inputs;
+}
+
+void SeparableBitmaskAllocator::Serialize( Checkpoint & cp )
+{
+  cp.Item( _input_ptrs );
+  cp.Item( _output_ptrs );
+}
+
+// ----------------------------------------------------------------------
+//
+//  SeparableInputFirstBitmaskAllocator
+//
+// ----------------------------------------------------------------------
+
+SeparableInputFirstBitmaskAllocator::
+SeparableInputFirstBitmaskAllocator( Module* parent, const string& name,
+				     int inputs, int outputs,
+				     const string& arb_type )
+  : SeparableBitmaskAllocator( parent, name, inputs, outputs, arb_type )
+{
+  _winners.resize(_outputs * _in_words, 0);
+  _winners_occ.resize(_out_words, 0);
+}
+
+void SeparableInputFirstBitmaskAllocator::Allocate() {
+
+  // Execute the input arbiters and propagate the grants to the
+  // output arbiters.
+
+  for ( int w = 0; w < _in_words; ++w ) {
+    for ( tWord inputs = _in_occ[w]; inputs; inputs &= inputs - 1 ) {
+      int const input = w * WORD_BITS + _FirstBit( inputs );
+      int const output = _InputArbitrate( input, _InputRow( input ) );
+      assert(output > -1);
+      _SetBit( &_winners[output * _in_words], input );
+      _SetBit( &_winners_occ[0], output );
+    }
+  }
+
+  // Execute the output arbiters.
+
+  for ( int w = 0; w < _out_words; ++w ) {
+    for ( tWord outputs = _winners_occ[w]; outputs; outputs &= outputs - 1 ) {
+      int const output = w * WORD_BITS + _FirstBit( outputs );
+      tWord * const winners = &_winners[output * _in_words];
+      int const input = _OutputArbitrate( output, winners );
+      assert(input > -1);
+      _Grant( input, output );
+      for ( int i = 0; i < _in_words; ++i ) {
+	winners[i] = 0;
+      }
+    }
+    _winners_occ[w] = 0;
+  }
+}
+
+// ----------------------------------------------------------------------
+//
+//  SeparableOutputFirstBitmaskAllocator
+//
+// ----------------------------------------------------------------------
+
+SeparableOutputFirstBitmaskAllocator::
+SeparableOutputFirstBitmaskAllocator( Module* parent, const string& name,
+				      int inputs, int outputs,
+				      const string& arb_type )
+  : SeparableBitmaskAllocator( parent, name, inputs, outputs, arb_type )
+{
+  _winners.resize(_inputs * _out_words, 0);
+  _winners_occ.resize(_in_words, 0);
+}
+
+void SeparableOutputFirstBitmaskAllocator::Allocate() {
+
+  // Execute the output arbiters and propagate the grants to the
+  // input arbiters.
+
+  for ( int w = 0; w < _out_words; ++w ) {
+    for ( tWord outputs = _out_occ[w]; outputs; outputs &= outputs - 1 ) {
+      int const output = w * WORD_BITS + _FirstBit( outputs );
+      int const input = _OutputArbitrate( output, _OutputColumn( output ) );
+      assert(input > -1);
+      _SetBit( &_winners[input * _out_words], output );
+      _SetBit( &_winners_occ[0], input );
+    }
+  }
+
+  // Execute the input arbiters.
+
+  for ( int w = 0; w < _in_words; ++w ) {
+    for ( tWord inputs = _winners_occ[w]; inputs; inputs &= inputs - 1 ) {
+      int const input = w * WORD_BITS + _FirstBit( inputs );
+      tWord * const winners = &_winners[input * _out_words];
+      int const output = _InputArbitrate( input, winners );
+      assert(output > -1);
+      _Grant( input, output );
+      for ( int i = 0; i < _out_words; ++i ) {
+	winners[i] = 0;
+      }
+    }
+    _winners_occ[w] = 0;
+  }
+}
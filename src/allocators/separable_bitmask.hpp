@@ -0,0 +1,96 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// ----------------------------------------------------------------------
+//
+//  SeparableBitmaskAllocator: Separable Allocators on Packed Request
+//  Matrices
+//
+//  Make the same grants as the separable allocators with round-robin
+//  arbiters; each arbiter is reduced to its pointer.
+//
+// ----------------------------------------------------------------------
+
+#ifndef _SEPARABLE_BITMASK_HPP_
+#define _SEPARABLE_BITMASK_HPP_
+
+#include <vector>
+
+#include "bitmask_allocator.hpp"
+
+class SeparableBitmaskAllocator : public BitmaskAllocator {
+
+protected:
+
+  vector<int> _input_ptrs;
+  vector<int> _output_ptrs;
+
+  // requests that won the first stage, grouped by the port that
+  // arbitrates between them in the second stage
+  vector<tWord> _winners;
+  vector<tWord> _winners_occ;
+
+  int _InputArbitrate( int input, tWord const * outputs ) const;
+  int _OutputArbitrate( int output, tWord const * inputs ) const;
+
+  void _Grant( int input, int output );
+
+public:
+
+  SeparableBitmaskAllocator( Module* parent, const string& name, int inputs,
+			     int outputs, const string& arb_type ) ;
+
+  virtual void Serialize( Checkpoint & cp ) ;
+
+} ;
+
+class SeparableInputFirstBitmaskAllocator : public SeparableBitmaskAllocator {
+
+public:
+  
+  SeparableInputFirstBitmaskAllocator( Module* parent, const string& name,
+				       int inputs, int outputs,
+				       const string& arb_type ) ;
+
+  virtual void Allocate() ;
+
+} ;
+
+class SeparableOutputFirstBitmaskAllocator : public SeparableBitmaskAllocator {
+
+public:
+  
+  SeparableOutputFirstBitmaskAllocator( Module* parent, const string& name,
+					int inputs, int outputs,
+					const string& arb_type ) ;
+
+  virtual void Allocate() ;
+
+} ;
+
+#endif
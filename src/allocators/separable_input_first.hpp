@@ -38,7 +38,7 @@
 
 #include "separable.hpp"
 
-class SeparableInputFirstAllocator : public SeparableAllocator {
+class SeparableInputFirstAllocator final : public SeparableAllocator {
 
 public:
   
@@ -108,4 +108,7 @@ void Wavefront::Allocate( )
   _pri = ( ( _skip_diags ? first_diag : _pri ) + 1 ) % _square;
 }
 
-
+void Wavefront::Serialize( Checkpoint & cp )
+{
+  cp.Item( _pri );
+}
@@ -0,0 +1,138 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+// ----------------------------------------------------------------------
+//
+//  Wavefront_Bitmask: Wavefront Allocator on Packed Request Matrices
+//
+// ----------------------------------------------------------------------
+
+#include "booksim.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include "wavefront_bitmask.hpp"
+
+Wavefront_Bitmask::Wavefront_Bitmask( Module *parent, const string& name,
+				      int inputs, int outputs,
+				      bool skip_diags ) :
+  BitmaskAllocator( parent, name, inputs, outputs ),
+  _last_in(-1), _last_out(-1), _skip_diags(skip_diags), 
+  _square(max(inputs, outputs)), _pri(0), _num_requests(0)
+{
+  _in_matched.resize(_in_words, 0);
+  _out_matched.resize(_out_words, 0);
+}
+
+void Wavefront_Bitmask::AddRequest( int in, int out, int label, 
+				    int in_pri, int out_pri )
+{
+  BitmaskAllocator::AddRequest(in, out, label, in_pri, out_pri);
+  _num_requests++;
+  _last_in = in;
+  _last_out = out;
+}
+
+void Wavefront_Bitmask::Allocate( )
+{
+
+  int first_diag = -1;
+
+  if(_num_requests == 0)
+
+    // bypass allocator completely if there were no requests
+    return;
+  
+  if(_num_requests == 1) {
+
+    // if we only had a single request, we can immediately grant it
+    _inmatch[_last_in] = _last_out;
+    _outmatch[_last_out] = _last_in;
+    first_diag = _last_in + _last_out;
+
+  } else {
+
+    // otherwise we have to loop through the diagonals of request matrix,
+    // once per priority class, starting with the highest one
+
+    sort(_priorities.begin(), _priorities.end(), greater<pair<int, int> >());
+    bool const single_class = ( _priorities.size( ) == 1 );
+
+    _in_matched.assign(_in_words, 0);
+    _out_matched.assign(_out_words, 0);
+
+    for(size_t c = 0; c < _priorities.size(); ++c) {
+
+      int const out_pri = _priorities[c].first;
+      int const in_pri = _priorities[c].second;
+      
+      for ( int p = 0; p < _square; ++p ) {
+	int const diag = ( _pri + p ) % _square;
+	for ( int w = 0; w < _out_words; ++w ) {
+	  for ( tWord outputs = _out_occ[w] & ~_out_matched[w]; outputs;
+		outputs &= outputs - 1 ) {
+	    int const output = w * WORD_BITS + _FirstBit( outputs );
+	    int const input = ( diag + ( _square - output ) ) % _square;
+	    if ( ( input >= _inputs ) || _TestBit( &_in_matched[0], input ) ||
+		 !_TestBit( _OutputColumn( output ), input ) ) {
+	      continue;
+	    }
+	    sRequest const & req = _request[input * _outputs + output];
+	    if ( single_class ||
+		 ( ( req.in_pri == in_pri ) && ( req.out_pri == out_pri ) ) ) {
+	      // Grant!
+	      _inmatch[input] = output;
+	      _outmatch[output] = input;
+	      _SetBit( &_in_matched[0], input );
+	      _SetBit( &_out_matched[0], output );
+	      if(first_diag < 0) {
+		first_diag = input + output;
+	      }
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  _num_requests = 0;
+  _last_in = -1;
+  _last_out = -1;
+  _priorities.clear();
+  
+  assert(first_diag >= 0);
+
+  // Round-robin the priority diagonal
+  _pri = ( ( _skip_diags ? first_diag : _pri ) + 1 ) % _square;
+}
+
+void Wavefront_Bitmask::Serialize( Checkpoint & cp )
+{
+  cp.Item( _pri );
+}
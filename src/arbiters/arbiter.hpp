@@ -37,6 +37,7 @@
 #include <vector>
 
 #include "module.hpp"
+#include "checkpoint.hpp"
 
 class Arbiter : public Module {
 
@@ -75,6 +76,10 @@ public:
 
   virtual void Clear();
 
+  // requests only live for a single cycle; arbiters that carry priority 
+  // state across cycles save it here
+  virtual void Serialize( Checkpoint & cp ) { }
+
   inline int LastWinner() const {
     return _selected;
   }
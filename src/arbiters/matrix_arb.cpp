@@ -119,3 +119,8 @@ void MatrixArbiter::Clear()
   _last_req = -1;
   Arbiter::Clear();
 }
+
+void MatrixArbiter::Serialize( Checkpoint & cp )
+{
+  cp.Item( _matrix );
+}
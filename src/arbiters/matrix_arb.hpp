@@ -66,6 +66,8 @@ public:
 
   virtual void Clear();
 
+  virtual void Serialize( Checkpoint & cp );
+
 } ;
 
 #endif
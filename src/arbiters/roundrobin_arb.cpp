@@ -78,3 +78,8 @@ void RoundRobinArbiter::Clear()
   _best_input = -1;
   Arbiter::Clear();
 }
+
+void RoundRobinArbiter::Serialize( Checkpoint & cp )
+{
+  cp.Item( _pointer );
+}
@@ -42,6 +42,11 @@ BatchTrafficManager::BatchTrafficManager( const Configuration &config,
 
   _max_outstanding = config.GetInt ("max_outstanding_requests");  
 
+  // requests are issued based on the number outstanding, so sources cannot
+  // sample their next packet ahead of time
+  _skip_ahead.assign(_classes, false);
+  _inject_wheel.clear();
+
   _batch_size = config.GetInt( "batch_size" );
   _batch_count = config.GetInt( "batch_count" );
 
@@ -120,7 +125,7 @@ bool BatchTrafficManager::_SingleSim( )
     _sim_state = running;
     int start_time = _time;
     bool batch_complete;
-    cout << "Sending batch " << batch_index + 1 << " (" << _batch_size << " packets)..." << endl;
+    *gProgressOut << "Sending batch " << batch_index + 1 << " (" << _batch_size << " packets)..." << endl;
     do {
       _Step();
       batch_complete = true;
@@ -134,10 +139,10 @@ bool BatchTrafficManager::_SingleSim( )
 	*_sent_packets_out << _packet_seq_no << endl;
       }
     } while(!batch_complete);
-    cout << "Batch injected. Time used is " << _time - start_time << " cycles." << endl;
+    *gProgressOut << "Batch injected. Time used is " << _time - start_time << " cycles." << endl;
 
     int sent_time = _time;
-    cout << "Waiting for batch to complete..." << endl;
+    *gProgressOut << "Waiting for batch to complete..." << endl;
 
     int empty_steps = 0;
     
@@ -153,7 +158,7 @@ bool BatchTrafficManager::_SingleSim( )
       
       if ( empty_steps % 1000 == 0 ) {
 	_DisplayRemaining( ); 
-	cout << ".";
+	*gProgressOut << ".";
       }
       
       packets_left = false;
@@ -161,13 +166,13 @@ bool BatchTrafficManager::_SingleSim( )
 	packets_left |= !_total_in_flight_flits[c].empty();
       }
     }
-    cout << endl;
-    cout << "Batch received. Time used is " << _time - sent_time << " cycles." << endl
+    *gProgressOut << endl;
+    *gProgressOut << "Batch received. Time used is " << _time - sent_time << " cycles." << endl
 	 << "Last packet was " << _last_pid << ", last flit was " << _last_id << "." << endl;
 
     _batch_time->AddSample(_time - start_time);
 
-    cout << _sim_state << endl;
+    *gProgressOut << _sim_state << endl;
 
     UpdateStats();
     DisplayStats();
@@ -0,0 +1,396 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*booksim_bench.cpp
+ *
+ *Fixed workloads for tracking simulator speed:
+ *-full simulations of the configurations in runfiles/, reporting simulated
+ * cycles and flits per second of wall-clock time and the peak RSS
+ *-microbenchmarks of allocators, router steps, channels and the flit pool
+ *
+ *usage: booksim2_bench [-r runfile_dir] [benchmark...]
+ */
+
+#include <sys/resource.h>
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cassert>
+
+#include "booksim.hpp"
+#include "booksim_config.hpp"
+#include "routefunc.hpp"
+#include "random_utils.hpp"
+#include "network.hpp"
+#include "trafficmanager.hpp"
+#include "allocator.hpp"
+#include "channel.hpp"
+#include "flit.hpp"
+#include "globals.hpp"
+
+#ifndef BOOKSIM_RUNFILES_DIR
+#define BOOKSIM_RUNFILES_DIR "runfiles"
+#endif
+
+typedef chrono::steady_clock BenchClock;
+
+// microbenchmark loops run for at least this long
+static double const MIN_BENCH_SECONDS = 0.25;
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+//////////////////////
+
+class BenchTrafficManager : public TrafficManager {
+public:
+  BenchTrafficManager( Configuration const & config,
+		       vector<Network *> const & net )
+    : TrafficManager( config, net ) { }
+
+  inline int FlitsCreated( ) const { return _cur_id; }
+
+  // start injecting at the configured rate without any sampling
+  void StartTraffic( ) {
+    _time = 0;
+    _sim_state = running;
+    _ClearStats( );
+  }
+  void StepCycles( int cycles ) {
+    for ( int i = 0; i < cycles; ++i ) {
+      _Step( );
+    }
+  }
+};
+
+class NullBuffer : public streambuf {
+protected:
+  virtual int overflow( int c ) { return c; }
+};
+
+static double Seconds( BenchClock::time_point start )
+{
+  return chrono::duration<double>( BenchClock::now( ) - start ).count( );
+}
+
+static double PeakRSSMegabytes( )
+{
+  struct rusage usage;
+  getrusage( RUSAGE_SELF, &usage );
+  return usage.ru_maxrss / 1024.0; // kilobytes on Linux
+}
+
+// Runs body(iterations) with growing iteration counts until it takes long
+// enough to time, and returns the nanoseconds per iteration.
+template<typename Body>
+static double NanosPerIteration( Body body )
+{
+  for ( long iterations = 1; ; iterations *= 2 ) {
+    BenchClock::time_point const start = BenchClock::now( );
+    body( iterations );
+    double const elapsed = Seconds( start );
+    if ( elapsed >= MIN_BENCH_SECONDS ) {
+      return 1e9 * elapsed / (double)iterations;
+    }
+  }
+}
+
+static bool Selected( vector<string> const & selection, string const & name )
+{
+  if ( selection.empty( ) ) {
+    return true;
+  }
+  for ( size_t i = 0; i < selection.size( ); ++i ) {
+    if ( name.compare( 0, selection[i].size( ), selection[i] ) == 0 ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void ReportMicro( string const & name, double ns )
+{
+  cout << left << setw( 44 ) << name << right << fixed << setprecision( 1 )
+       << setw( 12 ) << ns << " ns/op" << endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Simulations
+//////////////////////
+
+struct SimBench {
+  char const * name;
+  char const * runfile;
+  char const * overrides;
+};
+
+static SimBench const gSimBenches[] = {
+  { "sim/mesh",      "meshconfig",      "" },
+  { "sim/torus",     "meshconfig",      "topology = torus; routing_function = dim_order;" },
+  { "sim/cmesh",     "cmeshconfig",     "" },
+  { "sim/flatfly",   "flatflyconfig",   "sample_period = 1000;" },
+  { "sim/dragonfly", "dragonflyconfig", "" },
+  { "sim/fattree",   "ftreeconfig",     "" },
+};
+
+static void RunSimBench( SimBench const & bench, string const & runfile_dir )
+{
+  BookSimConfig config;
+  ReadSettingsFile( &config, runfile_dir + "/" + bench.runfile );
+  AssignSettings( &config, bench.overrides );
+  InitializeRoutingMap( config );
+
+  // keep the simulator's own progress reports out of the results
+  NullBuffer null_buffer;
+  streambuf * const cout_buffer = cout.rdbuf( &null_buffer );
+
+  int const subnets = config.GetInt( "subnets" );
+  vector<Network *> net( subnets );
+  for ( int i = 0; i < subnets; ++i ) {
+    ostringstream name;
+    name << "network_" << i;
+    net[i] = Network::New( config, name.str( ) );
+  }
+  BenchTrafficManager * const tm = new BenchTrafficManager( config, net );
+  trafficManager = tm;
+
+  BenchClock::time_point const start = BenchClock::now( );
+  tm->Run( );
+  double const elapsed = Seconds( start );
+
+  int const cycles = tm->getTime( );
+  int const flits = tm->FlitsCreated( );
+
+  delete tm;
+  trafficManager = NULL;
+  for ( int i = 0; i < subnets; ++i ) {
+    delete net[i];
+  }
+  cout.rdbuf( cout_buffer );
+
+  cout << left << setw( 16 ) << bench.name << right
+       << setw( 10 ) << cycles
+       << fixed << setprecision( 3 ) << setw( 10 ) << elapsed
+       << setprecision( 0 ) << setw( 14 ) << cycles / elapsed
+       << setw( 14 ) << flits / elapsed
+       << setprecision( 1 ) << setw( 12 ) << PeakRSSMegabytes( ) << endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Microbenchmarks
+//////////////////////
+
+static void BenchAllocator( string const & type, int size )
+{
+  BookSimConfig config;
+  Allocator * const allocator =
+    Allocator::NewAllocator( NULL, "bench_alloc", type, size, size, &config );
+
+  // a fixed set of half-dense request matrices, cycled through
+  int const patterns = 64;
+  vector<vector<pair<int, int> > > requests( patterns );
+  RandomSeed( 0 );
+  for ( int p = 0; p < patterns; ++p ) {
+    for ( int in = 0; in < size; ++in ) {
+      for ( int out = 0; out < size; ++out ) {
+	if ( RandomInt( 1 ) ) {
+	  requests[p].push_back( make_pair( in, out ) );
+	}
+      }
+    }
+  }
+
+  double const ns = NanosPerIteration( [&]( long iterations ) {
+      for ( long i = 0; i < iterations; ++i ) {
+	vector<pair<int, int> > const & r = requests[i % patterns];
+	allocator->Clear( );
+	for ( size_t j = 0; j < r.size( ); ++j ) {
+	  allocator->AddRequest( r[j].first, r[j].second, 1, 0, 0 );
+	}
+	allocator->Allocate( );
+      }
+    } );
+  delete allocator;
+
+  ostringstream name;
+  name << "alloc/" << type << "/" << size << "x" << size;
+  ReportMicro( name.str( ), ns );
+}
+
+// IQRouter::_InternalStep depends on the simulation clock and on flits and
+// credits arriving on its channels, so it is measured through a loaded mesh
+// of input-queued routers and reported per router and cycle.
+static void BenchRouterStep( double injection_rate )
+{
+  BookSimConfig config;
+  AssignSettings( &config,
+		  "topology = mesh; k = 8; n = 2; routing_function = dim_order;"
+		  "router = iq; num_vcs = 4; vc_buf_size = 8; packet_size = 4;"
+		  "traffic = uniform;" );
+  config.Assign( "injection_rate", injection_rate );
+  InitializeRoutingMap( config );
+
+  NullBuffer null_buffer;
+  streambuf * const cout_buffer = cout.rdbuf( &null_buffer );
+
+  vector<Network *> net( 1, Network::New( config, "network_0" ) );
+  BenchTrafficManager * const tm = new BenchTrafficManager( config, net );
+  trafficManager = tm;
+
+  tm->StartTraffic( );
+  tm->StepCycles( 2000 );
+  double const ns = NanosPerIteration( [&]( long iterations ) {
+      tm->StepCycles( iterations );
+    } );
+  int const routers = net[0]->NumRouters( );
+
+  delete tm;
+  trafficManager = NULL;
+  delete net[0];
+  cout.rdbuf( cout_buffer );
+
+  ostringstream name;
+  name << "router/iq/mesh8x8/rate" << injection_rate;
+  ReportMicro( name.str( ), ns / routers );
+}
+
+static void BenchChannel( int latency )
+{
+  Channel<Flit> channel( NULL, "bench_channel" );
+  channel.SetLatency( latency );
+  Flit * const f = Flit::New( );
+  long received = 0;
+
+  int time = 0;
+  double const ns = NanosPerIteration( [&]( long iterations ) {
+      for ( long i = 0; i < iterations; ++i, ++time ) {
+	channel.Send( f );
+	channel.ReadInputs( time );
+	channel.WriteOutputs( time );
+	received += ( channel.Receive( ) != NULL );
+      }
+    } );
+  // drain the delay line before the channel goes away
+  for ( int i = 0; i < latency; ++i, ++time ) {
+    channel.ReadInputs( time );
+    channel.WriteOutputs( time );
+  }
+  f->Free( );
+
+  ostringstream name;
+  name << "channel/latency" << latency;
+  ReportMicro( name.str( ), ns );
+  assert( received > 0 );
+}
+
+static void BenchFlitPool( int batch )
+{
+  vector<Flit *> flits( batch );
+  double const ns = NanosPerIteration( [&]( long iterations ) {
+      for ( long i = 0; i < iterations; ++i ) {
+	for ( int j = 0; j < batch; ++j ) {
+	  flits[j] = Flit::New( );
+	}
+	for ( int j = 0; j < batch; ++j ) {
+	  flits[j]->Free( );
+	}
+      }
+    } );
+
+  ostringstream name;
+  name << "flit/new_free/batch" << batch;
+  ReportMicro( name.str( ), ns / batch );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main( int argc, char **argv )
+{
+  string runfile_dir = BOOKSIM_RUNFILES_DIR;
+  vector<string> selection;
+  for ( int i = 1; i < argc; ++i ) {
+    if ( !strcmp( argv[i], "-r" ) && ( i + 1 < argc ) ) {
+      runfile_dir = argv[++i];
+    } else if ( argv[i][0] == '-' ) {
+      cerr << "Usage: " << argv[0] << " [-r runfile_dir] [benchmark...]"
+	   << endl;
+      return -1;
+    } else {
+      selection.push_back( argv[i] );
+    }
+  }
+
+  gPrintActivity = false;
+  gTrace = false;
+  gWatchOut = NULL;
+
+  cout << left << setw( 16 ) << "simulation" << right
+       << setw( 10 ) << "cycles" << setw( 10 ) << "wall[s]"
+       << setw( 14 ) << "cycles/s" << setw( 14 ) << "flits/s"
+       << setw( 12 ) << "peakRSS[MB]" << endl;
+  for ( size_t b = 0; b < sizeof( gSimBenches ) / sizeof( gSimBenches[0] ); ++b ) {
+    if ( Selected( selection, gSimBenches[b].name ) ) {
+      RunSimBench( gSimBenches[b], runfile_dir );
+    }
+  }
+  cout << endl;
+
+  char const * const allocators[] = {
+    "islip", "pim", "separable_input_first", "separable_output_first",
+    "wavefront", "islip_bitmask", "wavefront_bitmask",
+    "separable_input_first_bitmask"
+  };
+  int const sizes[] = { 5, 20 };
+  for ( size_t a = 0; a < sizeof( allocators ) / sizeof( allocators[0] ); ++a ) {
+    for ( size_t s = 0; s < sizeof( sizes ) / sizeof( sizes[0] ); ++s ) {
+      if ( Selected( selection, string( "alloc/" ) + allocators[a] ) ) {
+	BenchAllocator( allocators[a], sizes[s] );
+      }
+    }
+  }
+  if ( Selected( selection, "router" ) ) {
+    BenchRouterStep( 0.05 );
+    BenchRouterStep( 0.3 );
+  }
+  if ( Selected( selection, "channel" ) ) {
+    BenchChannel( 1 );
+    BenchChannel( 4 );
+  }
+  if ( Selected( selection, "flit" ) ) {
+    BenchFlitPool( 1 );
+    BenchFlitPool( 64 );
+  }
+
+  return 0;
+}
@@ -0,0 +1,507 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*booksim_check.cpp
+ *
+ *Regression checks run by ctest:
+ *-network_threads: a network stepped on several shards has to match the
+ * serial engine cycle by cycle
+ *-flit_pool: flits cached by threads that exit go back to the pool
+ *-mta_interface: polled packet descriptors survive later sends, and no
+ * flit or credit is lost while nodes are busy with their packets
+ *
+ *usage: booksim2_check [-r runfile_dir] [check...]
+ *returns non-zero if any of the selected checks fails
+ */
+
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <random>
+#include <deque>
+
+#include "booksim.hpp"
+#include "booksim_config.hpp"
+#include "routefunc.hpp"
+#include "network.hpp"
+#include "trafficmanager.hpp"
+#include "flit.hpp"
+#include "mta_trafficmanager.hpp"
+#include "globals.hpp"
+
+#ifndef BOOKSIM_RUNFILES_DIR
+#define BOOKSIM_RUNFILES_DIR "runfiles"
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+//////////////////////
+
+class CheckTrafficManager : public TrafficManager {
+public:
+  CheckTrafficManager( Configuration const & config,
+		       vector<Network *> const & net )
+    : TrafficManager( config, net ) { }
+
+  // start injecting at the configured rate without any sampling
+  void StartTraffic( ) {
+    _time = 0;
+    _sim_state = running;
+    _ClearStats( );
+  }
+  void StepCycle( ) {
+    _Step( );
+  }
+
+  inline int FlitsCreated( ) const { return _cur_id; }
+  int FlitsInFlight( ) const {
+    int flits = 0;
+    for ( int c = 0; c < _classes; ++c ) {
+      flits += _total_in_flight_flits[c].size( );
+    }
+    return flits;
+  }
+  int FlitsAccepted( ) const {
+    int flits = 0;
+    for ( int c = 0; c < _classes; ++c ) {
+      for ( int n = 0; n < _nodes; ++n ) {
+	flits += _accepted_flits[c][n];
+      }
+    }
+    return flits;
+  }
+};
+
+class NullBuffer : public streambuf {
+protected:
+  virtual int overflow( int c ) { return c; }
+};
+
+static bool Selected( vector<string> const & selection, string const & name )
+{
+  if ( selection.empty( ) ) {
+    return true;
+  }
+  for ( size_t i = 0; i < selection.size( ); ++i ) {
+    if ( name.compare( 0, selection[i].size( ), selection[i] ) == 0 ) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool Report( string const & name, bool passed, string const & reason )
+{
+  cout << ( passed ? "PASS " : "FAIL " ) << name;
+  if ( !passed ) {
+    cout << ": " << reason;
+  }
+  cout << endl;
+  return passed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// network_threads
+//////////////////////
+
+struct ThreadsCheck {
+  char const * name;
+  char const * runfile;
+  char const * overrides;
+};
+
+static ThreadsCheck const gThreadsChecks[] = {
+  { "network_threads/mesh",      "meshconfig",  "" },
+  { "network_threads/torus",     "meshconfig",  "topology = torus; routing_function = dim_order;" },
+  { "network_threads/cmesh",     "cmeshconfig", "" },
+  { "network_threads/min_adapt", "meshconfig",  "routing_function = min_adapt; packet_size = 4;" },
+};
+
+static int const THREADS_CHECK_CYCLES = 3000;
+static int const THREADS_CHECK_SHARDS = 4;
+
+struct ThreadsTrace {
+  vector<int> created;    // flits created up to each cycle
+  vector<int> in_flight;  // flits in the network after each cycle
+  vector<int> accepted;   // flits ejected up to each cycle
+  string      stats;      // DisplayStats after the last cycle
+};
+
+static ThreadsTrace RunThreads( ThreadsCheck const & check,
+				string const & runfile_dir, int threads )
+{
+  BookSimConfig config;
+  ReadSettingsFile( &config, runfile_dir + "/" + check.runfile );
+  AssignSettings( &config, check.overrides );
+  config.Assign( "network_threads", threads );
+  InitializeRoutingMap( config );
+
+  // DisplayStats always writes to cout
+  ostringstream stats;
+  streambuf * const cout_buffer = cout.rdbuf( stats.rdbuf( ) );
+
+  int const subnets = config.GetInt( "subnets" );
+  vector<Network *> net( subnets );
+  for ( int i = 0; i < subnets; ++i ) {
+    ostringstream name;
+    name << "network_" << i;
+    net[i] = Network::New( config, name.str( ) );
+  }
+  CheckTrafficManager * const tm = new CheckTrafficManager( config, net );
+  trafficManager = tm;
+
+  ThreadsTrace trace;
+  tm->StartTraffic( );
+  for ( int t = 0; t < THREADS_CHECK_CYCLES; ++t ) {
+    tm->StepCycle( );
+    trace.created.push_back( tm->FlitsCreated( ) );
+    trace.in_flight.push_back( tm->FlitsInFlight( ) );
+    trace.accepted.push_back( tm->FlitsAccepted( ) );
+  }
+  stats.str( "" );
+  tm->UpdateStats( );
+  tm->DisplayStats( );
+  trace.stats = stats.str( );
+
+  delete tm;
+  trafficManager = NULL;
+  for ( int i = 0; i < subnets; ++i ) {
+    delete net[i];
+  }
+  cout.rdbuf( cout_buffer );
+  return trace;
+}
+
+static bool CheckThreads( ThreadsCheck const & check,
+			  string const & runfile_dir )
+{
+  ThreadsTrace const serial = RunThreads( check, runfile_dir, 1 );
+  ThreadsTrace const sharded =
+    RunThreads( check, runfile_dir, THREADS_CHECK_SHARDS );
+
+  if ( serial.accepted.back( ) == 0 ) {
+    return Report( check.name, false, "no flits were delivered" );
+  }
+  for ( int t = 0; t < THREADS_CHECK_CYCLES; ++t ) {
+    if ( ( serial.created[t] != sharded.created[t] ) ||
+	 ( serial.in_flight[t] != sharded.in_flight[t] ) ||
+	 ( serial.accepted[t] != sharded.accepted[t] ) ) {
+      ostringstream reason;
+      reason << "flit counts diverge in cycle " << t
+	     << " (created " << serial.created[t] << "/" << sharded.created[t]
+	     << ", in flight " << serial.in_flight[t] << "/" << sharded.in_flight[t]
+	     << ", accepted " << serial.accepted[t] << "/" << sharded.accepted[t]
+	     << ")";
+      return Report( check.name, false, reason.str( ) );
+    }
+  }
+  if ( serial.stats != sharded.stats ) {
+    return Report( check.name, false, "final stats differ" );
+  }
+  return Report( check.name, true, "" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// flit_pool
+//////////////////////
+
+// Each short-lived worker allocates and frees a burst of flits and exits
+// with them in its thread-local cache. If the caches were not handed back,
+// every worker would carve new flits and the pool would keep growing.
+static bool CheckFlitPoolThreadExit( )
+{
+  int const workers = 50;
+  int const burst = 100;
+
+  Flit::FreeAll( );
+  int max_index = -1;
+  for ( int w = 0; w < workers; ++w ) {
+    thread worker( [&]( ) {
+	vector<Flit *> flits( burst );
+	for ( int i = 0; i < burst; ++i ) {
+	  flits[i] = Flit::New( );
+	  max_index = max( max_index, flits[i]->PoolIndex( ) );
+	}
+	for ( int i = 0; i < burst; ++i ) {
+	  flits[i]->Free( );
+	}
+      } );
+    worker.join( );
+  }
+  int const outstanding = Flit::OutStanding( );
+  Flit::FreeAll( );
+
+  if ( outstanding != 0 ) {
+    return Report( "flit_pool/thread_exit", false, "flits leaked" );
+  }
+  if ( max_index >= 4 * burst ) {
+    ostringstream reason;
+    reason << "pool grew to " << max_index + 1 << " flits for bursts of "
+	   << burst;
+    return Report( "flit_pool/thread_exit", false, reason.str( ) );
+  }
+  return Report( "flit_pool/thread_exit", true, "" );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// mta_interface
+//////////////////////
+
+static char const * const gMTACheckSettings =
+  "topology = mesh; k = 4; n = 2; routing_function = dim_order;"
+  "num_vcs = 16; vc_buf_size = 8; routing_delay = 0;";
+
+// A host polls its completions, answers the first one and only then reads
+// the rest. The answers push the PIDs past the end of the descriptor ring
+// so that it has to grow, which must not move the polled descriptors.
+static bool CheckMTAPollThenGrow( )
+{
+  BookSimConfig config;
+  AssignSettings( &config, gMTACheckSettings );
+  InitializeRoutingMap( config );
+
+  NullBuffer null_buffer;
+  streambuf * const cout_buffer = cout.rdbuf( &null_buffer );
+
+  vector<Network *> net( 1, Network::New( config, "network_0" ) );
+  MTATrafficManagerInterface * const tfm_if =
+    new MTATrafficManagerInterface( config, net );
+
+  int const receivers = 4;
+  for ( int d = 1; d <= receivers; ++d ) {
+    tfm_if->SendPacket( 0, d, 0,
+			MTAPacketDescriptor::NewDataPacket( 0x1000 * d, 1, false, false ) );
+  }
+  vector<MTACompletion> completions;
+  vector<MTACompletion> polled;
+  for ( int t = 0; ( t < 1000 ) && ( (int)polled.size( ) < receivers ); ++t ) {
+    tfm_if->Step( );
+    tfm_if->PollCompletions( completions );
+    polled.insert( polled.end( ), completions.begin( ), completions.end( ) );
+  }
+
+  string reason;
+  if ( (int)polled.size( ) < receivers ) {
+    reason = "packets were not delivered";
+  } else {
+    // well over one ring's worth of responses from the first destination
+    for ( int i = 0; i < 4096; ++i ) {
+      tfm_if->SendPacket( polled[0].node_id, 0, 0,
+			  MTAPacketDescriptor::NewDataPacket( i, 1, false, true ) );
+    }
+    for ( size_t i = 0; ( i < polled.size( ) ) && reason.empty( ); ++i ) {
+      MTACompletion const & completion = polled[i];
+      MTAPacketDescriptor const * const desc = completion.packet_desc;
+      if ( desc != &tfm_if->GetPacketDescriptor( completion.node_id ) ) {
+	reason = "polled descriptor moved";
+      } else if ( ( desc->GetDataAddr( ) != 0x1000 * (uint64_t)completion.node_id ) ||
+		  ( desc->GetDataSize( ) != 1 ) ) {
+	reason = "polled descriptor changed";
+      }
+    }
+  }
+
+  delete tfm_if;
+  delete net[0];
+  cout.rdbuf( cout_buffer );
+
+  return Report( "mta_interface/poll_then_grow", reason.empty( ), reason );
+}
+
+// Node 1 leaves the first of two packets from node 0 unhandled for a while;
+// the second one has to arrive once the first is handled.
+static bool CheckMTABusyNode( int eject_buf_size )
+{
+  BookSimConfig config;
+  AssignSettings( &config, gMTACheckSettings );
+  config.Assign( "ni_eject_buf_size", eject_buf_size );
+  InitializeRoutingMap( config );
+
+  NullBuffer null_buffer;
+  streambuf * const cout_buffer = cout.rdbuf( &null_buffer );
+
+  vector<Network *> net( 1, Network::New( config, "network_0" ) );
+  MTATrafficManagerInterface * const tfm_if =
+    new MTATrafficManagerInterface( config, net );
+
+  int const first = tfm_if->SendPacket( 0, 1, 0,
+					MTAPacketDescriptor::NewDataPacket( 0, 3, false, false ) );
+  int const second = tfm_if->SendPacket( 0, 1, 0,
+					 MTAPacketDescriptor::NewDataPacket( 0, 3, false, false ) );
+
+  string reason;
+  int t = 0;
+  while ( ( t < 1000 ) && !tfm_if->IsNodeBusy( 1 ) ) {
+    tfm_if->Step( );
+    ++t;
+  }
+  if ( tfm_if->GetPID( 1 ) != first ) {
+    reason = "first packet was not delivered";
+  } else {
+    for ( int i = 0; i < 200; ++i ) {
+      tfm_if->Step( );
+    }
+    tfm_if->HandlePacket( 1 );
+    for ( t = 0; ( t < 1000 ) && !tfm_if->IsNodeBusy( 1 ); ++t ) {
+      tfm_if->Step( );
+    }
+    if ( tfm_if->GetPID( 1 ) != second ) {
+      reason = "second packet was not delivered";
+    } else {
+      tfm_if->HandlePacket( 1 );
+      for ( t = 0; ( t < 1000 ) && !tfm_if->IsQuiescent( ); ++t ) {
+	tfm_if->Step( );
+      }
+      if ( !tfm_if->IsQuiescent( ) ) {
+	reason = "networks did not drain";
+      }
+    }
+  }
+
+  delete tfm_if;
+  delete net[0];
+  cout.rdbuf( cout_buffer );
+
+  ostringstream name;
+  name << "mta_interface/busy_node/buf" << eject_buf_size;
+  return Report( name.str( ), reason.empty( ), reason );
+}
+
+// Random multi-flit traffic, with every packet handled a few cycles after
+// it arrives; each packet has to be handled exactly once and the networks
+// have to drain afterwards.
+static bool CheckMTARandomTraffic( int eject_buf_size )
+{
+  BookSimConfig config;
+  AssignSettings( &config, gMTACheckSettings );
+  config.Assign( "ni_eject_buf_size", eject_buf_size );
+  InitializeRoutingMap( config );
+
+  NullBuffer null_buffer;
+  streambuf * const cout_buffer = cout.rdbuf( &null_buffer );
+
+  vector<Network *> net( 1, Network::New( config, "network_0" ) );
+  MTATrafficManagerInterface * const tfm_if =
+    new MTATrafficManagerInterface( config, net );
+  int const nodes = net[0]->NumNodes( );
+
+  mt19937 rng( 1 );
+  int const send_cycles = 3000;
+  int const max_cycles = 50000;
+  int sent = 0;
+  int handled = 0;
+  deque<pair<int, int> > due; // (cycle, node), in order of the cycle
+  vector<MTACompletion> completions;
+  for ( int t = 0; t < max_cycles; ++t ) {
+    if ( t < send_cycles ) {
+      for ( int n = 0; n < nodes; ++n ) {
+	if ( rng( ) % 16 == 0 ) {
+	  int const dest = ( n + 1 + rng( ) % ( nodes - 1 ) ) % nodes;
+	  tfm_if->SendPacket( n, dest, 0,
+			      MTAPacketDescriptor::NewDataPacket( t, rng( ) % 6, rng( ) % 2, false ) );
+	  ++sent;
+	}
+      }
+    } else if ( ( handled == sent ) && tfm_if->IsQuiescent( ) ) {
+      break;
+    }
+    while ( !due.empty( ) && ( due.front( ).first <= t ) ) {
+      tfm_if->HandlePacket( due.front( ).second );
+      ++handled;
+      due.pop_front( );
+    }
+    tfm_if->Step( );
+    tfm_if->PollCompletions( completions );
+    for ( size_t i = 0; i < completions.size( ); ++i ) {
+      due.push_back( make_pair( t + 5, completions[i].node_id ) );
+    }
+  }
+
+  string reason;
+  if ( handled != sent ) {
+    ostringstream os;
+    os << handled << " of " << sent << " packets were handled";
+    reason = os.str( );
+  } else if ( !tfm_if->IsQuiescent( ) ) {
+    reason = "networks did not drain";
+  }
+
+  delete tfm_if;
+  delete net[0];
+  cout.rdbuf( cout_buffer );
+
+  ostringstream name;
+  name << "mta_interface/random_traffic/buf" << eject_buf_size;
+  return Report( name.str( ), reason.empty( ), reason );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+int main( int argc, char **argv )
+{
+  string runfile_dir = BOOKSIM_RUNFILES_DIR;
+  vector<string> selection;
+  for ( int i = 1; i < argc; ++i ) {
+    if ( !strcmp( argv[i], "-r" ) && ( i + 1 < argc ) ) {
+      runfile_dir = argv[++i];
+    } else if ( argv[i][0] == '-' ) {
+      cerr << "Usage: " << argv[0] << " [-r runfile_dir] [check...]"
+	   << endl;
+      return -1;
+    } else {
+      selection.push_back( argv[i] );
+    }
+  }
+
+  gPrintActivity = false;
+  gTrace = false;
+  gWatchOut = NULL;
+
+  int failures = 0;
+  for ( size_t c = 0; c < sizeof( gThreadsChecks ) / sizeof( gThreadsChecks[0] ); ++c ) {
+    if ( Selected( selection, gThreadsChecks[c].name ) ) {
+      failures += !CheckThreads( gThreadsChecks[c], runfile_dir );
+    }
+  }
+  if ( Selected( selection, "flit_pool" ) ) {
+    failures += !CheckFlitPoolThreadExit( );
+  }
+  if ( Selected( selection, "mta_interface" ) ) {
+    failures += !CheckMTAPollThenGrow( );
+    failures += !CheckMTABusyNode( 0 );
+    failures += !CheckMTABusyNode( 4 );
+    failures += !CheckMTARandomTraffic( 0 );
+    failures += !CheckMTARandomTraffic( 4 );
+  }
+
+  return ( failures > 0 ) ? 1 : 0;
+}
@@ -46,6 +46,10 @@ BookSimConfig::BookSimConfig( )
 
   // Physical sub-networks
   _int_map["subnets"] = 1;
+  // number of threads used to step the sub-networks (1 = serial)
+  _int_map["subnet_threads"] = 1;
+  // number of threads used to step the routers of each sub-network
+  _int_map["network_threads"] = 1;
 
   //==== Topology options =======================
   AddStrField( "topology", "torus" );
@@ -53,6 +57,12 @@ BookSimConfig::BookSimConfig( )
   _int_map["n"] = 2; //network dimension
   _int_map["c"] = 1; //concentration
   AddStrField( "routing_function", "none" );
+  // precompute the routes of deterministic routing functions when the
+  // network is built (uses routers * nodes table entries)
+  _int_map["routing_table"] = 0;
+  // routing of multicast packets (e.g. dor_tree); only IQRouters replicate
+  // packets
+  AddStrField( "multicast_routing_function", "none" );
 
   //simulator tries to correclty adjust latency for node/router placement 
   _int_map["use_noc_latency"] = 1;
@@ -138,6 +148,9 @@ BookSimConfig::BookSimConfig( )
   _int_map["st_prepare_delay"] = 0;
   _int_map["st_final_delay"]   = 1;
 
+  // use a pipeline compiled for the configuration where one is available
+  _int_map["specialized_pipeline"] = 1;
+
   //==== Event-driven =====================================
 
   _int_map["vct"] = 0; 
@@ -182,6 +195,10 @@ BookSimConfig::BookSimConfig( )
   _float_map["burst_beta"]  = 0.5; // burst length
   _float_map["burst_r1"] = -1.0; // burst rate
 
+  // sample the time of each source's next packet instead of testing the 
+  // injection process every cycle (classes without requests and replies)
+  _int_map["skip_ahead_injection"] = 0;
+
   AddStrField( "priority", "none" );  // message priorities
 
   _int_map["batch_size"] = 1000;
@@ -267,11 +284,20 @@ BookSimConfig::BookSimConfig( )
 
   _int_map["seed"]            = 0; //random seed for simulation, e.g. traffic 
   AddStrField("seed", ""); // workaround to allow special "time" value
+  // draw random numbers at run time from per-router and per-node streams 
+  // keyed by seed, name and cycle instead of the global generator, which 
+  // makes results independent of the evaluation order
+  _int_map["random_streams"] = 0;
 
   _int_map["print_activity"] = 0;
 
   _int_map["print_csv_results"] = 0;
 
+  // log-linear latency histograms, so tail percentiles stay resolved; they
+  // replace the linear plat_hist/nlat_hist/flat_hist bins (indexed by
+  // latency) in the stats_out dumps with log-linear buckets
+  _int_map["hdr_latency_stats"] = 0;
+
   _int_map["deadlock_warn_timeout"] = 256;
 
   _int_map["viewer_trace"] = 0;
@@ -286,6 +312,17 @@ BookSimConfig::BookSimConfig( )
 
   AddStrField("stats_out", "");
 
+  // binary trace of the packets sent through the NeuroMTA interface
+  AddStrField("mta_trace_out", "");
+
+  // depth (in flits) of the NeuroMTA network interface ejection buffers; if
+  // zero, a busy node withholds the credits of every flit it receives
+  _int_map["ni_eject_buf_size"] = 0;
+
+  // NeuroMTA packets of at least this many flits move through the network
+  // as a single abstract flit (zero simulates every flit)
+  _int_map["abstract_packet_size"] = 0;
+
 #ifdef TRACK_FLOWS
   AddStrField("injected_flits_out", "");
   AddStrField("received_flits_out", "");
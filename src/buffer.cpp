@@ -25,6 +25,9 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+
+#include <algorithm>
+#include <limits>
 #include <sstream>
 
 #include "globals.hpp"
@@ -35,49 +38,261 @@ Buffer::Buffer( const Configuration& config, int outputs,
 		Module *parent, const string& name ) :
 Module( parent, name ), _occupancy(0)
 {
-  int num_vcs = config.GetInt( "num_vcs" );
+  _vcs = config.GetInt( "num_vcs" );
 
   _size = config.GetInt("buf_size");
   if(_size < 0) {
-    _size = num_vcs * config.GetInt( "vc_buf_size" );
+    _size = _vcs * config.GetInt( "vc_buf_size" );
   };
 
-  _vc.resize(num_vcs);
+  // a single VC can take up the whole buffer, unless the upstream buffer
+  // state hands out a fixed share of it to each VC
+  int vc_size = _size;
+  if(config.GetStr("buffer_policy") == "private") {
+    int const buf_size = config.GetInt("buf_size");
+    vc_size = (buf_size <= 0) ? config.GetInt("vc_buf_size") : (buf_size / _vcs);
+  }
+  _ring_bits = 0;
+  while((1 << _ring_bits) < vc_size) {
+    ++_ring_bits;
+  }
+  _ring_mask = (1 << _ring_bits) - 1;
+  _vc_size = vc_size;
+
+  _flits.resize(_vcs << _ring_bits, NULL);
+  _head.resize(_vcs, 0);
+  _count.resize(_vcs, 0);
+  _kept.resize(_vcs, 0);
+
+  _state.resize(_vcs, VC::idle);
+  _out_port.resize(_vcs, -1);
+  _out_vc.resize(_vcs, -1);
+  _pri.resize(_vcs, 0);
+  _expected_pid.resize(_vcs, -1);
+  _watched.resize(_vcs, false);
 
-  for(int i = 0; i < num_vcs; ++i) {
-    ostringstream vc_name;
-    vc_name << "vc_" << i;
-    _vc[i] = new VC(config, outputs, this, vc_name.str( ) );
+  _lookahead_routing = !config.GetInt("routing_delay");
+  _route_set.resize(_vcs, NULL);
+  if(!_lookahead_routing) {
+    _own_route_sets.resize(_vcs);
+    for(int i = 0; i < _vcs; ++i) {
+      _route_set[i] = &_own_route_sets[i];
+    }
   }
 
+  string priority = config.GetStr( "priority" );
+  if ( priority == "local_age" ) {
+    _pri_type = local_age_based;
+  } else if ( priority == "queue_length" ) {
+    _pri_type = queue_length_based;
+  } else if ( priority == "hop_count" ) {
+    _pri_type = hop_count_based;
+  } else if ( priority == "none" ) {
+    _pri_type = none;
+  } else {
+    _pri_type = other;
+  }
+
+  _priority_donation = config.GetInt("vc_priority_donation");
+
 #ifdef TRACK_BUFFERS
   int classes = config.GetInt("classes");
   _class_occupancy.resize(classes, 0);
 #endif
 }
 
-Buffer::~Buffer()
+string Buffer::_VCName( int vc ) const
 {
-  for(vector<VC*>::iterator i = _vc.begin(); i != _vc.end(); ++i) {
-    delete *i;
-  }
+  ostringstream vc_name;
+  vc_name << FullName() << "/vc_" << vc;
+  return vc_name.str();
 }
 
 void Buffer::AddFlit( int vc, Flit *f )
 {
+  assert(f);
+
   if(_occupancy >= _size) {
     Error("Flit buffer overflow.");
   }
+  if(_count[vc] > _ring_mask) {
+    Error("VC buffer overflow.");
+  }
+
+  if(_expected_pid[vc] >= 0) {
+    if(f->pid != _expected_pid[vc]) {
+      ostringstream err;
+      err << "Received flit " << f->id << " with unexpected packet ID: " << f->pid 
+	  << " (expected: " << _expected_pid[vc] << ") at VC " << vc;
+      Error(err.str());
+    } else if(f->tail) {
+      _expected_pid[vc] = -1;
+    }
+  } else if(!f->tail) {
+    _expected_pid[vc] = f->pid;
+  }
+    
+  // update flit priority before adding to VC buffer
+  if(_pri_type == local_age_based) {
+    f->pri = numeric_limits<int>::max() - GetSimTime();
+    assert(f->pri >= 0);
+  } else if(_pri_type == hop_count_based) {
+    f->pri = f->hops;
+    assert(f->pri >= 0);
+  }
+
   ++_occupancy;
-  _vc[vc]->AddFlit(f);
+  _Slot(vc, _count[vc]) = f;
+  ++_count[vc];
 #ifdef TRACK_BUFFERS
   ++_class_occupancy[f->cl];
 #endif
+  _UpdatePriority(vc);
+}
+
+Flit *Buffer::RemoveFlit( int vc )
+{
+  if(!_count[vc]) {
+    Error("Trying to remove flit from empty buffer.");
+  }
+  assert(!_kept[vc]);
+  --_occupancy;
+  Flit * const f = _Slot(vc, 0);
+#ifdef TRACK_BUFFERS
+  int cl = f->cl;
+  assert(_class_occupancy[cl] > 0);
+  --_class_occupancy[cl];
+#endif
+  _head[vc] = ( _head[vc] + 1 ) & _ring_mask;
+  --_count[vc];
+  _UpdatePriority(vc);
+  return f;
+}
+
+Flit *Buffer::KeepFlit( int vc )
+{
+  Flit * const f = FrontFlit(vc);
+  if(!f) {
+    Error("Trying to keep flit from empty buffer.");
+  }
+  ++_kept[vc];
+  // the flits kept here only leave once the whole packet has been sent down
+  // every branch, so the packet has to fit into the VC
+  if(!f->tail && (_kept[vc] >= _vc_size)) {
+    Error("Multicast packet does not fit into its VC buffer.");
+  }
+  return f;
+}
+
+void Buffer::SetState( int vc, VC::eVCState s )
+{
+  Flit * f = FrontFlit(vc);
+  
+  if(f && f->watch)
+    *gWatchOut << GetSimTime() << " | " << _VCName(vc) << " | "
+		<< "Changing state from " << VC::VCSTATE[_state[vc]]
+		<< " to " << VC::VCSTATE[s] << "." << endl;
+  
+  _state[vc] = s;
+}
+
+void Buffer::_UpdatePriority( int vc )
+{
+  if(!_count[vc]) return;
+  if(_pri_type == queue_length_based) {
+    _pri[vc] = _count[vc];
+  } else if(_pri_type != none) {
+    Flit * f = _Slot(vc, 0);
+    if((_pri_type != local_age_based) && _priority_donation) {
+      Flit * df = f;
+      for(int i = 1; i < _count[vc]; ++i) {
+	Flit * bf = _Slot(vc, i);
+	if(bf->pri > df->pri) df = bf;
+      }
+      if((df != f) && (df->watch || f->watch)) {
+	*gWatchOut << GetSimTime() << " | " << _VCName(vc) << " | "
+		    << "Flit " << df->id
+		    << " donates priority to flit " << f->id
+		    << "." << endl;
+      }
+      f = df;
+    }
+    if(f->watch)
+      *gWatchOut << GetSimTime() << " | " << _VCName(vc) << " | "
+		  << "Flit " << f->id
+		  << " sets priority to " << f->pri
+		  << "." << endl;
+    _pri[vc] = f->pri;
+  }
+}
+
+void Buffer::Serialize( Checkpoint & cp )
+{
+  cp.Section(FullName());
+  cp.Check(_size, FullName() + " size");
+  cp.Check(_ring_bits, FullName() + " VC size");
+  cp.Item(_occupancy);
+  cp.Item(_head);
+  cp.Item(_count);
+  cp.Item(_kept);
+  // only the live part of each ring; the other slots may still point at
+  // flits that have since been freed
+  if(!cp.Saving()) {
+    fill(_flits.begin(), _flits.end(), (Flit *)NULL);
+  }
+  for(int vc = 0; vc < _vcs; ++vc) {
+    for(int i = 0; i < _count[vc]; ++i) {
+      cp.Item(_Slot(vc, i));
+    }
+  }
+  cp.Item(_state);
+  cp.Item(_out_port);
+  cp.Item(_out_vc);
+  cp.Item(_pri);
+  cp.Item(_expected_pid);
+  cp.Item(_watched);
+  cp.Item(_own_route_sets);
+#ifdef TRACK_BUFFERS
+  cp.Item(_class_occupancy);
+#endif
+
+  // with lookahead routing, the route set is that of a flit in the VC (if it
+  // is still there), which is identified by its position
+  for(int vc = 0; vc < _vcs; ++vc) {
+    int pos = -1;
+    if(cp.Saving()) {
+      for(int i = 0; i < _count[vc]; ++i) {
+	if(_route_set[vc] == &_Slot(vc, i)->la_route_set) {
+	  pos = i;
+	}
+      }
+    }
+    cp.Item(pos);
+    if(!cp.Saving() && _lookahead_routing) {
+      _route_set[vc] = (pos >= 0) ? &_Slot(vc, pos)->la_route_set : NULL;
+    }
+  }
 }
 
 void Buffer::Display( ostream & os ) const
 {
-  for(vector<VC*>::const_iterator i = _vc.begin(); i != _vc.end(); ++i) {
-    (*i)->Display(os);
+  for(int vc = 0; vc < _vcs; ++vc) {
+    if ( _state[vc] != VC::idle ) {
+      os << _VCName(vc) << ": "
+	 << " state: " << VC::VCSTATE[_state[vc]];
+      if(_state[vc] == VC::active) {
+	os << " out_port: " << _out_port[vc]
+	   << " out_vc: " << _out_vc[vc];
+      }
+      os << " fill: " << _count[vc];
+      if(_kept[vc]) {
+	os << " kept: " << _kept[vc];
+      }
+      if(_count[vc]) {
+	os << " front: " << _Slot(vc, 0)->id;
+      }
+      os << " pri: " << _pri[vc];
+      os << endl;
+    }
   }
 }
@@ -25,6 +25,7 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+
 #ifndef _BUFFER_HPP_
 #define _BUFFER_HPP_
 
@@ -35,45 +36,92 @@
 #include "outputset.hpp"
 #include "routefunc.hpp"
 #include "config_utils.hpp"
+#include "checkpoint.hpp"
+
+// An input buffer with all of its virtual channels. The per-VC state is
+// kept in parallel arrays indexed by VC, and the flits of all VCs share a
+// single array in which each VC owns a ring of a fixed power-of-two size.
 
 class Buffer : public Module {
   
   int _occupancy;
   int _size;
 
-  vector<VC*> _vc;
+  int _vcs;
+
+  // flits of VC vc occupy _flits[vc << _ring_bits, (vc + 1) << _ring_bits)
+  int _ring_bits;
+  int _ring_mask;
+  vector<Flit *> _flits;
+  vector<int> _head;
+  vector<int> _count;
+
+  // flits at the front of each VC that were already sent down some of the
+  // branches of a multicast packet and are kept for the remaining ones; they
+  // are hidden from FrontFlit and Empty, but still take up buffer space
+  vector<int> _kept;
+  int _vc_size;
+
+  vector<VC::eVCState> _state;
+  vector<OutputSet *> _route_set;
+  vector<int> _out_port;
+  vector<int> _out_vc;
+  vector<int> _pri;
+  vector<int> _expected_pid;
+  vector<char> _watched;
+
+  // route sets owned by the VCs (unless routing is done one hop ahead)
+  vector<OutputSet> _own_route_sets;
+
+  enum ePrioType { local_age_based, queue_length_based, hop_count_based, none, other };
+
+  ePrioType _pri_type;
+
+  int _priority_donation;
+
+  bool _lookahead_routing;
 
 #ifdef TRACK_BUFFERS
   vector<int> _class_occupancy;
 #endif
 
+  inline Flit * & _Slot( int vc, int i )
+  {
+    return _flits[( vc << _ring_bits ) + ( ( _head[vc] + i ) & _ring_mask )];
+  }
+  inline Flit * _Slot( int vc, int i ) const
+  {
+    return _flits[( vc << _ring_bits ) + ( ( _head[vc] + i ) & _ring_mask )];
+  }
+
+  string _VCName( int vc ) const;
+
+  void _UpdatePriority( int vc );
+
 public:
   
   Buffer( const Configuration& config, int outputs,
 	  Module *parent, const string& name );
-  ~Buffer();
 
   void AddFlit( int vc, Flit *f );
 
-  inline Flit *RemoveFlit( int vc )
+  Flit *RemoveFlit( int vc );
+  
+  Flit *KeepFlit( int vc );
+
+  inline void RestoreKeptFlits( int vc )
   {
-    --_occupancy;
-#ifdef TRACK_BUFFERS
-    int cl = _vc[vc]->FrontFlit()->cl;
-    assert(_class_occupancy[cl] > 0);
-    --_class_occupancy[cl];
-#endif
-    return _vc[vc]->RemoveFlit( );
+    _kept[vc] = 0;
   }
   
   inline Flit *FrontFlit( int vc ) const
   {
-    return _vc[vc]->FrontFlit( );
+    return ( _count[vc] > _kept[vc] ) ? _Slot(vc, _kept[vc]) : NULL;
   }
   
   inline bool Empty( int vc ) const
   {
-    return _vc[vc]->Empty( );
+    return _count[vc] <= _kept[vc];
   }
 
   inline bool Full( ) const
@@ -83,59 +131,70 @@ public:
 
   inline VC::eVCState GetState( int vc ) const
   {
-    return _vc[vc]->GetState( );
+    return _state[vc];
   }
 
-  inline void SetState( int vc, VC::eVCState s )
-  {
-    _vc[vc]->SetState(s);
-  }
+  void SetState( int vc, VC::eVCState s );
 
   inline const OutputSet *GetRouteSet( int vc ) const
   {
-    return _vc[vc]->GetRouteSet( );
+    return _route_set[vc];
   }
 
   inline void SetRouteSet( int vc, OutputSet * output_set )
   {
-    _vc[vc]->SetRouteSet(output_set);
+    _route_set[vc] = output_set;
+    _out_port[vc] = -1;
+    _out_vc[vc] = -1;
   }
 
   inline void SetOutput( int vc, int out_port, int out_vc )
   {
-    _vc[vc]->SetOutput(out_port, out_vc);
+    _out_port[vc] = out_port;
+    _out_vc[vc]   = out_vc;
   }
 
   inline int GetOutputPort( int vc ) const
   {
-    return _vc[vc]->GetOutputPort( );
+    return _out_port[vc];
   }
 
   inline int GetOutputVC( int vc ) const
   {
-    return _vc[vc]->GetOutputVC( );
+    return _out_vc[vc];
   }
 
   inline int GetPriority( int vc ) const
   {
-    return _vc[vc]->GetPriority( );
+    return _pri[vc];
   }
 
   inline void Route( int vc, tRoutingFunction rf, const Router* router, const Flit* f, int in_channel )
   {
-    _vc[vc]->Route(rf, router, f, in_channel);
+    rf( router, f, in_channel, _route_set[vc], false );
+    _out_port[vc] = -1;
+    _out_vc[vc] = -1;
+  }
+
+  // routes a multicast packet along one branch of its tree
+  inline void RouteBranch( int vc, MulticastBranch const & branch )
+  {
+    _route_set[vc]->Clear( );
+    _route_set[vc]->AddRange( branch.output_port, branch.vc_start, branch.vc_end );
+    _out_port[vc] = -1;
+    _out_vc[vc] = -1;
   }
 
   // ==== Debug functions ====
 
   inline void SetWatch( int vc, bool watch = true )
   {
-    _vc[vc]->SetWatch(watch);
+    _watched[vc] = watch;
   }
 
   inline bool IsWatched( int vc ) const
   {
-    return _vc[vc]->IsWatched( );
+    return _watched[vc];
   }
 
   inline int GetOccupancy( ) const
@@ -145,7 +204,7 @@ public:
 
   inline int GetOccupancy( int vc ) const
   {
-    return _vc[vc]->GetOccupancy( );
+    return _count[vc];
   }
 
 #ifdef TRACK_BUFFERS
@@ -156,6 +215,8 @@ public:
 #endif
 
   void Display( ostream & os = cout ) const;
+
+  void Serialize( Checkpoint & cp );
 };
 
 #endif 
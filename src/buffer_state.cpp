@@ -261,6 +261,13 @@ int BufferState::SharedBufferPolicy::LimitFor(int vc) const
   return (_private_buf_size[i] + _shared_buf_size);
 }
 
+void BufferState::SharedBufferPolicy::Serialize(Checkpoint & cp)
+{
+  cp.Item(_private_buf_occupancy);
+  cp.Item(_shared_buf_occupancy);
+  cp.Item(_reserved_slots);
+}
+
 BufferState::LimitedSharedBufferPolicy::LimitedSharedBufferPolicy(Configuration const & config, BufferState * parent, const string & name)
   : SharedBufferPolicy(config, parent, name), _active_vcs(0)
 {
@@ -307,6 +314,13 @@ int BufferState::LimitedSharedBufferPolicy::LimitFor(int vc) const
   return min(SharedBufferPolicy::LimitFor(vc), _max_held_slots);
 }
 
+void BufferState::LimitedSharedBufferPolicy::Serialize(Checkpoint & cp)
+{
+  SharedBufferPolicy::Serialize(cp);
+  cp.Item(_active_vcs);
+  cp.Item(_max_held_slots);
+}
+
 BufferState::DynamicLimitedSharedBufferPolicy::DynamicLimitedSharedBufferPolicy(Configuration const & config, BufferState * parent, const string & name)
   : LimitedSharedBufferPolicy(config, parent, name)
 {
@@ -489,6 +503,16 @@ int BufferState::FeedbackSharedBufferPolicy::LimitFor(int vc) const
   return min(SharedBufferPolicy::LimitFor(vc), _ComputeMaxSlots(vc));
 }
 
+void BufferState::FeedbackSharedBufferPolicy::Serialize(Checkpoint & cp)
+{
+  SharedBufferPolicy::Serialize(cp);
+  cp.Item(_occupancy_limit);
+  cp.Item(_round_trip_time);
+  cp.Item(_flit_sent_time);
+  cp.Item(_total_mapped_size);
+  cp.Item(_min_latency);
+}
+
 BufferState::SimpleFeedbackSharedBufferPolicy::SimpleFeedbackSharedBufferPolicy(Configuration const & config, BufferState * parent, const string & name)
   : FeedbackSharedBufferPolicy(config, parent, name)
 {
@@ -536,10 +560,21 @@ void BufferState::SimpleFeedbackSharedBufferPolicy::FreeSlotFor(int vc)
   SharedBufferPolicy::FreeSlotFor(vc);
 }
 
+void BufferState::SimpleFeedbackSharedBufferPolicy::Serialize(Checkpoint & cp)
+{
+  FeedbackSharedBufferPolicy::Serialize(cp);
+  cp.Item(_pending_credits);
+}
+
 BufferState::BufferState( const Configuration& config, Module *parent, const string& name ) : 
   Module( parent, name ), _occupancy(0)
 {
   _vcs = config.GetInt( "num_vcs" );
+  if(_vcs > VCMask::MAX_VCS) {
+    ostringstream err;
+    err << "Credits cannot carry more than " << VCMask::MAX_VCS << " VCs.";
+    Error(err.str());
+  }
   _size = config.GetInt("buf_size");
   if(_size < 0) {
     _size = _vcs * config.GetInt("vc_buf_size");
@@ -573,7 +608,7 @@ void BufferState::ProcessCredit( Credit const * const c )
 {
   assert( c );
 
-  set<int>::iterator iter = c->vc.begin();
+  VCMask::const_iterator iter = c->vc.begin();
   while(iter != c->vc.end()) {
 
     int const vc = *iter;
@@ -674,3 +709,21 @@ void BufferState::Display( ostream & os ) const
        << ", occupied = " << _vc_occupancy[v] << endl;
   }
 }
+
+void BufferState::Serialize( Checkpoint & cp )
+{
+  cp.Section(FullName());
+  cp.Check(_size, FullName() + " size");
+  cp.Check(_vcs, FullName() + " VCs");
+  cp.Item(_occupancy);
+  cp.Item(_vc_occupancy);
+  cp.Item(_in_use_by);
+  cp.Item(_tail_sent);
+  cp.Item(_last_id);
+  cp.Item(_last_pid);
+#ifdef TRACK_BUFFERS
+  cp.Item(_outstanding_classes);
+  cp.Item(_class_occupancy);
+#endif
+  _buffer_policy->Serialize(cp);
+}
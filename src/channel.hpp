@@ -33,16 +33,22 @@
 //   transmission delay. The channel latency can be specified as 
 //   an integer number of simulator cycles.
 //
+//  Data in flight is kept in a delay line: a ring with a power-of-two
+//   number of slots (at least the latency), where the item arriving
+//   in cycle t sits in slot (t mod size). Since an item arrives every
+//   cycle at most, no two items in flight ever share a slot.
+//
 /////
 #ifndef _CHANNEL_HPP
 #define _CHANNEL_HPP
 
-#include <queue>
+#include <vector>
 #include <cassert>
 
 #include "globals.hpp"
 #include "module.hpp"
 #include "timed_module.hpp"
+#include "checkpoint.hpp"
 
 using namespace std;
 
@@ -55,6 +61,9 @@ public:
   // Physical Parameters
   void SetLatency(int cycles);
   int GetLatency() const { return _delay ; }
+
+  // Module that consumes our output; woken up whenever data arrives
+  void SetReceiver(TimedModule * receiver) { _receiver = receiver; }
   
   // Send data 
   virtual void Send(T * data);
@@ -62,21 +71,32 @@ public:
   // Receive data
   virtual T * Receive(); 
   
-  virtual void ReadInputs();
-  virtual void Evaluate() {}
-  virtual void WriteOutputs();
+  virtual void ReadInputs(int time);
+  virtual void Evaluate(int time) {}
+  virtual void WriteOutputs(int time);
+
+  virtual bool Idle() const {
+    return !_input && !_output && !_in_flight;
+  }
+
+  // Save or restore the data in flight
+  virtual void Serialize(Checkpoint & cp);
 
 protected:
   int _delay;
   T * _input;
   T * _output;
-  queue<pair<int, T *> > _wait_queue;
+  vector<T *> _line;
+  int _mask;
+  int _in_flight;
+  TimedModule * _receiver;
 
 };
 
 template<typename T>
 Channel<T>::Channel(Module * parent, string const & name)
-  : TimedModule(parent, name), _delay(1), _input(0), _output(0) {
+  : TimedModule(parent, name), _delay(1), _input(0), _output(0),
+    _line(1, (T *)0), _mask(0), _in_flight(0), _receiver(0) {
 }
 
 template<typename T>
@@ -84,12 +104,22 @@ void Channel<T>::SetLatency(int cycles) {
   if(cycles <= 0) {
     Error("Channel must have positive delay.");
   }
+  assert(!_in_flight);
   _delay = cycles ;
+  int size = 1;
+  while(size < _delay) {
+    size *= 2;
+  }
+  _line.assign(size, (T *)0);
+  _mask = size - 1;
 }
 
 template<typename T>
 void Channel<T>::Send(T * data) {
   _input = data;
+  if(data) {
+    Wake();
+  }
 }
 
 template<typename T>
@@ -98,28 +128,41 @@ T * Channel<T>::Receive() {
 }
 
 template<typename T>
-void Channel<T>::ReadInputs() {
+void Channel<T>::ReadInputs(int time) {
   if(_input) {
-    _wait_queue.push(make_pair(GetSimTime() + _delay - 1, _input));
+    T * & slot = _line[(time + _delay - 1) & _mask];
+    assert(!slot);
+    slot = _input;
+    ++_in_flight;
     _input = 0;
   }
 }
 
 template<typename T>
-void Channel<T>::WriteOutputs() {
-  _output = 0;
-  if(_wait_queue.empty()) {
-    return;
+void Channel<T>::WriteOutputs(int time) {
+  T * & slot = _line[time & _mask];
+  _output = slot;
+  if(_output) {
+    slot = 0;
+    --_in_flight;
+    if(_receiver) {
+      _receiver->Wake();
+    }
   }
-  pair<int, T *> const & item = _wait_queue.front();
-  int const & time = item.first;
-  if(GetSimTime() < time) {
-    return;
+}
+
+template<typename T>
+void Channel<T>::Serialize(Checkpoint & cp) {
+  cp.Section(FullName());
+  cp.Check(_delay, FullName() + " latency");
+  cp.Item(_input);
+  cp.Item(_output);
+  cp.Item(_line);
+  cp.Item(_in_flight);
+  if(!cp.Saving() && _output && _receiver) {
+    // the receiver was woken up when the data arrived
+    _receiver->Wake();
   }
-  assert(GetSimTime() == time);
-  _output = item.second;
-  assert(_output);
-  _wait_queue.pop();
 }
 
 #endif
@@ -0,0 +1,228 @@
+/*****************************************************
+ * Simulation Checkpoints
+ *****************************************************
+ * Overview
+ *   - The stream starts with a magic string and the format version, and
+ *     ends with an end marker. Sections are stored as their names.
+ *   - A flit or credit pointer is stored as the number of the object in
+ *     the order of first reference (-1 for NULL), followed by its contents
+ *     the first time it shows up. The numbering does not depend on where
+ *     the objects are in their pools, so equal simulation states always
+ *     give the same checkpoint.
+ */
+
+#include <cstring>
+#include <cstdlib>
+
+#include "checkpoint.hpp"
+#include "flit.hpp"
+#include "credit.hpp"
+
+static char const MAGIC[8] = { 'B', 'S', 'C', 'H', 'K', 'P', 'N', 'T' };
+static string const END_MARKER = "end";
+
+Checkpoint::Checkpoint( ostream & os )
+  : _os( &os ), _is( NULL )
+{
+  char magic[sizeof( MAGIC )];
+  memcpy( magic, MAGIC, sizeof( MAGIC ) );
+  Bytes( magic, sizeof( magic ) );
+  unsigned version = VERSION;
+  Item( version );
+}
+
+Checkpoint::Checkpoint( istream & is )
+  : _os( NULL ), _is( &is )
+{
+  char magic[sizeof( MAGIC )];
+  Bytes( magic, sizeof( magic ) );
+  if ( memcmp( magic, MAGIC, sizeof( MAGIC ) ) ) {
+    _Error( "not a checkpoint" );
+  }
+  unsigned version;
+  Item( version );
+  if ( version != VERSION ) {
+    _Error( "unsupported version" );
+  }
+}
+
+void Checkpoint::_Error( string const & msg ) const
+{
+  cerr << "Error in checkpoint : " << msg << endl;
+  exit( -1 );
+}
+
+void Checkpoint::Bytes( void * data, size_t size )
+{
+  if ( Saving( ) ) {
+    if ( !_os->write( (char const *)data, size ) ) {
+      _Error( "write failed" );
+    }
+  } else {
+    if ( !_is->read( (char *)data, size ) ) {
+      _Error( "unexpected end of the checkpoint" );
+    }
+  }
+}
+
+size_t Checkpoint::_Size( size_t size )
+{
+  Item( size );
+  return size;
+}
+
+void Checkpoint::Section( string const & name )
+{
+  string saved = name;
+  Item( saved );
+  if ( saved != name ) {
+    _Error( "expected " + name + " but found " + saved +
+	    " (was it saved with a different configuration?)" );
+  }
+}
+
+void Checkpoint::Check( long value, string const & what )
+{
+  long saved = value;
+  Item( saved );
+  if ( saved != value ) {
+    _Error( what + " does not match the configuration it was saved with" );
+  }
+}
+
+void Checkpoint::Item( string & s )
+{
+  size_t const size = _Size( s.size( ) );
+  s.resize( size );
+  if ( size ) {
+    Bytes( &s[0], size );
+  }
+}
+
+void Checkpoint::Item( vector<bool> & v )
+{
+  size_t const size = _Size( v.size( ) );
+  v.resize( size );
+  for ( size_t i = 0; i < size; ++i ) {
+    bool b = v[i];
+    Item( b );
+    v[i] = b;
+  }
+}
+
+void Checkpoint::Item( Flit * & f )
+{
+  // references are numbered in the order the objects first show up in
+  int ref = -1;
+  bool first = false;
+  if ( Saving( ) ) {
+    if ( f ) {
+      int const index = f->PoolIndex( );
+      if ( (int)_flit_refs.size( ) <= index ) {
+	_flit_refs.resize( index + 1, -1 );
+      }
+      first = ( _flit_refs[index] < 0 );
+      if ( first ) {
+	_flit_refs[index] = _flits.size( );
+	_flits.push_back( f );
+      }
+      ref = _flit_refs[index];
+    }
+    Item( ref );
+  } else {
+    Item( ref );
+    if ( ref < 0 ) {
+      f = NULL;
+      return;
+    }
+    if ( ref > (int)_flits.size( ) ) {
+      _Error( "corrupt flit reference" );
+    }
+    first = ( ref == (int)_flits.size( ) );
+    if ( first ) {
+      _flits.push_back( Flit::New( ) );
+    }
+    f = _flits[ref];
+  }
+  if ( !first ) {
+    return;
+  }
+
+  if ( f->data ) {
+    _Error( "flits carrying host data cannot be checkpointed" );
+  }
+  Item( f->type );
+  Item( f->vc );
+  Item( f->cl );
+  Item( f->head );
+  Item( f->tail );
+  Item( f->size );
+  Item( f->ctime );
+  Item( f->itime );
+  Item( f->atime );
+  Item( f->id );
+  Item( f->pid );
+  Item( f->record );
+  Item( f->src );
+  Item( f->dest );
+  Item( f->dests );
+  Item( f->pri );
+  Item( f->hops );
+  Item( f->watch );
+  Item( f->subnetwork );
+  Item( f->intm );
+  Item( f->ph );
+  Item( f->la_route_set );
+}
+
+void Checkpoint::Item( Credit * & c )
+{
+  // references are numbered in the order the objects first show up in
+  int ref = -1;
+  bool first = false;
+  if ( Saving( ) ) {
+    if ( c ) {
+      int const index = c->PoolIndex( );
+      if ( (int)_credit_refs.size( ) <= index ) {
+	_credit_refs.resize( index + 1, -1 );
+      }
+      first = ( _credit_refs[index] < 0 );
+      if ( first ) {
+	_credit_refs[index] = _credits.size( );
+	_credits.push_back( c );
+      }
+      ref = _credit_refs[index];
+    }
+    Item( ref );
+  } else {
+    Item( ref );
+    if ( ref < 0 ) {
+      c = NULL;
+      return;
+    }
+    if ( ref > (int)_credits.size( ) ) {
+      _Error( "corrupt credit reference" );
+    }
+    first = ( ref == (int)_credits.size( ) );
+    if ( first ) {
+      _credits.push_back( Credit::New( ) );
+    }
+    c = _credits[ref];
+  }
+  if ( !first ) {
+    return;
+  }
+
+  Item( c->vc );
+  Item( c->head );
+  Item( c->tail );
+  Item( c->id );
+}
+
+void Checkpoint::Finish( )
+{
+  Section( END_MARKER );
+  if ( Saving( ) ) {
+    _os->flush( );
+  }
+}
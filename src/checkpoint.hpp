@@ -0,0 +1,200 @@
+/*****************************************************
+ * Simulation Checkpoints
+ *****************************************************
+ * Overview
+ *   - A Checkpoint is a binary stream that either saves the state of a
+ *     simulation or restores it. Every stateful component implements a
+ *     single Serialize( Checkpoint & ) method that hands each of its
+ *     fields to Item, which writes the field when saving and overwrites
+ *     it when restoring, so both directions always agree on the layout.
+ *   - State is restored into a freshly constructed simulation with the
+ *     same configuration. Structural parameters (sizes, latencies, ...)
+ *     are set up by the constructors and only checked against the saved
+ *     values, while everything that changes as the simulation advances
+ *     is overwritten.
+ *   - Flits and credits are referenced from many places (channels,
+ *     buffers, in-flight maps, ...). The first reference to each one
+ *     stores its contents, later ones only refer back to it. On restore,
+ *     each of them is allocated from the pool once and all references
+ *     are pointed at the copy. Flits carrying host data cannot be saved.
+ *   - Checkpoints are stored in host byte order; they are meant to be
+ *     restored by the same binary on the machine that saved them.
+ *
+ * API Description
+ *   - Saving:              true if the checkpoint is being written
+ *   - Section:             marks the start of a component; restoring
+ *                          fails unless the same section is found there
+ *   - Check:               saves a structural parameter, or verifies that
+ *                          it matches the saved one on restore
+ *   - Item:                saves or restores a field; supports trivially
+ *                          copyable values, flit and credit pointers,
+ *                          strings, and the standard containers (and
+ *                          IdMap) thereof
+ *   - Bytes:               saves or restores a raw block of memory
+ *   - Finish:              ends the checkpoint; must be called once all
+ *                          components have been serialized
+ */
+
+#ifndef _CHECKPOINT_HPP_
+#define _CHECKPOINT_HPP_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <list>
+#include <map>
+#include <set>
+#include <utility>
+#include <type_traits>
+
+#include "booksim.hpp"
+#include "id_map.hpp"
+
+class Flit;
+class Credit;
+
+class Checkpoint {
+
+public:
+
+  static unsigned const VERSION = 6;
+
+  Checkpoint( ostream & os );
+  Checkpoint( istream & is );
+
+  inline bool Saving( ) const { return _os != NULL; }
+
+  void Section( string const & name );
+  void Check( long value, string const & what );
+
+  void Bytes( void * data, size_t size );
+
+  template<typename T>
+  void Item( T & value ) {
+    static_assert( is_trivially_copyable<T>::value && !is_pointer<T>::value,
+		   "only plain values can be checkpointed directly" );
+    Bytes( &value, sizeof( T ) );
+  }
+
+  void Item( Flit * & f );
+  void Item( Credit * & c );
+  void Item( string & s );
+  void Item( vector<bool> & v );
+
+  template<typename A, typename B>
+  void Item( pair<A, B> & p ) {
+    Item( p.first );
+    Item( p.second );
+  }
+
+  template<typename T>
+  void Item( vector<T> & v ) {
+    size_t const size = _Size( v.size( ) );
+    v.resize( size );
+    for ( size_t i = 0; i < size; ++i ) {
+      Item( v[i] );
+    }
+  }
+
+  template<typename T>
+  void Item( deque<T> & d ) {
+    size_t const size = _Size( d.size( ) );
+    d.resize( size );
+    for ( size_t i = 0; i < size; ++i ) {
+      Item( d[i] );
+    }
+  }
+
+  template<typename T>
+  void Item( list<T> & l ) {
+    size_t const size = _Size( l.size( ) );
+    l.resize( size );
+    for ( typename list<T>::iterator iter = l.begin( );
+	  iter != l.end( ); ++iter ) {
+      Item( *iter );
+    }
+  }
+
+  template<typename T>
+  void Item( queue<T> & q ) {
+    // queues cannot be iterated, so go through a copy of the contents
+    deque<T> items;
+    if ( Saving( ) ) {
+      for ( queue<T> copy = q; !copy.empty( ); copy.pop( ) ) {
+	items.push_back( copy.front( ) );
+      }
+    }
+    Item( items );
+    if ( !Saving( ) ) {
+      q = queue<T>( items );
+    }
+  }
+
+  template<typename K, typename V>
+  void Item( map<K, V> & m ) {
+    size_t const size = _Size( m.size( ) );
+    if ( Saving( ) ) {
+      for ( typename map<K, V>::iterator iter = m.begin( );
+	    iter != m.end( ); ++iter ) {
+	K key = iter->first;
+	Item( key );
+	Item( iter->second );
+      }
+    } else {
+      m.clear( );
+      for ( size_t i = 0; i < size; ++i ) {
+	K key;
+	Item( key );
+	Item( m[key] );
+      }
+    }
+  }
+
+  template<typename T>
+  void Item( set<T> & s ) {
+    size_t const size = _Size( s.size( ) );
+    if ( Saving( ) ) {
+      for ( typename set<T>::iterator iter = s.begin( );
+	    iter != s.end( ); ++iter ) {
+	T item = *iter;
+	Item( item );
+      }
+    } else {
+      s.clear( );
+      for ( size_t i = 0; i < size; ++i ) {
+	T item;
+	Item( item );
+	s.insert( item );
+      }
+    }
+  }
+
+  template<typename T>
+  void Item( IdMap<T> & m ) {
+    // keep the table layout, as it determines the iteration order
+    Item( m._slots );
+    Item( m._size );
+  }
+
+  void Finish( );
+
+private:
+
+  ostream * _os;
+  istream * _is;
+
+  // flits and credits seen so far in the order of their first reference,
+  // and (when saving) their reference numbers indexed by pool index
+  vector<Flit *>   _flits;
+  vector<Credit *> _credits;
+  vector<int>      _flit_refs;
+  vector<int>      _credit_refs;
+
+  size_t _Size( size_t size );
+  void _Error( string const & msg ) const;
+
+};
+
+#endif
@@ -39,7 +39,7 @@
 
 #include "config_utils.hpp"
 
-Configuration *Configuration::theConfig = 0;
+thread_local Configuration *Configuration::theConfig = 0;
 
 Configuration::Configuration()
 {
@@ -256,6 +256,75 @@ bool ParseArgs(Configuration * cf, int argc, char * * argv)
 }
 
 
+static string trim(string const & s)
+{
+  size_t const first = s.find_first_not_of(" \t\r\n");
+  if(first == string::npos) {
+    return "";
+  }
+  size_t const last = s.find_last_not_of(" \t\r\n");
+  return s.substr(first, last - first + 1);
+}
+
+void AssignSettings(Configuration * cf, string const & settings)
+{
+  // strip comments first, they may contain semicolons
+  string stripped;
+  istringstream lines(settings);
+  string line;
+  while(getline(lines, line)) {
+    stripped += line.substr(0, line.find("//")) + '\n';
+  }
+
+  istringstream in(stripped);
+  string setting;
+  while(getline(in, setting, ';')) {
+    size_t const eq = setting.find('=');
+    if(eq == string::npos) {
+      if(trim(setting) != "") {
+	cf->ParseError("Malformed setting: " + trim(setting));
+      }
+      continue;
+    }
+    string const field = trim(setting.substr(0, eq));
+    string value = trim(setting.substr(eq + 1));
+    bool const is_int = cf->GetIntMap().count(field);
+    bool const is_float = cf->GetFloatMap().count(field);
+    if(!is_int && !is_float && !cf->GetStrMap().count(field)) {
+      // some runfiles carry fields of other simulator versions
+      cerr << "WARNING: ignoring unknown field " << field << endl;
+      continue;
+    }
+    if((value.size() >= 2) && (value[0] == '"')) {
+      value = value.substr(1, value.size() - 2);
+    }
+    char * end;
+    long const ival = strtol(value.c_str(), &end, 10);
+    if(is_int && !value.empty() && !*end) {
+      cf->Assign(field, (int)ival);
+      continue;
+    }
+    double const fval = strtod(value.c_str(), &end);
+    if(is_float && !value.empty() && !*end) {
+      cf->Assign(field, fval);
+      continue;
+    }
+    cf->Assign(field, value);
+  }
+}
+
+void ReadSettingsFile(Configuration * cf, string const & filename)
+{
+  ifstream in(filename.c_str());
+  if(!in) {
+    cerr << "Could not open configuration file " << filename << endl;
+    exit(-1);
+  }
+  ostringstream settings;
+  settings << in.rdbuf();
+  AssignSettings(cf, settings.str());
+}
+
 //helpful for the GUI, write out nearly all variables contained in a config file.
 //However, it can't and won't write out  empty strings since the booksim yacc
 //parser won't be abled to parse blank strings
@@ -38,7 +38,7 @@
 // extern "C" int yyparse();
 
 class Configuration {
-  static Configuration * theConfig;
+  static thread_local Configuration * theConfig;
   FILE * _config_file;
   string _config_string;
 
@@ -88,6 +88,11 @@ public:
 
 bool ParseArgs(Configuration * cf, int argc, char **argv);
 
+// parse "field = value;" settings without the generated config parser;
+// unknown fields are skipped with a warning
+void AssignSettings(Configuration * cf, string const & settings);
+void ReadSettingsFile(Configuration * cf, string const & filename);
+
 vector<string> tokenize_str(string const & data);
 vector<int> tokenize_int(string const & data);
 vector<double> tokenize_float(string const & data);
@@ -32,9 +32,14 @@
 
 #include "booksim.hpp"
 #include "credit.hpp"
+#include "simulation_globals.hpp"
 
-stack<Credit *> Credit::_all;
-stack<Credit *> Credit::_free;
+ObjectPool<Credit> Credit::_pool;
+
+// the pool is shared by all simulations in the process, so each one that
+// needs to know when its own credits have drained counts them separately
+static thread_local atomic<int> * tSimulationCredits = NULL;
+REGISTER_SIMULATION_GLOBAL(tSimulationCredits);
 
 Credit::Credit()
 {
@@ -50,30 +55,35 @@ void Credit::Reset()
 }
 
 Credit * Credit::New() {
-  Credit * c;
-  if(_free.empty()) {
-    c = new Credit();
-    _all.push(c);
-  } else {
-    c = _free.top();
-    c->Reset();
-    _free.pop();
+  Credit * const c = _pool.New();
+  c->Reset();
+  if(tSimulationCredits) {
+    tSimulationCredits->fetch_add(1, memory_order_relaxed);
   }
   return c;
 }
 
 void Credit::Free() {
-  _free.push(this);
+  if(tSimulationCredits) {
+    tSimulationCredits->fetch_sub(1, memory_order_relaxed);
+  }
+  _pool.Free(this);
 }
 
+// hands every credit back to the pool at once; their memory is kept around
+// for the next simulation
 void Credit::FreeAll() {
-  while(!_all.empty()) {
-    delete _all.top();
-    _all.pop();
-  }
+  _pool.Reset();
 }
 
-
 int Credit::OutStanding(){
-  return _all.size()-_free.size();
+  return _pool.OutStanding();
+}
+
+void Credit::CountOutStanding(atomic<int> * counter) {
+  tSimulationCredits = counter;
+}
+
+Credit * Credit::FromPoolIndex(int index) {
+  return _pool.Get(index);
 }
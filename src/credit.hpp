@@ -28,14 +28,56 @@
 #ifndef _CREDIT_HPP_
 #define _CREDIT_HPP_
 
-#include <set>
-#include <stack>
+#include <cassert>
+#include <atomic>
+
+#include "object_pool.hpp"
+
+// set of VCs returned by a credit, kept as a bitmask and iterated in
+// increasing order like a set<int>
+class VCMask {
+
+  unsigned long long _bits;
+
+public:
+
+  static int const MAX_VCS = 64;
+
+  class const_iterator {
+    unsigned long long _bits;
+  public:
+    const_iterator(unsigned long long bits) : _bits(bits) {}
+    inline int operator*() const { return __builtin_ctzll(_bits); }
+    inline const_iterator & operator++() { _bits &= _bits - 1; return *this; }
+    inline bool operator==(const_iterator const & other) const {
+      return _bits == other._bits;
+    }
+    inline bool operator!=(const_iterator const & other) const {
+      return _bits != other._bits;
+    }
+  };
+
+  VCMask() : _bits(0) {}
+
+  inline void insert(int vc) {
+    assert((vc >= 0) && (vc < MAX_VCS));
+    _bits |= 1ULL << vc;
+  }
+  inline void clear() { _bits = 0; }
+  inline bool empty() const { return !_bits; }
+  inline int size() const { return __builtin_popcountll(_bits); }
+  inline int count(int vc) const { return (_bits >> vc) & 1; }
+
+  inline const_iterator begin() const { return const_iterator(_bits); }
+  inline const_iterator end() const { return const_iterator(0); }
+
+};
 
 class Credit {
 
 public:
 
-  set<int> vc;
+  VCMask vc;
 
   // these are only used by the event router
   bool head, tail;
@@ -47,10 +89,20 @@ public:
   void Free();
   static void FreeAll();
   static int OutStanding();
+  // also count the credits of the calling thread's simulation here
+  static void CountOutStanding(atomic<int> * counter);
+
+  // position in the credit pool; stable for the lifetime of the simulator
+  inline int PoolIndex() const { return _pool_index; }
+  static Credit * FromPoolIndex(int index);
+
 private:
 
-  static stack<Credit *> _all;
-  static stack<Credit *> _free;
+  int _pool_index;
+
+  // routers stepped on different threads allocate credits concurrently
+  static ObjectPool<Credit> _pool;
+  friend class ObjectPool<Credit>;
 
   Credit();
   ~Credit() {}
@@ -37,8 +37,7 @@
 #include "booksim.hpp"
 #include "flit.hpp"
 
-stack<Flit *> Flit::_all;
-stack<Flit *> Flit::_free;
+ObjectPool<Flit> Flit::_pool;
 
 ostream& operator<<( ostream& os, const Flit& f )
 {
@@ -65,6 +64,7 @@ void Flit::Reset()
   cl        = -1 ;
   head      = false ;
   tail      = false ;
+  size      = 1 ;
   ctime     = -1 ;
   itime     = -1 ;
   atime     = -1 ;
@@ -76,6 +76,7 @@ void Flit::Reset()
   intm = 0;
   src = -1;
   dest = -1;
+  dests.clear();
   pri = 0;
   intm =-1;
   ph = -1;
@@ -83,25 +84,33 @@ void Flit::Reset()
 }  
 
 Flit * Flit::New() {
-  Flit * f;
-  if(_free.empty()) {
-    f = new Flit;
-    _all.push(f);
-  } else {
-    f = _free.top();
-    f->Reset();
-    _free.pop();
-  }
+  Flit * const f = _pool.New();
+  f->Reset();
+  return f;
+}
+
+Flit * Flit::Clone() const {
+  Flit * const f = _pool.New();
+  int const pool_index = f->_pool_index;
+  *f = *this;
+  f->_pool_index = pool_index;
   return f;
 }
 
 void Flit::Free() {
-  _free.push(this);
+  _pool.Free(this);
 }
 
+// hands every flit back to the pool at once; their memory is kept around
+// for the next simulation
 void Flit::FreeAll() {
-  while(!_all.empty()) {
-    delete _all.top();
-    _all.pop();
-  }
+  _pool.Reset();
+}
+
+int Flit::OutStanding() {
+  return _pool.OutStanding();
+}
+
+Flit * Flit::FromPoolIndex(int index) {
+  return _pool.Get(index);
 }
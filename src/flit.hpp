@@ -29,10 +29,11 @@
 #define _FLIT_HPP_
 
 #include <iostream>
-#include <stack>
+#include <vector>
 
 #include "booksim.hpp"
 #include "outputset.hpp"
+#include "object_pool.hpp"
 
 class Flit {
 
@@ -52,6 +53,10 @@ public:
 
   bool head;
   bool tail;
+
+  // number of flits this flit stands for (an abstract packet moves through
+  // the network as a single flit, and its body flits only add latency)
+  int  size;
   
   int  ctime;
   int  itime;
@@ -65,6 +70,9 @@ public:
   int  src;
   int  dest;
 
+  // destinations of a multicast head flit (empty for unicast packets)
+  vector<int> dests;
+
   int  pri;
 
   int  hops;
@@ -86,16 +94,26 @@ public:
   void Reset();
 
   static Flit * New();
+  // a new flit with the same contents (multicast packets are copied where
+  // their routes fork)
+  Flit * Clone() const;
   void Free();
   static void FreeAll();
+  static int OutStanding();
+
+  // position in the flit pool; stable for the lifetime of the simulator
+  inline int PoolIndex() const { return _pool_index; }
+  static Flit * FromPoolIndex(int index);
 
 private:
 
   Flit();
   ~Flit() {}
 
-  static stack<Flit *> _all;
-  static stack<Flit *> _free;
+  int _pool_index;
+
+  static ObjectPool<Flit> _pool;
+  friend class ObjectPool<Flit>;
 
 };
 
@@ -70,22 +70,28 @@ void FlitChannel::Send(Flit * f) {
   Channel<Flit>::Send(f);
 }
 
-void FlitChannel::ReadInputs() {
+void FlitChannel::ReadInputs(int time) {
   Flit const * const & f = _input;
   if(f && f->watch) {
-    *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+    *gWatchOut << time << " | " << FullName() << " | "
 	       << "Beginning channel traversal for flit " << f->id
 	       << " with delay " << _delay
 	       << "." << endl;
   }
-  Channel<Flit>::ReadInputs();
+  Channel<Flit>::ReadInputs(time);
 }
 
-void FlitChannel::WriteOutputs() {
-  Channel<Flit>::WriteOutputs();
+void FlitChannel::WriteOutputs(int time) {
+  Channel<Flit>::WriteOutputs(time);
   if(_output && _output->watch) {
-    *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+    *gWatchOut << time << " | " << FullName() << " | "
 	       << "Completed channel traversal for flit " << _output->id
 	       << "." << endl;
   }
 }
+
+void FlitChannel::Serialize(Checkpoint & cp) {
+  Channel<Flit>::Serialize(cp);
+  cp.Item(_active);
+  cp.Item(_idle);
+}
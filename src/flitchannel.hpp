@@ -75,8 +75,10 @@ public:
   // Send flit 
   virtual void Send(Flit * flit);
 
-  virtual void ReadInputs();
-  virtual void WriteOutputs();
+  virtual void ReadInputs(int time);
+  virtual void WriteOutputs(int time);
+
+  virtual void Serialize(Checkpoint & cp);
 
 private:
   
@@ -33,21 +33,29 @@
 
 /*all declared in main.cpp*/
 
+/*the variables are per simulation, see simulation_globals.hpp*/
+
 int GetSimTime();
 
 class Stats;
 Stats * GetStats(const std::string & name);
 
-extern bool gPrintActivity;
+class TrafficManager;
+extern thread_local TrafficManager * trafficManager;
+
+extern thread_local bool gPrintActivity;
+
+extern thread_local int gK;
+extern thread_local int gN;
+extern thread_local int gC;
 
-extern int gK;
-extern int gN;
-extern int gC;
+extern thread_local int gNodes;
 
-extern int gNodes;
+extern thread_local bool gTrace;
 
-extern bool gTrace;
+extern thread_local std::ostream * gWatchOut;
 
-extern std::ostream * gWatchOut;
+/*progress reports and statistics printed while simulating*/
+extern thread_local std::ostream * gProgressOut;
 
 #endif
@@ -0,0 +1,217 @@
+/*****************************************************
+ * Flat Hash Map for Flit and Packet IDs
+ *****************************************************
+ * Overview
+ *   - Maps non-negative IDs (flit or packet IDs) to values, using an
+ *     open-addressing table with linear probing and backward-shift
+ *     deletion, so lookups, insertions and removals do not allocate and
+ *     there are no tombstones to clean up.
+ *   - IDs are handed out sequentially and the ones in flight form a
+ *     sliding window, so the ID itself is used as the hash: a window
+ *     smaller than the table maps to distinct slots.
+ *   - Supports the subset of the std::map interface the traffic managers
+ *     use; iteration visits elements in table order, not in ID order.
+ */
+
+#ifndef _ID_MAP_HPP_
+#define _ID_MAP_HPP_
+
+#include <vector>
+#include <utility>
+#include <cassert>
+
+#include "booksim.hpp"
+
+class Checkpoint;
+
+template<typename T>
+class IdMap {
+
+public:
+
+  typedef pair<int, T> value_type;
+
+private:
+
+  template<typename V>
+  class _Iterator {
+    V * _slot;
+    V * _end;
+    inline void _Skip( ) {
+      while ( ( _slot != _end ) && ( _slot->first < 0 ) ) {
+	++_slot;
+      }
+    }
+  public:
+    _Iterator( ) : _slot( NULL ), _end( NULL ) { }
+    _Iterator( V * slot, V * end ) : _slot( slot ), _end( end ) { _Skip( ); }
+    template<typename W>
+    _Iterator( _Iterator<W> const & other )
+      : _slot( other._slot ), _end( other._end ) { }
+    inline V & operator*( ) const { return *_slot; }
+    inline V * operator->( ) const { return _slot; }
+    inline _Iterator & operator++( ) { ++_slot; _Skip( ); return *this; }
+    inline _Iterator operator++( int ) {
+      _Iterator const old = *this; ++*this; return old;
+    }
+    inline bool operator==( _Iterator const & other ) const {
+      return _slot == other._slot;
+    }
+    inline bool operator!=( _Iterator const & other ) const {
+      return _slot != other._slot;
+    }
+    template<typename W> friend class _Iterator;
+    friend class IdMap;
+  };
+
+public:
+
+  typedef _Iterator<value_type> iterator;
+  typedef _Iterator<value_type const> const_iterator;
+
+  IdMap( ) : _slots( MIN_CAPACITY, value_type( -1, T( ) ) ), _size( 0 ) { }
+
+  inline bool empty( ) const { return !_size; }
+  inline size_t size( ) const { return _size; }
+
+  void clear( ) {
+    _slots.assign( MIN_CAPACITY, value_type( -1, T( ) ) );
+    _size = 0;
+  }
+
+  void insert( value_type const & item );
+  size_t erase( int id );
+  void erase( iterator iter );
+
+  iterator find( int id ) {
+    size_t const slot = _Find( id );
+    return ( slot == NOT_FOUND ) ? end( ) : _At( slot );
+  }
+  const_iterator find( int id ) const {
+    size_t const slot = _Find( id );
+    return ( slot == NOT_FOUND ) ? end( ) : _At( slot );
+  }
+  inline size_t count( int id ) const { return ( _Find( id ) != NOT_FOUND ); }
+
+  inline iterator begin( ) { return _At( 0 ); }
+  inline iterator end( ) { return _At( _slots.size( ) ); }
+  inline const_iterator begin( ) const { return _At( 0 ); }
+  inline const_iterator end( ) const { return _At( _slots.size( ) ); }
+
+private:
+
+  static size_t const MIN_CAPACITY = 64;
+  static size_t const NOT_FOUND = (size_t)-1;
+
+  vector<value_type> _slots;
+  size_t _size;
+
+  inline size_t _Mask( ) const { return _slots.size( ) - 1; }
+
+  inline iterator _At( size_t slot ) {
+    value_type * const base = _slots.data( );
+    return iterator( base + slot, base + _slots.size( ) );
+  }
+  inline const_iterator _At( size_t slot ) const {
+    value_type const * const base = _slots.data( );
+    return const_iterator( base + slot, base + _slots.size( ) );
+  }
+
+  size_t _Find( int id ) const;
+  void _EraseSlot( size_t slot );
+  void _Grow( );
+
+  friend class Checkpoint;
+
+};
+
+template<typename T>
+size_t IdMap<T>::_Find( int id ) const
+{
+  assert( id >= 0 );
+  size_t const mask = _Mask( );
+  for ( size_t slot = id & mask; _slots[slot].first >= 0;
+	slot = ( slot + 1 ) & mask ) {
+    if ( _slots[slot].first == id ) {
+      return slot;
+    }
+  }
+  return NOT_FOUND;
+}
+
+template<typename T>
+void IdMap<T>::insert( value_type const & item )
+{
+  assert( item.first >= 0 );
+  if ( 2 * ( _size + 1 ) > _slots.size( ) ) {
+    _Grow( );
+  }
+  size_t const mask = _Mask( );
+  size_t slot = item.first & mask;
+  while ( _slots[slot].first >= 0 ) {
+    if ( _slots[slot].first == item.first ) {
+      return; // like std::map, keep the existing element
+    }
+    slot = ( slot + 1 ) & mask;
+  }
+  _slots[slot] = item;
+  ++_size;
+}
+
+template<typename T>
+size_t IdMap<T>::erase( int id )
+{
+  size_t const slot = _Find( id );
+  if ( slot == NOT_FOUND ) {
+    return 0;
+  }
+  _EraseSlot( slot );
+  return 1;
+}
+
+template<typename T>
+void IdMap<T>::erase( iterator iter )
+{
+  assert( iter != end( ) );
+  _EraseSlot( iter._slot - _slots.data( ) );
+}
+
+template<typename T>
+void IdMap<T>::_EraseSlot( size_t hole )
+{
+  // shift later elements of the probe sequence back into the hole unless
+  // that would move them in front of their home slot
+  size_t const mask = _Mask( );
+  size_t slot = hole;
+  while ( true ) {
+    slot = ( slot + 1 ) & mask;
+    if ( _slots[slot].first < 0 ) {
+      break;
+    }
+    size_t const home = _slots[slot].first & mask;
+    bool const stays = ( hole <= slot ) ?
+      ( ( hole < home ) && ( home <= slot ) ) :
+      ( ( hole < home ) || ( home <= slot ) );
+    if ( !stays ) {
+      _slots[hole] = _slots[slot];
+      hole = slot;
+    }
+  }
+  _slots[hole] = value_type( -1, T( ) );
+  --_size;
+}
+
+template<typename T>
+void IdMap<T>::_Grow( )
+{
+  vector<value_type> old( 2 * _slots.size( ), value_type( -1, T( ) ) );
+  old.swap( _slots );
+  _size = 0;
+  for ( size_t i = 0; i < old.size( ); ++i ) {
+    if ( old[i].first >= 0 ) {
+      insert( old[i] );
+    }
+  }
+}
+
+#endif
@@ -29,20 +29,37 @@
 #include <vector>
 #include <cassert>
 #include <limits>
+#include <cmath>
 #include "random_utils.hpp"
 #include "injection.hpp"
 
 using namespace std;
 
+int const InjectionProcess::NEVER = numeric_limits<int>::max() / 2;
+
+// number of failures before the first success in a series of trials that 
+// each succeed with the given probability
+static int Geometric(double p)
+{
+  if(p >= 1.0) {
+    return 0;
+  }
+  if(p <= 0.0) {
+    return InjectionProcess::NEVER;
+  }
+  double const n = floor(log(1.0 - RandomFloat()) / log(1.0 - p));
+  return (n < (double)InjectionProcess::NEVER) ? (int)n : InjectionProcess::NEVER;
+}
+
 InjectionProcess::InjectionProcess(int nodes, double rate)
   : _nodes(nodes), _rate(rate)
 {
   if(nodes <= 0) {
-    cout << "Error: Number of nodes must be greater than zero." << endl;
+    cerr << "Error: Number of nodes must be greater than zero." << endl;
     exit(-1);
   }
   if((rate < 0.0) || (rate > 1.0)) {
-    cout << "Error: Injection process must have load between 0.0 and 1.0."
+    cerr << "Error: Injection process must have load between 0.0 and 1.0."
 	 << endl;
     exit(-1);
   }
@@ -53,6 +70,15 @@ void InjectionProcess::reset()
 
 }
 
+int InjectionProcess::skip(int source)
+{
+  int n = 0;
+  while((n < NEVER) && !test(source)) {
+    ++n;
+  }
+  return n;
+}
+
 InjectionProcess * InjectionProcess::New(string const & inject, int nodes, 
 					 double load, 
 					 Configuration const * const config)
@@ -105,14 +131,14 @@ InjectionProcess * InjectionProcess::New(string const & inject, int nodes,
       r1 = atof(params[2].c_str());
     }
     if(missing_params) {
-      cout << "Missing parameters for injection process: " << inject << endl;
+      cerr << "Missing parameters for injection process: " << inject << endl;
       exit(-1);
     }
     if((alpha < 0.0 && beta < 0.0) || 
        (alpha < 0.0 && r1 < 0.0) || 
        (beta < 0.0 && r1 < 0.0) || 
        (alpha >= 0.0 && beta >= 0.0 && r1 >= 0.0)) {
-      cout << "Invalid parameters for injection process: " << inject << endl;
+      cerr << "Invalid parameters for injection process: " << inject << endl;
       exit(-1);
     }
     vector<int> initial(nodes);
@@ -126,7 +152,7 @@ InjectionProcess * InjectionProcess::New(string const & inject, int nodes,
     }
     result = new OnOffInjectionProcess(nodes, load, alpha, beta, r1, initial);
   } else {
-    cout << "Invalid injection process: " << inject << endl;
+    cerr << "Invalid injection process: " << inject << endl;
     exit(-1);
   }
   return result;
@@ -146,6 +172,12 @@ bool BernoulliInjectionProcess::test(int source)
   return (RandomFloat() < _rate);
 }
 
+int BernoulliInjectionProcess::skip(int source)
+{
+  assert((source >= 0) && (source < _nodes));
+  return Geometric(_rate);
+}
+
 //=============================================================
 
 OnOffInjectionProcess::OnOffInjectionProcess(int nodes, double rate, 
@@ -188,3 +220,42 @@ bool OnOffInjectionProcess::test(int source)
   // generate packet
   return _state[source] && (RandomFloat() < _r1);
 }
+
+int OnOffInjectionProcess::skip(int source)
+{
+  assert((source >= 0) && (source < _nodes));
+
+  // each cycle, an off source turns on with probability alpha, while an on 
+  // source turns off with probability beta; a source that is on after the 
+  // transition injects with probability r1
+  double const p_inject = (1.0 - _beta) * _r1;
+  double const p_leave_on = _beta + p_inject;
+  int n = 0;
+  while(true) {
+    if(_state[source]) {
+      n += Geometric(p_leave_on);
+      if(n >= NEVER) {
+	return NEVER;
+      }
+      if(RandomFloat(p_leave_on) < p_inject) {
+	return n;
+      }
+      _state[source] = 0;
+    } else {
+      n += Geometric(_alpha);
+      if(n >= NEVER) {
+	return NEVER;
+      }
+      _state[source] = 1;
+      if(RandomFloat() < _r1) {
+	return n;
+      }
+    }
+    ++n;
+  }
+}
+
+void OnOffInjectionProcess::Serialize(Checkpoint & cp)
+{
+  cp.Item(_state);
+}
@@ -29,6 +29,7 @@
 #define _INJECTION_HPP_
 
 #include "config_utils.hpp"
+#include "checkpoint.hpp"
 
 using namespace std;
 
@@ -38,9 +39,16 @@ protected:
   double _rate;
   InjectionProcess(int nodes, double rate);
 public:
+  // returned by skip if the source never injects again
+  static int const NEVER;
   virtual ~InjectionProcess() {}
   virtual bool test(int source) = 0;
+  // number of cycles without an injection before the next one, i.e. the 
+  // number of calls to test that would fail before one succeeds; leaves the
+  // process in the state that the successful call would
+  virtual int skip(int source);
   virtual void reset();
+  virtual void Serialize(Checkpoint & cp) {}
   static InjectionProcess * New(string const & inject, int nodes, double load, 
 				Configuration const * const config = NULL);
 };
@@ -49,6 +57,7 @@ class BernoulliInjectionProcess : public InjectionProcess {
 public:
   BernoulliInjectionProcess(int nodes, double rate);
   virtual bool test(int source);
+  virtual int skip(int source);
 };
 
 class OnOffInjectionProcess : public InjectionProcess {
@@ -63,6 +72,8 @@ public:
 			double r1, vector<int> initial);
   virtual void reset();
   virtual bool test(int source);
+  virtual int skip(int source);
+  virtual void Serialize(Checkpoint & cp);
 };
 
 #endif 
@@ -0,0 +1,107 @@
+/*****************************************************
+ * In-Process Injection Rate Sweep
+ *****************************************************
+ * Overview
+ *   - Threads pull points off a shared counter, so a slow point near
+ *     saturation does not hold back the remaining ones.
+ */
+
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cassert>
+
+#include "load_sweep.hpp"
+#include "globals.hpp"
+#include "routefunc.hpp"
+#include "random_utils.hpp"
+#include "network.hpp"
+#include "trafficmanager.hpp"
+
+static mutex gSetupMutex;
+
+class NullBuffer : public streambuf {
+protected:
+  virtual int overflow( int c ) { return c; }
+};
+
+static void RunPoint( BookSimConfig const & base, LoadSweepPoint & point )
+{
+  BookSimConfig config( base );
+  // the string form (per-class rates) takes precedence over the number
+  config.Assign( "injection_rate", string( "" ) );
+  config.Assign( "injection_rate", point.injection_rate );
+
+  // the traffic manager seeds it just like in a standalone run
+  RandomState random_state;
+  gRandomState = &random_state;
+
+  gPrintActivity = ( config.GetInt( "print_activity" ) > 0 );
+  gTrace = ( config.GetInt( "viewer_trace" ) > 0 );
+  gWatchOut = NULL;
+
+  // the progress reports of concurrent points would interleave
+  NullBuffer null_buffer;
+  ostream null_out( &null_buffer );
+  gProgressOut = &null_out;
+
+  int const subnets = config.GetInt( "subnets" );
+  vector<Network *> net( subnets );
+  {
+    lock_guard<mutex> lock( gSetupMutex );
+    InitializeRoutingMap( config );
+    for ( int i = 0; i < subnets; ++i ) {
+      ostringstream name;
+      name << "network_" << i;
+      net[i] = Network::New( config, name.str( ) );
+    }
+    assert( trafficManager == NULL );
+    trafficManager = TrafficManager::New( config, net );
+  }
+
+  point.stable = trafficManager->Run( );
+  if ( point.stable ) {
+    ostringstream csv;
+    trafficManager->DisplayOverallStatsCSV( csv );
+    point.csv = csv.str( );
+  }
+
+  for ( int i = 0; i < subnets; ++i ) {
+    delete net[i];
+  }
+  delete trafficManager;
+  trafficManager = NULL;
+  gRandomState = NULL;
+  gProgressOut = &cout;
+}
+
+vector<LoadSweepPoint> RunLoadSweep( BookSimConfig const & config,
+				     vector<double> const & rates,
+				     int threads )
+{
+  assert( threads >= 1 );
+  vector<LoadSweepPoint> points( rates.size( ) );
+  for ( size_t p = 0; p < rates.size( ); ++p ) {
+    points[p].injection_rate = rates[p];
+    points[p].stable = false;
+  }
+
+  atomic<size_t> next( 0 );
+  auto worker = [&]( ) {
+    size_t p;
+    while ( ( p = next++ ) < points.size( ) ) {
+      RunPoint( config, points[p] );
+    }
+  };
+  vector<thread> workers;
+  for ( int t = 0; ( t < threads ) && ( t < (int)points.size( ) ); ++t ) {
+    workers.push_back( thread( worker ) );
+  }
+  for ( size_t t = 0; t < workers.size( ); ++t ) {
+    workers[t].join( );
+  }
+
+  return points;
+}
@@ -0,0 +1,43 @@
+/*****************************************************
+ * In-Process Injection Rate Sweep
+ *****************************************************
+ * Overview
+ *   - Runs one simulation per injection rate, each on its own thread with
+ *     its own networks, traffic manager and random number generator, so
+ *     the points of a latency/throughput curve are simulated concurrently
+ *     from a single parsed configuration.
+ *   - Every point is seeded exactly like a standalone run of the same
+ *     configuration, so its results do not depend on the thread count.
+ *   - Setting up a point touches the process-wide routing function maps
+ *     and is therefore serialized; the simulations themselves are not.
+ *   - The simulators' progress reports of concurrent points would
+ *     interleave, so each point sends them (gProgressOut) nowhere; error
+ *     messages still go to cerr. Watch output and power analysis are not
+ *     supported.
+ *
+ * API Description
+ *   - RunLoadSweep:        simulate the given rates using at most the given
+ *                          number of threads; points are returned in the
+ *                          order of the rates
+ */
+
+#ifndef _LOAD_SWEEP_HPP_
+#define _LOAD_SWEEP_HPP_
+
+#include <vector>
+#include <string>
+
+#include "booksim.hpp"
+#include "booksim_config.hpp"
+
+struct LoadSweepPoint {
+  double injection_rate;
+  bool   stable;    // false if the simulation gave up (e.g. saturated)
+  string csv;       // the print_csv_results rows of stable points
+};
+
+vector<LoadSweepPoint> RunLoadSweep( BookSimConfig const & config,
+				     vector<double> const & rates,
+				     int threads );
+
+#endif
@@ -53,6 +53,7 @@
 #include "network.hpp"
 #include "injection.hpp"
 #include "power_module.hpp"
+#include "simulation_globals.hpp"
 
 
 
@@ -61,7 +62,8 @@
 //////////////////////
 
  /* the current traffic manager instance */
-TrafficManager * trafficManager = NULL;
+thread_local TrafficManager * trafficManager = NULL;
+REGISTER_SIMULATION_GLOBAL(trafficManager);
 
 int GetSimTime() {
   return trafficManager->getTime();
@@ -77,18 +79,28 @@ Stats * GetStats(const std::string & name) {
 }
 
 /* printing activity factor*/
-bool gPrintActivity;
+thread_local bool gPrintActivity;
+REGISTER_SIMULATION_GLOBAL(gPrintActivity);
 
-int gK;//radix
-int gN;//dimension
-int gC;//concentration
+thread_local int gK;//radix
+thread_local int gN;//dimension
+thread_local int gC;//concentration
+REGISTER_SIMULATION_GLOBAL(gK);
+REGISTER_SIMULATION_GLOBAL(gN);
+REGISTER_SIMULATION_GLOBAL(gC);
 
-int gNodes;
+thread_local int gNodes;
+REGISTER_SIMULATION_GLOBAL(gNodes);
 
 //generate nocviewer trace
-bool gTrace;
+thread_local bool gTrace;
+REGISTER_SIMULATION_GLOBAL(gTrace);
 
-ostream * gWatchOut;
+thread_local ostream * gWatchOut;
+REGISTER_SIMULATION_GLOBAL(gWatchOut);
+
+thread_local ostream * gProgressOut = &cout;
+REGISTER_SIMULATION_GLOBAL(gProgressOut);
 
 
 
@@ -73,7 +73,7 @@ void Module::DisplayHierarchy( int level, ostream & os ) const
 
 void Module::Error( const string& msg ) const
 {
-  cout << "Error in " << _fullname << " : " << msg << endl;
+  cerr << "Error in " << _fullname << " : " << msg << endl;
   exit( -1 );
 }
 
@@ -0,0 +1,324 @@
+/*****************************************************
+ * Binary Packet Trace for NeuroMTA 
+ *****************************************************
+ * Overview
+ *   - The recorder writes through stdio, so recording costs a copy into
+ *     the stream buffer per call; the replay reads the records straight
+ *     out of the mapped file.
+ *   - Replayed packets get consecutive PIDs just like the recorded ones,
+ *     so a packet's recorded handling delay is found by its position in
+ *     the trace (and, for multicast packets, the handling node).
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <queue>
+#include <functional>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+
+#include "mta_trace.hpp"
+
+static const char MTA_TRACE_MAGIC[8] = {'B', 'S', 'M', 'T', 'A', 'T', 'R', 'C'};
+
+static size_t PaddedPayloadSize(const int payload_size)
+{
+    return (payload_size + 7) & ~(size_t)7;
+}
+
+static size_t PaddedDestinationsSize(const int num_dests)
+{
+    return PaddedPayloadSize(num_dests * sizeof(int32_t));
+}
+
+static void TraceError(const string &filename, const string &msg)
+{
+    cerr << "Error in MTA trace " << filename << " : " << msg << endl;
+    exit(-1);
+}
+
+// replaying must not record over the trace it reads
+static Configuration WithoutRecording(const Configuration &config)
+{
+    Configuration copy(config);
+    copy.Assign("mta_trace_out", string(""));
+    return copy;
+}
+
+
+/*****************************************************
+ * Trace Recorder for NeuroMTA 
+ *****************************************************/
+
+MTATraceWriter::MTATraceWriter(const string &filename)
+{
+    _file = fopen(filename.c_str(), "wb");
+    if (!_file)
+        TraceError(filename, "unable to open the file for writing");
+
+    MTATraceHeader header;
+    memcpy(header.magic, MTA_TRACE_MAGIC, sizeof(header.magic));
+    header.version = MTATraceHeader::VERSION;
+    header.record_size = sizeof(MTATraceRecord);
+    _Write(&header, sizeof(header));
+}
+
+MTATraceWriter::~MTATraceWriter()
+{
+    fclose(_file);
+}
+
+void MTATraceWriter::_Write(const void *data, size_t size)
+{
+    if (size && fwrite(data, size, 1, _file) != 1) {
+        cerr << "Error in MTA trace : write failed" << endl;
+        exit(-1);
+    }
+}
+
+void MTATraceWriter::RecordSend(const int cycle, const int pid, const int src_id, const int dst_id, const int subnet, const MTAPacketDescriptor &packet_desc)
+{
+    MTATraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind         = MTATraceRecord::SEND;
+    record.packet_type  = packet_desc.packet_type;
+    record.flit_type    = packet_desc.flit_type;
+    record.cycle        = cycle;
+    record.pid          = pid;
+    record.src          = src_id;
+    record.dst          = dst_id;
+    record.subnet       = subnet;
+    record.packet_size  = packet_desc.packet_size;
+    record.payload_size = packet_desc.payload_size;
+    _Write(&record, sizeof(record));
+
+    static const char padding[8] = {0};
+    _Write(packet_desc.payload, packet_desc.payload_size);
+    _Write(padding, PaddedPayloadSize(packet_desc.payload_size) - packet_desc.payload_size);
+}
+
+void MTATraceWriter::RecordMulticastSend(const int cycle, const int pid, const int src_id, const vector<int> &dst_ids, const int subnet, const MTAPacketDescriptor &packet_desc)
+{
+    MTATraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind         = MTATraceRecord::MULTICAST_SEND;
+    record.packet_type  = packet_desc.packet_type;
+    record.flit_type    = packet_desc.flit_type;
+    record.cycle        = cycle;
+    record.pid          = pid;
+    record.src          = src_id;
+    record.dst          = dst_ids.size();
+    record.subnet       = subnet;
+    record.packet_size  = packet_desc.packet_size;
+    record.payload_size = packet_desc.payload_size;
+    _Write(&record, sizeof(record));
+
+    static const char padding[8] = {0};
+    _Write(packet_desc.payload, packet_desc.payload_size);
+    _Write(padding, PaddedPayloadSize(packet_desc.payload_size) - packet_desc.payload_size);
+
+    vector<int32_t> dests(dst_ids.begin(), dst_ids.end());
+    dests.resize(PaddedDestinationsSize(dests.size()) / sizeof(int32_t), 0);
+    _Write(dests.data(), dests.size() * sizeof(int32_t));
+}
+
+void MTATraceWriter::RecordHandle(const int cycle, const int pid, const int node_id, const int delay)
+{
+    MTATraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind  = MTATraceRecord::HANDLE;
+    record.cycle = cycle;
+    record.pid   = pid;
+    record.dst   = node_id;
+    record.delay = delay;
+    _Write(&record, sizeof(record));
+}
+
+
+/*****************************************************
+ * Trace Replay for NeuroMTA 
+ *****************************************************/
+
+MTATraceReplay::MTATraceReplay(const Configuration &config, const vector<Network *> &net, const string &filename)
+    : _tfm_if(WithoutRecording(config), net), _data(NULL), _size(0), _first(sizeof(MTATraceHeader)), _num_packets(0), _first_pid(-1)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        TraceError(filename, "unable to open the file");
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        TraceError(filename, "unable to get the file size");
+    _size = st.st_size;
+    if (_size < sizeof(MTATraceHeader))
+        TraceError(filename, "missing header");
+    void *const data = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        TraceError(filename, "unable to map the file");
+    _data = (const char *)data;
+    madvise(data, _size, MADV_SEQUENTIAL);
+
+    const MTATraceHeader *const header = (const MTATraceHeader *)_data;
+    if (memcmp(header->magic, MTA_TRACE_MAGIC, sizeof(header->magic)) != 0)
+        TraceError(filename, "not an MTA trace");
+    if (header->version < 1 || header->version > MTATraceHeader::VERSION || header->record_size != sizeof(MTATraceRecord))
+        TraceError(filename, "unsupported trace version");
+
+    // index the handling delays by packet and check that the records are
+    // complete before replaying any of them
+    vector<bool> multicast;
+    for (size_t pos = _first; pos < _size; pos = _NextRecord(pos)) {
+        if (_size - pos < sizeof(MTATraceRecord))
+            TraceError(filename, "truncated record");
+        const MTATraceRecord &record = _RecordAt(pos);
+        if (record.kind == MTATraceRecord::SEND || record.kind == MTATraceRecord::MULTICAST_SEND) {
+            size_t data_size = PaddedPayloadSize(record.payload_size);
+            if (record.kind == MTATraceRecord::MULTICAST_SEND) {
+                if (record.dst < 1)
+                    TraceError(filename, "multicast packet without destinations");
+                data_size += PaddedDestinationsSize(record.dst);
+            }
+            if (_size - pos - sizeof(MTATraceRecord) < data_size)
+                TraceError(filename, "truncated payload");
+            multicast.push_back(record.kind == MTATraceRecord::MULTICAST_SEND);
+            if (_first_pid < 0)
+                _first_pid = record.pid;
+            if (record.pid != _first_pid + _num_packets)
+                TraceError(filename, "packets are not recorded in PID order");
+            ++_num_packets;
+        } else if (record.kind == MTATraceRecord::HANDLE) {
+            const int packet = record.pid - _first_pid;
+            if (_first_pid < 0 || packet < 0 || packet >= _num_packets)
+                TraceError(filename, "handled packet was never sent");
+            if (multicast[packet]) {
+                _multicast_delays[make_pair(packet, record.dst)] = record.delay;
+                continue;
+            }
+            if ((int)_delays.size() < _num_packets)
+                _delays.resize(_num_packets, -1);
+            _delays[packet] = record.delay;
+        } else {
+            TraceError(filename, "unknown record kind");
+        }
+    }
+    _delays.resize(_num_packets, -1);
+}
+
+MTATraceReplay::~MTATraceReplay()
+{
+    munmap((void *)_data, _size);
+}
+
+const MTATraceRecord &MTATraceReplay::_RecordAt(size_t pos) const
+{
+    return *(const MTATraceRecord *)(_data + pos);
+}
+
+size_t MTATraceReplay::_NextRecord(size_t pos) const
+{
+    const MTATraceRecord &record = _RecordAt(pos);
+    pos += sizeof(MTATraceRecord);
+    if (record.kind == MTATraceRecord::SEND)
+        pos += PaddedPayloadSize(record.payload_size);
+    else if (record.kind == MTATraceRecord::MULTICAST_SEND)
+        pos += PaddedPayloadSize(record.payload_size) + PaddedDestinationsSize(record.dst);
+    return pos;
+}
+
+int  MTATraceReplay::_Delay(const int packet, const int node) const
+{
+    if (!_multicast_delays.empty()) {
+        map<pair<int, int>, int>::const_iterator iter = _multicast_delays.find(make_pair(packet, node));
+        if (iter != _multicast_delays.end())
+            return iter->second;
+    }
+    return _delays[packet];
+}
+
+int  MTATraceReplay::Run(bool use_handle_delays)
+{
+    // destinations waiting for their packet to be handled, by cycle
+    typedef pair<int, int> due_t;   // (cycle, node)
+    priority_queue<due_t, vector<due_t>, greater<due_t>> due;
+    vector<MTACompletion> completions;
+
+    size_t pos = _first;
+    int first_pid = -1;
+    int last_time = _tfm_if.GetTime();
+
+    while (true) {
+        const int now = _tfm_if.GetTime();
+
+        while (!due.empty() && due.top().first <= now) {
+            _tfm_if.HandlePacket(due.top().second);
+            last_time = now;
+            due.pop();
+        }
+
+        while (pos < _size) {
+            const MTATraceRecord &record = _RecordAt(pos);
+            if (record.kind == MTATraceRecord::SEND || record.kind == MTATraceRecord::MULTICAST_SEND) {
+                if (record.cycle > now)
+                    break;
+                const char *const payload = (const char *)&record + sizeof(MTATraceRecord);
+                MTAPacketDescriptor packet_desc((MTAPacketDescriptor::PacketType)record.packet_type, record.packet_size,
+                                                (Flit::FlitType)record.flit_type, payload, record.payload_size);
+                int pid;
+                if (record.kind == MTATraceRecord::SEND) {
+                    pid = _tfm_if.SendPacket(record.src, record.dst, record.subnet, std::move(packet_desc));
+                } else {
+                    const int32_t *const dests = (const int32_t *)(payload + PaddedPayloadSize(record.payload_size));
+                    pid = _tfm_if.SendMulticastPacket(record.src, vector<int>(dests, dests + record.dst), record.subnet, std::move(packet_desc));
+                }
+                if (first_pid < 0)
+                    first_pid = pid;
+            }
+            pos = _NextRecord(pos);
+        }
+
+        const bool quiescent = _tfm_if.IsQuiescent();
+        if (quiescent && due.empty() && pos >= _size)
+            break;
+
+        if (quiescent) {
+            // nothing moves until the next packet is sent or handled
+            int target = (pos < _size) ? _RecordAt(pos).cycle : numeric_limits<int>::max();
+            if (!due.empty() && due.top().first < target)
+                target = due.top().first;
+            if (target > now) {
+                _tfm_if.StepUntil(target);
+                continue;
+            }
+        }
+
+        _tfm_if.Step();
+
+        _tfm_if.PollCompletions(completions);
+        for (size_t i = 0; i < completions.size(); ++i) {
+            const MTACompletion &completion = completions[i];
+            int delay = use_handle_delays ? _Delay(completion.pid - first_pid, completion.node_id) : -1;
+            // the host sees a packet only once the step that received it
+            // is over
+            if (delay < 1)
+                delay = 1;
+            due.push(make_pair(now + delay, completion.node_id));
+        }
+    }
+
+    return last_time;
+}
+
+int  MTATraceReplay::NumPackets() const
+{
+    return _num_packets;
+}
+
+MTATrafficManagerInterface &MTATraceReplay::GetInterface()
+{
+    return _tfm_if;
+}
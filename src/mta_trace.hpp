@@ -0,0 +1,145 @@
+#ifndef _MTA_TRACE_HPP_
+#define _MTA_TRACE_HPP_
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "booksim.hpp"
+#include "config_utils.hpp"
+#include "network.hpp"
+#include "mta_trafficmanager.hpp"
+
+
+/*****************************************************
+ * Binary Packet Trace for NeuroMTA 
+ *****************************************************
+ * Overview
+ *   - A trace is a header followed by fixed-size records in the order
+ *     of the calls they were taken from. Each SendPacket call adds a
+ *     SEND record, followed by the payload of the packet (padded to
+ *     8 bytes), and each HandlePacket call of a received packet adds a
+ *     HANDLE record with the number of cycles the packet waited at its
+ *     destination before the host handled it.
+ *   - SendMulticastPacket calls add a MULTICAST_SEND record instead, which
+ *     stores the number of destinations in dst and is followed by the
+ *     payload and then the destinations (int32_t each, padded to 8 bytes).
+ *     Each destination that handles the packet adds its own HANDLE record.
+ *   - Records are stored in host byte order; traces are meant to be
+ *     replayed on the machine that recorded them.
+ *   - The interface records a trace when the mta_trace_out option
+ *     names a file.
+ */
+
+struct MTATraceHeader
+{
+    static const uint32_t VERSION = 2;     // version 1 had no multicasts
+
+    char     magic[8];      // "BSMTATRC"
+    uint32_t version;
+    uint32_t record_size;   // sizeof(MTATraceRecord)
+};
+
+struct MTATraceRecord
+{
+    enum Kind {
+        SEND            = 0,
+        HANDLE          = 1,
+        MULTICAST_SEND  = 2
+    };
+
+    uint8_t  kind;
+    uint8_t  packet_type;   // MTAPacketDescriptor::PacketType (SENDs only)
+    uint8_t  flit_type;     // Flit::FlitType (SENDs only)
+    uint8_t  reserved;
+    int32_t  cycle;         // time of the call
+    int32_t  pid;
+    int32_t  src;           // SENDs: source node
+    int32_t  dst;           // SEND: destination node, MULTICAST_SEND: number
+                            // of destinations, HANDLE: handling node
+    int32_t  subnet;        // SENDs only
+    int32_t  packet_size;   // SENDs only
+    int32_t  payload_size;  // SENDs only
+    int32_t  delay;         // HANDLE: cycles from reception to handling
+    int32_t  reserved2;
+};
+
+
+/*****************************************************
+ * Trace Recorder for NeuroMTA 
+ *****************************************************
+ * API Description
+ *   - RecordSend:          append a SEND record and the packet payload
+ *   - RecordMulticastSend: append a MULTICAST_SEND record, the packet
+ *                          payload and the destinations
+ *   - RecordHandle:        append a HANDLE record
+ */
+
+class MTATraceWriter
+{
+private:
+    FILE *_file;
+
+    void _Write(const void *data, size_t size);
+
+public:
+    MTATraceWriter(const string &filename);
+    ~MTATraceWriter();
+
+    void RecordSend(const int cycle, const int pid, const int src_id, const int dst_id, const int subnet, const MTAPacketDescriptor &packet_desc);
+    void RecordMulticastSend(const int cycle, const int pid, const int src_id, const vector<int> &dst_ids, const int subnet, const MTAPacketDescriptor &packet_desc);
+    void RecordHandle(const int cycle, const int pid, const int node_id, const int delay);
+};
+
+
+/*****************************************************
+ * Trace Replay for NeuroMTA 
+ *****************************************************
+ * Overview
+ *   - Maps a recorded trace into memory and plays its packets into a
+ *     fresh traffic manager interface at their recorded cycles, so the
+ *     networks can be re-evaluated without running the host model.
+ *   - Received packets are handled by the replay. When the recorded
+ *     handling delays are used, each destination stays busy for as long
+ *     as it did in the recorded run, which reproduces the back-pressure
+ *     of the host; otherwise packets are handled right away.
+ *   - Packets are issued through SendPacket (or SendMulticastPacket), so
+ *     the interface's own bookkeeping stays the same as in a live run.
+ * 
+ * API Description
+ *   - Run:                 replay the whole trace and return the cycle at
+ *                          which the last packet was handled
+ *   - NumPackets:          number of packets in the trace
+ *   - GetInterface:        the interface the trace is played into (e.g. to
+ *                          read its traffic manager's time afterwards)
+ */
+
+class MTATraceReplay
+{
+private:
+    MTATrafficManagerInterface  _tfm_if;
+
+    const char                 *_data;      // mapped trace
+    size_t                      _size;
+    size_t                      _first;     // offset of the first record
+    int                         _num_packets;
+    int                         _first_pid; // recorded PID of the first packet
+    vector<int>                 _delays;    // handling delay by packet (-1 if unknown)
+    map<pair<int, int>, int>    _multicast_delays;  // by (packet, destination)
+
+    size_t _NextRecord(size_t pos) const;
+    const MTATraceRecord &_RecordAt(size_t pos) const;
+    int _Delay(const int packet, const int node) const;
+
+public:
+    MTATraceReplay(const Configuration &config, const vector<Network *> &net, const string &filename);
+    ~MTATraceReplay();
+
+    int  Run(bool use_handle_delays = true);
+    int  NumPackets() const;
+    MTATrafficManagerInterface &GetInterface();
+};
+
+#endif
@@ -23,13 +23,23 @@
  *   _GeneratePacket:   this function is an interface to create a packet
  *   _Step:             this function defines a single cycle operation of
  *                      the interconnect networks
+ * 
+ * Additional Methods
+ *   _Quiescent:        returns a flag indicating whether there is no flit
+ *                      left in the input queues, routers and channels
+ *   _AdvanceIdle:      skips the given number of cycles at once while the
+ *                      interconnect networks are quiescent
  */
 
 #include <sstream>
 #include <fstream>
 #include <limits>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
 
 #include "mta_trafficmanager.hpp"
+#include "mta_trace.hpp"
 #include "globals.hpp"
 
 
@@ -39,6 +49,15 @@ MTATrafficManager::MTATrafficManager(const Configuration &config, const vector<N
     // The total simulations equal to number of kernels
     _total_sims = 0;
 
+    // There is no warm-up phase driven by _SingleSim; statistics are
+    // collected from the first cycle on
+    _sim_state = warming_up;
+
+    // the routers read the clock through the current traffic manager, which
+    // the host has no other way to install
+    if (!trafficManager)
+        trafficManager = this;
+
     _input_queue.resize(_subnets);
     for (int subnet = 0; subnet < _subnets; ++subnet)
     {
@@ -48,23 +67,69 @@ MTATrafficManager::MTATrafficManager(const Configuration &config, const vector<N
             _input_queue[subnet][node].resize(_classes);
         }
     }
+
+    _ni_eject_buf_size = config.GetInt("ni_eject_buf_size");
+    if (_ni_eject_buf_size < 0)
+        Error("ni_eject_buf_size must not be negative.");
+    _ni_buffered.resize(_subnets, vector<int>(_nodes, 0));
+    _ni_vc_flits.resize(_subnets, vector<vector<int>>(_nodes, vector<int>(_vcs, 0)));
+    _ni_held_credits.resize(_subnets, vector<deque<int>>(_nodes));
+    _ni_credits.resize(_subnets, vector<deque<int>>(_nodes));
+    _ni_ready.resize(_nodes);
+    _ni_ready_packets = 0;
+    _ni_queued_credits = 0;
+    _ni_occupancy_stats = NULL;
+    _ni_wait_stats = NULL;
+    if (_ni_eject_buf_size > 0) {
+        _ni_occupancy_stats = new Stats(this, "ni_eject_occupancy", 1.0, 1000);
+        _stats["ni_eject_occupancy"] = _ni_occupancy_stats;
+        _ni_wait_stats = new Stats(this, "ni_eject_wait", 1.0, 1000);
+        _stats["ni_eject_wait"] = _ni_wait_stats;
+    }
+
+    _abstract_packet_size = config.GetInt("abstract_packet_size");
+    if (_abstract_packet_size < 0)
+        Error("abstract_packet_size must not be negative.");
+    if (_abstract_packet_size > 0) {
+        if (config.GetStr("router") != "iq" || config.GetInt("output_speedup") != 1)
+            Error("Abstract packets require IQRouters without output speedup.");
+        _ni_inject_busy.resize(_subnets, vector<int>(_nodes, 0));
+        _ni_arriving.resize(_subnets, vector<Flit *>(_nodes, NULL));
+        _ni_arrival_time.resize(_subnets, vector<int>(_nodes, 0));
+    }
 }
 
 MTATrafficManager::~MTATrafficManager()
 {
+    if (trafficManager == this)
+        trafficManager = NULL;
+    delete _ni_occupancy_stats;
+    delete _ni_wait_stats;
 }
 
 void MTATrafficManager::_RetireFlit(Flit *f, int dest)
 {
     _deadlock_timer = 0;
 
-    assert(_total_in_flight_flits[f->cl].count(f->id) > 0);
-    _total_in_flight_flits[f->cl].erase(f->id);
+    // the copies of a multicast packet are accounted for by packet
+    map<int, int>::iterator const mc = _mc_pending.empty() ? _mc_pending.end() : _mc_pending.find(f->pid);
+    bool const multicast = (mc != _mc_pending.end());
 
-    if (f->record)
+    if (multicast)
     {
-        assert(_measured_in_flight_flits[f->cl].count(f->id) > 0);
-        _measured_in_flight_flits[f->cl].erase(f->id);
+        if (--mc->second == 0)
+            _mc_pending.erase(mc);
+    }
+    else
+    {
+        assert(_total_in_flight_flits[f->cl].count(f->id) > 0);
+        _total_in_flight_flits[f->cl].erase(f->id);
+
+        if (f->record)
+        {
+            assert(_measured_in_flight_flits[f->cl].count(f->id) > 0);
+            _measured_in_flight_flits[f->cl].erase(f->id);
+        }
     }
 
     if (f->head && (f->dest != dest))
@@ -90,9 +155,17 @@ void MTATrafficManager::_RetireFlit(Flit *f, int dest)
         {
             head = f;
         }
+        else if (multicast)
+        {
+            map<pair<int, int>, Flit *>::iterator iter = _mc_retired_heads.find(make_pair(f->pid, dest));
+            assert(iter != _mc_retired_heads.end());
+            head = iter->second;
+            _mc_retired_heads.erase(iter);
+            assert(head->head);
+        }
         else
         {
-            map<int, Flit *>::iterator iter = _retired_packets[f->cl].find(f->pid);
+            IdMap<Flit *>::iterator iter = _retired_packets[f->cl].find(f->pid);
             assert(iter != _retired_packets[f->cl].end());
             head = iter->second;
             _retired_packets[f->cl].erase(iter);
@@ -152,7 +225,10 @@ void MTATrafficManager::_RetireFlit(Flit *f, int dest)
 
     if (f->head && !f->tail)
     {
-        _retired_packets[f->cl].insert(make_pair(f->pid, f));
+        if (multicast)
+            _mc_retired_heads.insert(make_pair(make_pair(f->pid, dest), f));
+        else
+            _retired_packets[f->cl].insert(make_pair(f->pid, f));
     }
     else
     {
@@ -165,26 +241,51 @@ int MTATrafficManager::_GeneratePacket(int source, int stype, int cl, int time,
 {
     assert(stype != 0);
 
+    if ((dest < 0) || (dest >= _nodes)) {
+        ostringstream err;
+        err << "Incorrect packet destination " << dest
+            << " for stype " << packet_type;
+        Error(err.str());
+    }
+
+    return _GenerateFlits(source, cl, time, subnet, packet_size, packet_type, data, dest, NULL);
+}
+
+// dests must be sorted, without duplicates
+int MTATrafficManager::_GenerateMulticastPacket(int source, int cl, int time, int subnet, int packet_size, const Flit::FlitType &packet_type, const vector<int> &dests)
+{
+    if (_lookahead_routing)
+        Error("Multicast packets do not support lookahead routing.");
+    if (dests.size() < 2 || dests.front() < 0 || dests.back() >= _nodes ||
+        adjacent_find(dests.begin(), dests.end()) != dests.end()) {
+        ostringstream err;
+        err << "Incorrect multicast destinations for a packet from " << source;
+        Error(err.str());
+    }
+
+    const int pid = _GenerateFlits(source, cl, time, subnet, packet_size, packet_type, NULL, -1, &dests);
+    const bool abstract = (_abstract_packet_size > 0) && (packet_size >= _abstract_packet_size);
+    _mc_pending.insert(make_pair(pid, (abstract ? 1 : packet_size) * (int)dests.size()));
+    return pid;
+}
+
+int MTATrafficManager::_GenerateFlits(int source, int cl, int time, int subnet, int packet_size, const Flit::FlitType &packet_type, void *const data, int dest, const vector<int> *dests)
+{
     int size = packet_size; // input size
+    // an abstract packet is a single flit that stands for all of them
+    const bool abstract = (_abstract_packet_size > 0) && (size >= _abstract_packet_size);
     unsigned long long pid = _cur_pid++;
     assert(_cur_pid > 0);
     int packet_destination = dest;
     bool record = false;
 
-    if ((packet_destination < 0) || (packet_destination >= _nodes)) {
-        ostringstream err;
-        err << "Incorrect packet destination " << packet_destination
-            << " for stype " << packet_type;
-        Error(err.str());
-    }
-
     if ((_sim_state == running) || ((_sim_state == draining) && (time < _drain_time))) {
         record = _measure_stats[cl];
     }
 
     int subnetwork = subnet;
 
-    for (int i = 0; i < size; ++i) {
+    for (int i = 0; i < (abstract ? 1 : size); ++i) {
         Flit *f = Flit::New();
         f->id = _cur_id++;
         assert(_cur_id);
@@ -196,9 +297,11 @@ int MTATrafficManager::_GeneratePacket(int source, int stype, int cl, int time,
         f->cl = cl;
         f->data = data;
 
-        _total_in_flight_flits[f->cl].insert(make_pair(f->id, f));
-        if (record)
-            _measured_in_flight_flits[f->cl].insert(make_pair(f->id, f));
+        if (!dests) {
+            _total_in_flight_flits[f->cl].insert(make_pair(f->id, f));
+            if (record)
+                _measured_in_flight_flits[f->cl].insert(make_pair(f->id, f));
+        }
         
         f->type = packet_type;
 
@@ -206,6 +309,8 @@ int MTATrafficManager::_GeneratePacket(int source, int stype, int cl, int time,
             f->head = true;
             // packets are only generated to nodes smaller or equal to limit
             f->dest = packet_destination;
+            if (dests)
+                f->dests = *dests;
         } else {
             f->head = false;
             f->dest = -1;
@@ -228,7 +333,8 @@ int MTATrafficManager::_GeneratePacket(int source, int stype, int cl, int time,
             f->pri = 0;
         }
         
-        f->tail = (i == (size - 1)) ? true : false;
+        f->tail = (abstract || (i == (size - 1))) ? true : false;
+        f->size = abstract ? size : 1;
 
         f->vc = -1;
 
@@ -244,41 +350,33 @@ void MTATrafficManager::_Step()
     for (int c = 0; c < _classes; ++c) {
         flits_in_flight |= !_total_in_flight_flits[c].empty();
     }
+    flits_in_flight |= !_mc_pending.empty();
 
     if (flits_in_flight && (_deadlock_timer++ >= _deadlock_warn_timeout)) {
         _deadlock_timer = 0;
-        cout << "WARNING: Possible network deadlock.\n";
+        *gProgressOut << "WARNING: Possible network deadlock.\n";
     }
 
     vector<map<int, Flit *>> flits(_subnets);
 
     // Phase #1: Destination node receives flit from the subnet
-    //   - The destination node cannot receive flit if the node is currently busy
-    //     handling with the previously received packet 
+    //   - A node that is currently busy handling the previously received
+    //     packet keeps the arriving flits in its network interface and
+    //     withholds their credits beyond the ejection buffer
+    for (int n = 0; n < _nodes; ++n) {
+        if (!_ni_ready[n].empty() && !_tfm_if->IsNodeBusy(n))
+            _DeliverPacket(n);
+    }
     for (int subnet = 0; subnet < _subnets; ++subnet)
     {
         for (int n = 0; n < _nodes; ++n)
         {
-            if (_tfm_if->IsNodeBusy(n))
-                continue;  // skip currently busy node -> wait until the current packet is handled via the TFM IF
-
-            Flit * const f = _net[subnet]->ReadFlit( n );
+            // injection credits arrive regardless of the state of the node;
+            // a credit that is not read in its cycle is lost
             Credit *const c = _net[subnet]->ReadCredit(n);
-
-            if (f) {    // Processing the flit from the network 
-                flits[subnet].insert(make_pair(n, f));
-                    if((_sim_state == warming_up) || (_sim_state == running)) {
-                        ++_accepted_flits[f->cl][n];
-                    if(f->tail) {   // if the given flit is a tail, alert the TFM IF to make sure that the packet is handled by the external module via the IF
-                        ++_accepted_packets[f->cl][n];
-                        _tfm_if->ReceivePacket(n, f->pid);
-                    }
-                }
-            }
-            
             if (c) {    // Processing the credit from the network
 #ifdef TRACK_FLOWS
-                for (set<int>::const_iterator iter = c->vc.begin(); iter != c->vc.end(); ++iter)
+                for (VCMask::const_iterator iter = c->vc.begin(); iter != c->vc.end(); ++iter)
                 {
                     int const vc = *iter;
                     assert(!_outstanding_classes[n][subnet][vc].empty());
@@ -291,9 +389,37 @@ void MTATrafficManager::_Step()
                 _buf_states[n][subnet]->ProcessCredit(c);
                 c->Free();
             }
+
+            Flit * f = _net[subnet]->ReadFlit( n );
+
+            if (f && (f->size > 1)) {
+                // the body flits of an abstract packet are still to come
+                assert(!_ni_arriving[subnet][n]);
+                _ni_arriving[subnet][n] = f;
+                _ni_arrival_time[subnet][n] = _time + f->size - 1;
+                f = NULL;
+            } else if ((_abstract_packet_size > 0) && _ni_arriving[subnet][n]) {
+                assert(!f);
+                if (_ni_arrival_time[subnet][n] <= _time) {
+                    f = _ni_arriving[subnet][n];
+                    _ni_arriving[subnet][n] = NULL;
+                } else {
+                    _deadlock_timer = 0;    // its body flits are arriving
+                }
+            }
+
+            if (f) {    // Processing the flit from the network 
+                flits[subnet].insert(make_pair(n, f));
+                if((_sim_state == warming_up) || (_sim_state == running)) {
+                    _accepted_flits[f->cl][n] += f->size;
+                    if(f->tail)
+                        ++_accepted_packets[f->cl][n];
+                }
+                _EjectFlit(subnet, n, f);
+            }
         }
-        _net[subnet]->ReadInputs();
     }
+    _ReadNetworkInputs();
 
     for (int subnet = 0; subnet < _subnets; ++subnet)
     {
@@ -301,6 +427,13 @@ void MTATrafficManager::_Step()
         for (int n = 0; n < _nodes; ++n)
         {
 
+            // the injection channel is still busy with the body flits of an
+            // abstract packet
+            if ((_abstract_packet_size > 0) && (_ni_inject_busy[subnet][n] > _time))
+                continue;
+
+            RandomStreamScope random_scope(_NodeRandomStream(n), _time);
+
             Flit *f = NULL;
             BufferState *const dest_buf = _buf_states[n][subnet];
             int const last_class = _last_class[n][subnet];
@@ -336,7 +469,7 @@ void MTATrafficManager::_Step()
                 if (cf->head && cf->vc == -1) { // Find first available VC
                     OutputSet route_set;
                     _rf(NULL, cf, -1, &route_set, true);
-                    set<OutputSet::sSetElement> const &os = route_set.GetSet();
+                    OutputSet const &os = route_set;
                     assert(os.size() == 1);
                     OutputSet::sSetElement const &se = *os.begin();
                     assert(se.output_port == -1);
@@ -358,7 +491,7 @@ void MTATrafficManager::_Step()
                         _rf(router, cf, in_channel, &cf->la_route_set, false);
                         cf->vc = -1;
 
-                        set<OutputSet::sSetElement> const sl = cf->la_route_set.GetSet();
+                        OutputSet const & sl = cf->la_route_set;
                         assert(sl.size() == 1);
                         int next_output = sl.begin()->output_port;
                         vc_count /= router->NumOutputs();
@@ -469,7 +602,7 @@ void MTATrafficManager::_Step()
 
                 if ((_sim_state == warming_up) || (_sim_state == running))
                 {
-                    ++_sent_flits[c][n];
+                    _sent_flits[c][n] += f->size;
                     if (f->head)
                     {
                         ++_sent_packets[c][n];
@@ -481,6 +614,8 @@ void MTATrafficManager::_Step()
 #endif
 
                 _net[subnet]->WriteFlit(f, n);
+                if (f->size > 1)
+                    _ni_inject_busy[subnet][n] = _time + f->size;
             }
         }
     }
@@ -496,10 +631,6 @@ void MTATrafficManager::_Step()
 
                 f->atime = _time;
 
-                Credit *const c = Credit::New();
-                c->vc.insert(f->vc);
-                _net[subnet]->WriteCredit(c, n);
-
 #ifdef TRACK_FLOWS
                 ++_ejected_flits[f->cl][n];
 #endif
@@ -508,15 +639,149 @@ void MTATrafficManager::_Step()
             }
         }
         flits[subnet].clear();
-        // _InteralStep here
-        _net[subnet]->Evaluate();
-        _net[subnet]->WriteOutputs();
+
+        if (_ni_queued_credits > 0) {
+            for (int n = 0; n < _nodes; ++n) {
+                deque<int> &credits = _ni_credits[subnet][n];
+                if (credits.empty())
+                    continue;
+                Credit *const c = Credit::New();
+                c->vc.insert(credits.front());
+                credits.pop_front();
+                --_ni_queued_credits;
+                _net[subnet]->WriteCredit(c, n);
+            }
+        }
     }
+    // _InteralStep here
+    _EvaluateNetworks();
 
     ++_time;
     assert(_time);
 }
 
+void MTATrafficManager::_EjectFlit(int subnet, int node, Flit *f)
+{
+    // an idle node takes the flits straight from the network
+    bool const direct = !_tfm_if->IsNodeBusy(node) && _ni_ready[node].empty();
+    int &buffered = _ni_buffered[subnet][node];
+    int &vc_flits = _ni_vc_flits[subnet][node][f->vc];
+
+    if (direct) {
+        _ni_credits[subnet][node].push_back(f->vc);
+        ++_ni_queued_credits;
+    } else {
+        ++buffered;
+        ++vc_flits;
+        deque<int> &held = _ni_held_credits[subnet][node];
+        if (buffered - (int)held.size() <= _ni_eject_buf_size) {
+            _ni_credits[subnet][node].push_back(f->vc);
+            ++_ni_queued_credits;
+        } else {
+            held.push_back(f->vc);
+        }
+    }
+    if (_ni_occupancy_stats)
+        _ni_occupancy_stats->AddSample(buffered);
+
+    if (f->tail) {
+        NIPacket const packet = {subnet, f->pid, vc_flits, _time};
+        vc_flits = 0;
+        _ni_ready[node].push_back(packet);
+        ++_ni_ready_packets;
+        if (direct)
+            _DeliverPacket(node);
+    }
+}
+
+void MTATrafficManager::_DeliverPacket(int node)
+{
+    NIPacket const packet = _ni_ready[node].front();
+    _ni_ready[node].pop_front();
+    --_ni_ready_packets;
+
+    _FreeEjectBuffer(packet.subnet, node, packet.flits);
+    if (_ni_wait_stats)
+        _ni_wait_stats->AddSample(_time - packet.time);
+    _tfm_if->ReceivePacket(node, packet.pid);
+}
+
+void MTATrafficManager::_FreeEjectBuffer(int subnet, int node, int flits)
+{
+    int &buffered = _ni_buffered[subnet][node];
+    buffered -= flits;
+    assert(buffered >= 0);
+
+    // hand out the credits of flits that now fit into the buffer
+    deque<int> &held = _ni_held_credits[subnet][node];
+    while (!held.empty() && (buffered - (int)held.size() < _ni_eject_buf_size)) {
+        _ni_credits[subnet][node].push_back(held.front());
+        held.pop_front();
+        ++_ni_queued_credits;
+    }
+}
+
+bool MTATrafficManager::_Quiescent() const
+{
+    // every generated flit stays in _total_in_flight_flits (or, for multicast
+    // packets, _mc_pending) until it retires, so this also covers the flits
+    // waiting in _input_queue
+    for (int c = 0; c < _classes; ++c) {
+        if (!_total_in_flight_flits[c].empty())
+            return false;
+    }
+
+    if (!_mc_pending.empty())
+        return false;
+
+    // packets waiting for their node and credits yet to be returned
+    if (_ni_ready_packets > 0 || _ni_queued_credits > 0)
+        return false;
+
+    // credits returned for the last retired flits may still be on their way
+    for (int subnet = 0; subnet < _subnets; ++subnet) {
+        if (!_net[subnet]->Idle())
+            return false;
+    }
+
+    return true;
+}
+
+bool MTATrafficManager::_AdvanceIdle(int cycles)
+{
+    assert(cycles >= 0);
+
+    if (!_Quiescent())
+        return false;
+
+    // Nothing in the networks depends on the cycle count while they are
+    // drained, so skipping ahead is equivalent to stepping through the idle 
+    // cycles one by one.
+    _time += cycles;
+    assert(_time >= 0);
+
+    return true;
+}
+
+void MTATrafficManager::Serialize(Checkpoint &cp)
+{
+    TrafficManager::Serialize(cp);
+    cp.Item(_input_queue);
+    cp.Item(_mc_pending);
+    cp.Item(_mc_retired_heads);
+    cp.Item(_ni_buffered);
+    cp.Item(_ni_vc_flits);
+    cp.Item(_ni_held_credits);
+    cp.Item(_ni_credits);
+    cp.Item(_ni_ready);
+    cp.Item(_ni_ready_packets);
+    cp.Item(_ni_queued_credits);
+    cp.Check(_abstract_packet_size, "abstract_packet_size");
+    cp.Item(_ni_inject_busy);
+    cp.Item(_ni_arriving);
+    cp.Item(_ni_arrival_time);
+}
+
 
 /*****************************************************
  * Packet Descriptor for NeuroMTA 
@@ -528,6 +793,9 @@ void MTATrafficManager::_Step()
  *     of each flit, the packet size and several options related to the
  *     given packet.
  *   - Data read/write packets has two arguments
+ *   - Descriptors are move-only. Payloads of up to INLINE_PAYLOAD_SIZE
+ *     bytes (e.g. the arguments of data packets) are stored inline;
+ *     larger ones are allocated on the heap.
  * 
  * API Description
  *   - NewDataPacket:       constructor for the data read/write packets
@@ -540,15 +808,53 @@ void MTATrafficManager::_Step()
  *                          is a control packet
  */
 
-MTAPacketDescriptor::MTAPacketDescriptor() {}
-MTAPacketDescriptor::MTAPacketDescriptor(PacketType packet_type, const int packet_size, Flit::FlitType flit_type, void *payload, const int payload_size)
+MTAPacketDescriptor::MTAPacketDescriptor()
+: packet_type(CONTROL_REQUEST), packet_size(0), flit_type(Flit::ANY_TYPE), payload(NULL), payload_size(0) {}
+
+MTAPacketDescriptor::MTAPacketDescriptor(PacketType packet_type, const int packet_size, Flit::FlitType flit_type, const void *payload, const int payload_size)
 : packet_type(packet_type), packet_size(packet_size), flit_type(flit_type), payload_size(payload_size) {
-    this->payload = (void *)malloc(payload_size);
+    if (payload_size <= INLINE_PAYLOAD_SIZE)
+        this->payload = _inline_payload;
+    else
+        this->payload = (void *)malloc(payload_size);
     memcpy(this->payload, payload, payload_size);
 }
 
+MTAPacketDescriptor::MTAPacketDescriptor(MTAPacketDescriptor &&other) noexcept {
+    _MoveFrom(other);
+}
+
+MTAPacketDescriptor &MTAPacketDescriptor::operator=(MTAPacketDescriptor &&other) noexcept {
+    if (this != &other) {
+        _FreePayload();
+        _MoveFrom(other);
+    }
+    return *this;
+}
+
 MTAPacketDescriptor::~MTAPacketDescriptor() {
-    free(this->payload);
+    _FreePayload();
+}
+
+void MTAPacketDescriptor::_MoveFrom(MTAPacketDescriptor &other) {
+    packet_type  = other.packet_type;
+    packet_size  = other.packet_size;
+    flit_type    = other.flit_type;
+    payload_size = other.payload_size;
+    if (other.payload == other._inline_payload) {
+        memcpy(_inline_payload, other._inline_payload, payload_size);
+        payload = _inline_payload;
+    } else {
+        payload = other.payload;    // take over the heap allocation
+    }
+    other.payload = NULL;
+    other.payload_size = 0;
+}
+
+void MTAPacketDescriptor::_FreePayload() {
+    if (payload != _inline_payload)
+        free(payload);
+    payload = NULL;
 }
 
 MTAPacketDescriptor MTAPacketDescriptor::NewDataPacket(const uint64_t addr, const uint64_t size, const bool is_write, const bool is_response) {
@@ -574,21 +880,21 @@ MTAPacketDescriptor MTAPacketDescriptor::NewControlPacket(void *command_payload,
     return MTAPacketDescriptor(packet_type, 1, flit_type, command_payload, payload_size);
 }
 
-uint64_t MTAPacketDescriptor::GetDataAddr() {
+uint64_t MTAPacketDescriptor::GetDataAddr() const {
     assert(this->IsDataPacket());
-    return ((uint64_t *)(this->payload))[0];
+    return ((const uint64_t *)(this->payload))[0];
 }
 
-uint64_t MTAPacketDescriptor::GetDataSize() {
+uint64_t MTAPacketDescriptor::GetDataSize() const {
     assert(this->IsDataPacket());
-    return ((uint64_t *)(this->payload))[1];
+    return ((const uint64_t *)(this->payload))[1];
 }
 
-bool  MTAPacketDescriptor::IsDataPacket() {
+bool  MTAPacketDescriptor::IsDataPacket() const {
     return packet_type == PacketType::DATA_READ_REQUEST || packet_type == PacketType::DATA_READ_RESPONSE || packet_type == PacketType::DATA_WRITE_REQUEST || packet_type == PacketType::DATA_WRITE_RESPONSE;
 }
 
-bool  MTAPacketDescriptor::IsControlPacket() {
+bool  MTAPacketDescriptor::IsControlPacket() const {
     return packet_type == PacketType::CONTROL_RESPONSE || packet_type == PacketType::CONTROL_REQUEST;
 }
 
@@ -607,24 +913,91 @@ bool  MTAPacketDescriptor::IsControlPacket() {
  * 
  * API Description
  *   - SendPacket:          send a packet through the traffic manager
+ *   - SendPackets:         send a batch of packets through the traffic
+ *                          manager and optionally collect their PIDs
+ *   - SendMulticastPacket: send a packet to a set of destinations; it is
+ *                          received by each of them under the same PID
  *   - ReceivePacket:       receive a packet from the traffic manager and
  *                          destination node turns into busy state
  *   - HandlePacket:        handle the ongoing packet and the destination
  *                          node turns into idle state
  *   - GetPID:              returns currently ongoing packet ID
  *   - GetPacketDescriptor: returns the descriptor of the currently ongoing
- *                          packet
+ *                          packet (valid until the packet is handled, also
+ *                          across later sends)
  *   - IsNodeBusy:          returns a flag indicating whether the given node
  *                          is in busy state
+ *   - PollCompletions:     returns the packets received since the last poll
+ *                          that are still waiting to be handled, so that
+ *                          the host only needs to visit those nodes
  *   - Step:                single cycle operation (automatically calls the 
  *                          _Step function of the traffic manager)
  */
 
 MTATrafficManagerInterface::MTATrafficManagerInterface(const Configuration &config, const vector<Network *> &net)
-    :_traffic_manager(config, net, this)
+    :_traffic_manager(config, net, this), _num_unhandled_packets(0), _oldest_unhandled_pid(0), _trace_writer(NULL)
 {
-    _unhandled_packets = vector<map<int, MTAPacketDescriptor>>(_traffic_manager._nodes);
+    _unhandled_packets = vector<unique_ptr<MTAPacketDescriptor>>(1024);
+    for (size_t i = 0; i < _unhandled_packets.size(); ++i)
+        _unhandled_packets[i].reset(new MTAPacketDescriptor());
+    _unhandled_pids = vector<int>(_unhandled_packets.size(), -1);
+    _unhandled_receivers = vector<int>(_unhandled_packets.size(), 0);
     _ongoing_packet_ids = vector<int>(_traffic_manager._nodes, -1);
+    _completion_queued = vector<bool>(_traffic_manager._nodes, false);
+    _receive_times = vector<int>(_traffic_manager._nodes, -1);
+
+    const string trace_file = config.GetStr("mta_trace_out");
+    if (trace_file != "")
+        _trace_writer = new MTATraceWriter(trace_file);
+}
+
+MTATrafficManagerInterface::~MTATrafficManagerInterface()
+{
+    delete _trace_writer;
+}
+
+int  MTATrafficManagerInterface::_UnhandledSlot(const int pid) const {
+    return pid & (_unhandled_packets.size() - 1);
+}
+
+void MTATrafficManagerInterface::_GrowUnhandledPackets(const int pid) {
+    size_t size = _unhandled_packets.size();
+    while ((size_t)(pid - _oldest_unhandled_pid) >= size)
+        size *= 2;
+
+    vector<unique_ptr<MTAPacketDescriptor>> packets(size);
+    vector<int> pids(size, -1);
+    vector<int> receivers(size, 0);
+    packets.swap(_unhandled_packets);
+    pids.swap(_unhandled_pids);
+    receivers.swap(_unhandled_receivers);
+    for (size_t i = 0; i < pids.size(); ++i) {
+        if (pids[i] != -1) {
+            const int slot = _UnhandledSlot(pids[i]);
+            _unhandled_packets[slot] = std::move(packets[i]);
+            _unhandled_pids[slot] = pids[i];
+            _unhandled_receivers[slot] = receivers[i];
+        }
+    }
+    for (size_t i = 0; i < size; ++i) {
+        if (!_unhandled_packets[i])
+            _unhandled_packets[i].reset(new MTAPacketDescriptor());
+    }
+}
+
+void MTATrafficManagerInterface::_AddUnhandledPacket(const int pid, MTAPacketDescriptor &packet_desc, const int receivers) {
+    if (_num_unhandled_packets == 0)
+        _oldest_unhandled_pid = pid;
+    assert(pid >= _oldest_unhandled_pid);
+    if ((size_t)(pid - _oldest_unhandled_pid) >= _unhandled_packets.size())
+        _GrowUnhandledPackets(pid);
+
+    const int slot = _UnhandledSlot(pid);
+    assert(_unhandled_pids[slot] == -1);
+    *_unhandled_packets[slot] = std::move(packet_desc);
+    _unhandled_pids[slot] = pid;
+    _unhandled_receivers[slot] = receivers;
+    ++_num_unhandled_packets;
 }
 
 int  MTATrafficManagerInterface::SendPacket(const int src_id, const int dst_id, int subnet, MTAPacketDescriptor packet_desc) {
@@ -632,21 +1005,75 @@ int  MTATrafficManagerInterface::SendPacket(const int src_id, const int dst_id,
         src_id, -1, 0, _traffic_manager._time, subnet, packet_desc.packet_size, packet_desc.flit_type, NULL, dst_id
     );
 
-    _unhandled_packets[dst_id][pid] = packet_desc;
+    if (_trace_writer)
+        _trace_writer->RecordSend(_traffic_manager._time, pid, src_id, dst_id, subnet, packet_desc);
+
+    _AddUnhandledPacket(pid, packet_desc, 1);
+
+    return pid;
+}
+
+int  MTATrafficManagerInterface::SendPackets(vector<MTAPacketRequest> &requests, vector<int> *pids) {
+    if (pids)
+        pids->reserve(pids->size() + requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        MTAPacketRequest &request = requests[i];
+        const int pid = SendPacket(request.src_id, request.dst_id, request.subnet, std::move(request.packet_desc));
+        if (pids)
+            pids->push_back(pid);
+    }
+    return requests.size();
+}
+
+int  MTATrafficManagerInterface::SendMulticastPacket(const int src_id, const vector<int> &dst_ids, int subnet, MTAPacketDescriptor packet_desc) {
+    vector<int> dests(dst_ids);
+    sort(dests.begin(), dests.end());
+    if (dests.size() == 1)
+        return SendPacket(src_id, dests.front(), subnet, std::move(packet_desc));
+
+    const int pid = _traffic_manager._GenerateMulticastPacket(
+        src_id, 0, _traffic_manager._time, subnet, packet_desc.packet_size, packet_desc.flit_type, dests
+    );
+
+    if (_trace_writer)
+        _trace_writer->RecordMulticastSend(_traffic_manager._time, pid, src_id, dests, subnet, packet_desc);
+
+    _AddUnhandledPacket(pid, packet_desc, dests.size());
 
     return pid;
 }
 
 void MTATrafficManagerInterface::ReceivePacket(const int dst_id, const int pid) {
     _ongoing_packet_ids[dst_id] = pid;
+    _receive_times[dst_id] = _traffic_manager._time;
+    if (!_completion_queued[dst_id]) {
+        _completion_queued[dst_id] = true;
+        _completed_nodes.push_back(dst_id);
+    }
 }
 
 void MTATrafficManagerInterface::HandlePacket(const int node_id) {
     const int pid = GetPID(node_id);
     
     if (pid != -1) {
-        _unhandled_packets[node_id].erase(pid);
+        if (_trace_writer)
+            _trace_writer->RecordHandle(_traffic_manager._time, pid, node_id, _traffic_manager._time - _receive_times[node_id]);
+
+        const int slot = _UnhandledSlot(pid);
+        assert(_unhandled_pids[slot] == pid);
         _ongoing_packet_ids[node_id] = -1;
+        assert(_unhandled_receivers[slot] > 0);
+        if (--_unhandled_receivers[slot] > 0)
+            return;     // other destinations of a multicast packet still need it
+        *_unhandled_packets[slot] = MTAPacketDescriptor();
+        _unhandled_pids[slot] = -1;
+        --_num_unhandled_packets;
+
+        // let the ring start at the oldest packet that is still unhandled
+        if (pid == _oldest_unhandled_pid) {
+            while (_num_unhandled_packets > 0 && _unhandled_pids[_UnhandledSlot(_oldest_unhandled_pid)] != _oldest_unhandled_pid)
+                ++_oldest_unhandled_pid;
+        }
     }
 }
 
@@ -654,15 +1081,116 @@ int  MTATrafficManagerInterface::GetPID(const int node_id) const {
     return _ongoing_packet_ids[node_id];
 }
 
-MTAPacketDescriptor MTATrafficManagerInterface::GetPacketDescriptor(const int node_id) {
+MTAPacketDescriptor &MTATrafficManagerInterface::GetPacketDescriptor(const int node_id) {
     const int pid = GetPID(node_id);
-    return _unhandled_packets[node_id][pid];
+    assert(pid != -1);
+    const int slot = _UnhandledSlot(pid);
+    assert(_unhandled_pids[slot] == pid);
+    return *_unhandled_packets[slot];
 }
 
 bool MTATrafficManagerInterface::IsNodeBusy(const int node_id) const {
-    return (GetPID(node_id) == -1) ? true : false; 
+    return (GetPID(node_id) != -1) ? true : false; 
+}
+
+int  MTATrafficManagerInterface::PollCompletions(vector<MTACompletion> &completions) {
+    completions.clear();
+    for (size_t i = 0; i < _completed_nodes.size(); ++i) {
+        const int node_id = _completed_nodes[i];
+        _completion_queued[node_id] = false;
+        // the host may have handled the packet through GetPID in the meantime
+        if (GetPID(node_id) == -1)
+            continue;
+        MTACompletion completion;
+        completion.node_id = node_id;
+        completion.pid = GetPID(node_id);
+        completion.packet_desc = &GetPacketDescriptor(node_id);
+        completions.push_back(completion);
+    }
+    _completed_nodes.clear();
+    return completions.size();
 }
 
 void MTATrafficManagerInterface::Step() {
     _traffic_manager._Step();
-}
\ No newline at end of file
+}
+
+void MTATrafficManagerInterface::StepUntil(const int target_time) {
+    while (_traffic_manager._time < target_time) {
+        if (_traffic_manager._AdvanceIdle(target_time - _traffic_manager._time))
+            break;
+        _traffic_manager._Step();
+    }
+}
+
+bool MTATrafficManagerInterface::AdvanceIdle(const int cycles) {
+    return _traffic_manager._AdvanceIdle(cycles);
+}
+
+bool MTATrafficManagerInterface::IsQuiescent() const {
+    return _traffic_manager._Quiescent();
+}
+
+const Stats *MTATrafficManagerInterface::GetEjectOccupancyStats() const {
+    return _traffic_manager._ni_occupancy_stats;
+}
+
+const Stats *MTATrafficManagerInterface::GetEjectWaitStats() const {
+    return _traffic_manager._ni_wait_stats;
+}
+
+int  MTATrafficManagerInterface::GetTime() const {
+    return _traffic_manager._time;
+}
+
+void MTATrafficManagerInterface::_Serialize(Checkpoint &cp) {
+    _traffic_manager.Serialize(cp);
+
+    cp.Section("mta_interface");
+    size_t ring_size = _unhandled_packets.size();
+    cp.Item(ring_size);
+    if (!cp.Saving()) {
+        _unhandled_packets = vector<unique_ptr<MTAPacketDescriptor>>(ring_size);
+        for (size_t i = 0; i < ring_size; ++i)
+            _unhandled_packets[i].reset(new MTAPacketDescriptor());
+    }
+    cp.Item(_unhandled_pids);
+    cp.Item(_unhandled_receivers);
+    for (size_t i = 0; i < ring_size; ++i) {
+        if (_unhandled_pids[i] == -1)
+            continue;
+        MTAPacketDescriptor &desc = *_unhandled_packets[i];
+        MTAPacketDescriptor::PacketType packet_type = desc.packet_type;
+        int packet_size = desc.packet_size;
+        Flit::FlitType flit_type = desc.flit_type;
+        int payload_size = desc.payload_size;
+        cp.Item(packet_type);
+        cp.Item(packet_size);
+        cp.Item(flit_type);
+        cp.Item(payload_size);
+        vector<char> payload(payload_size);
+        if (cp.Saving() && payload_size > 0)
+            memcpy(payload.data(), desc.payload, payload_size);
+        if (payload_size > 0)
+            cp.Bytes(payload.data(), payload_size);
+        if (!cp.Saving())
+            desc = MTAPacketDescriptor(packet_type, packet_size, flit_type, payload.data(), payload_size);
+    }
+    cp.Item(_num_unhandled_packets);
+    cp.Item(_oldest_unhandled_pid);
+    cp.Item(_ongoing_packet_ids);
+    cp.Item(_completed_nodes);
+    cp.Item(_completion_queued);
+    cp.Item(_receive_times);
+    cp.Finish();
+}
+
+void MTATrafficManagerInterface::SaveCheckpoint(ostream &os) {
+    Checkpoint cp(os);
+    _Serialize(cp);
+}
+
+void MTATrafficManagerInterface::RestoreCheckpoint(istream &is) {
+    Checkpoint cp(is);
+    _Serialize(cp);
+}
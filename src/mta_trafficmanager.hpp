@@ -4,6 +4,10 @@
 #include <iostream>
 #include <vector>
 #include <list>
+#include <deque>
+#include <map>
+#include <cstdint>
+#include <memory>
 
 #include "config_utils.hpp"
 #include "stats.hpp"
@@ -39,9 +43,65 @@
  *   _GeneratePacket:   this function is an interface to create a packet
  *   _Step:             this function defines a single cycle operation of
  *                      the interconnect networks
+ * 
+ * Additional Methods
+ *   _Quiescent:        returns a flag indicating whether there is no flit
+ *                      left in the input queues, routers and channels
+ *   _AdvanceIdle:      skips the given number of cycles at once while the
+ *                      interconnect networks are quiescent
+ *   Serialize:         also covers the packets waiting in the input queues
+ *
+ * Network Interface Ejection Buffers
+ *   - Every node has an ejection buffer of ni_eject_buf_size flits per
+ *     subnet. A node that is busy with a packet keeps accepting flits into
+ *     the buffer and returns their credits, and takes the oldest complete
+ *     packet from it once the previous one has been handled. Flits that
+ *     arrive while the buffer is full are kept, but their credits are
+ *     withheld until space frees up, which backs the traffic up into the
+ *     router. Idle nodes take flits straight from the network. Credits go
+ *     back at one per cycle.
+ *   - With ni_eject_buf_size = 0 a busy node returns no credits at all, so
+ *     it only keeps the flits the router could still send on the credits
+ *     it held; nothing arriving on the ejection channel is dropped.
+ *   - Flits are retired (and network statistics taken) as they arrive;
+ *     ni_eject_occupancy samples the buffer occupancy seen by each arriving
+ *     flit (including the flits whose credits are withheld), and 
+ *     ni_eject_wait the cycles a complete packet waited for its node.
+ *
+ * Multicast Packets
+ *   - A multicast packet is injected once and forks in the routers along
+ *     the tree of its multicast routing function (multicast_routing_function,
+ *     e.g. dor_tree for an XY-tree on mesh and cmesh), so every destination
+ *     receives its own copy of the flits. Copies keep the IDs of the
+ *     flits, so multicast packets are tracked by the number of flits still
+ *     to be delivered instead of by flit.
+ *   - Each delivery is retired (and counted in the statistics) like a
+ *     unicast packet from the source to that destination.
+ *   - A fork sends the whole packet down one branch after the other and
+ *     keeps its flits until the last branch took them, so a multicast
+ *     packet has to fit into a VC buffer (vc_buf_size).
+ *   - Multicast packets require an IQRouter network with a separate VC
+ *     allocator, non-speculative switch allocation, no switch holding and
+ *     no lookahead routing.
+ *
+ * Abstract Packets
+ *   - With abstract_packet_size > 0, packets of at least that many flits
+ *     are simulated at packet granularity: a single flit of the packet's
+ *     size moves through the network, and routers only see its head. It
+ *     contends for VCs and the switch, and takes a credit, like any head
+ *     flit. Once it is through, the switch input and output channel stay
+ *     busy for the rest of the packet's serialization time, and so do the
+ *     injection channel at the source and the ejection channel at the
+ *     destination. The packet is received when its last flit would have
+ *     arrived.
+ *   - Buffers only hold the head of an abstract packet, so a blocked
+ *     packet backs up less far into the network than its flits would.
+ *   - Flit statistics count the flits an abstract packet stands for.
+ *     Abstract packets require an IQRouter network without output speedup.
  */
 
 class MTATrafficManagerInterface;
+class MTATraceWriter;
 
 class MTATrafficManager : public TrafficManager
 {
@@ -51,6 +111,46 @@ protected:
     virtual int  _GeneratePacket(int source, int stype, int cl, int time, int subnet, int package_size, const Flit::FlitType &packet_type, void *const data, int dest);
     virtual void _Step();
 
+    int  _GenerateFlits(int source, int cl, int time, int subnet, int packet_size, const Flit::FlitType &packet_type, void *const data, int dest, const vector<int> *dests);
+    int  _GenerateMulticastPacket(int source, int cl, int time, int subnet, int packet_size, const Flit::FlitType &packet_type, const vector<int> &dests);
+
+    // multicast packets in flight by PID (flits still to be delivered), and
+    // the heads of the copies being retired by (PID, destination)
+    map<int, int>               _mc_pending;
+    map<pair<int, int>, Flit *> _mc_retired_heads;
+
+    bool _Quiescent() const;
+    bool _AdvanceIdle(int cycles);
+
+    // network interface ejection buffers (no credit is returned to a busy
+    // node's router if the size is zero)
+    struct NIPacket {
+        int subnet;
+        int pid;
+        int flits;  // flits of the packet held in the buffer
+        int time;   // cycle the tail arrived in
+    };
+    int _ni_eject_buf_size;
+    vector<vector<int>>          _ni_buffered;      // [subnet][node]
+    vector<vector<vector<int>>>  _ni_vc_flits;      // [subnet][node][vc] buffered flits of the packet arriving on the VC
+    vector<vector<deque<int>>>   _ni_held_credits;  // [subnet][node] VCs of the flits whose credits are withheld
+    vector<vector<deque<int>>>   _ni_credits;       // [subnet][node] VCs of the credits to be returned
+    vector<deque<NIPacket>>      _ni_ready;         // [node] complete packets waiting for the node
+    int _ni_ready_packets;
+    int _ni_queued_credits;
+    Stats *_ni_occupancy_stats;
+    Stats *_ni_wait_stats;
+
+    // abstract packets (disabled if the size is zero)
+    int _abstract_packet_size;
+    vector<vector<int>>          _ni_inject_busy;   // [subnet][node] cycle until which the body flits of an abstract packet are injected
+    vector<vector<Flit *>>       _ni_arriving;      // [subnet][node] abstract packet whose body flits are still arriving
+    vector<vector<int>>          _ni_arrival_time;  // [subnet][node] cycle its last flit arrives in
+
+    void _EjectFlit(int subnet, int node, Flit *f);
+    void _DeliverPacket(int node);
+    void _FreeEjectBuffer(int subnet, int node, int flits);
+
     // these methods are not used for NeuroMTA
     virtual int  _IssuePacket( int source, int cl ) {return 0;}
     virtual void _Inject() {}
@@ -66,6 +166,8 @@ protected:
 public:
     MTATrafficManager(const Configuration &config, const vector<Network *> &net, MTATrafficManagerInterface *tfm_if);
     virtual ~MTATrafficManager();
+
+    virtual void Serialize(Checkpoint &cp);
 };
 
 
@@ -79,6 +181,9 @@ public:
  *     of each flit, the packet size and several options related to the
  *     given packet.
  *   - Data read/write packets has two arguments
+ *   - Descriptors are move-only. Payloads of up to INLINE_PAYLOAD_SIZE
+ *     bytes (e.g. the arguments of data packets) are stored inline;
+ *     larger ones are allocated on the heap.
  * 
  * API Description
  *   - NewDataPacket:       constructor for the data read/write packets
@@ -103,6 +208,8 @@ public:
         CONTROL_RESPONSE    = 5
     };
 
+    static const int INLINE_PAYLOAD_SIZE = 2 * sizeof(uint64_t);
+
     PacketType              packet_type;    // type of the packet
     int                     packet_size;    // number of flits for the packet
     Flit::FlitType          flit_type;      // type of the flit
@@ -111,16 +218,54 @@ public:
     int payload_size;
 
     MTAPacketDescriptor();
-    MTAPacketDescriptor(PacketType packet_type, const int packet_size, Flit::FlitType flit_type, void *payload, const int payload_size);
+    MTAPacketDescriptor(PacketType packet_type, const int packet_size, Flit::FlitType flit_type, const void *payload, const int payload_size);
+    MTAPacketDescriptor(MTAPacketDescriptor &&other) noexcept;
+    MTAPacketDescriptor &operator=(MTAPacketDescriptor &&other) noexcept;
+    MTAPacketDescriptor(const MTAPacketDescriptor &) = delete;
+    MTAPacketDescriptor &operator=(const MTAPacketDescriptor &) = delete;
     ~MTAPacketDescriptor();
 
     static MTAPacketDescriptor NewDataPacket(const uint64_t addr, const uint64_t size, const bool is_write, const bool is_response);
     static MTAPacketDescriptor NewControlPacket(void *command_payload, const int payload_size, const bool is_response);
 
-    uint64_t    GetDataAddr();
-    uint64_t    GetDataSize();
-    bool        IsDataPacket();
-    bool        IsControlPacket();
+    uint64_t    GetDataAddr() const;
+    uint64_t    GetDataSize() const;
+    bool        IsDataPacket() const;
+    bool        IsControlPacket() const;
+
+private:
+    alignas(uint64_t) unsigned char _inline_payload[INLINE_PAYLOAD_SIZE];
+
+    void _MoveFrom(MTAPacketDescriptor &other);
+    void _FreePayload();
+};
+
+
+/*****************************************************
+ * Batched Packet Transfer for NeuroMTA 
+ *****************************************************
+ * Overview
+ *   - MTAPacketRequest is a single packet submitted through
+ *     SendPackets; its descriptor is moved into the interface.
+ *   - MTACompletion reports a packet that has fully arrived at its
+ *     destination node. The descriptor stays valid until the host
+ *     handles the packet via HandlePacket, even if packets sent in the
+ *     meantime grow the PID ring.
+ */
+
+struct MTAPacketRequest
+{
+    int                 src_id;
+    int                 dst_id;
+    int                 subnet;
+    MTAPacketDescriptor packet_desc;
+};
+
+struct MTACompletion
+{
+    int                  node_id;
+    int                  pid;
+    MTAPacketDescriptor *packet_desc;
 };
 
 
@@ -138,17 +283,49 @@ public:
  * 
  * API Description
  *   - SendPacket:          send a packet through the traffic manager
+ *   - SendPackets:         send a batch of packets through the traffic
+ *                          manager and optionally collect their PIDs
+ *   - SendMulticastPacket: send a packet to a set of destinations; it is
+ *                          received by each of them under the same PID
  *   - ReceivePacket:       receive a packet from the traffic manager and
  *                          destination node turns into busy state
  *   - HandlePacket:        handle the ongoing packet and the destination
  *                          node turns into idle state
+ *                          (the descriptor of a multicast packet is kept
+ *                          until all of its destinations handled it)
  *   - GetPID:              returns currently ongoing packet ID
  *   - GetPacketDescriptor: returns the descriptor of the currently ongoing
- *                          packet
+ *                          packet (valid until the packet is handled, also
+ *                          across later sends)
  *   - IsNodeBusy:          returns a flag indicating whether the given node
  *                          is in busy state
+ *   - PollCompletions:     returns the packets received since the last poll
+ *                          that are still waiting to be handled, so that
+ *                          the host only needs to visit those nodes
  *   - Step:                single cycle operation (automatically calls the 
  *                          _Step function of the traffic manager)
+ *   - StepUntil:           run the traffic manager until the given cycle,
+ *                          skipping over the cycles in which the networks
+ *                          are drained
+ *   - AdvanceIdle:         skip the given number of cycles at once if the
+ *                          networks are drained (returns false otherwise)
+ *   - IsQuiescent:         returns a flag indicating whether the networks
+ *                          are drained
+ *   - GetEjectOccupancyStats: occupancy of the ejection buffers seen by
+ *                          arriving flits (NULL if ni_eject_buf_size is 0)
+ *   - GetEjectWaitStats:   cycles complete packets waited in the ejection
+ *                          buffers for their node (NULL if the size is 0)
+ *   - GetTime:             returns the current cycle of the traffic manager
+ *   - SaveCheckpoint:      saves the state of the whole simulation in
+ *                          between two cycles (see checkpoint.hpp)
+ *   - RestoreCheckpoint:   resumes from a saved state; only allowed right
+ *                          after construction, with the configuration the
+ *                          checkpoint was saved with
+ *
+ * Trace Recording
+ *   - If the mta_trace_out option names a file, every sent packet and
+ *     every handled packet is recorded there (see mta_trace.hpp), so the
+ *     same traffic can be replayed later without the host.
  */
 
 class MTATrafficManagerInterface
@@ -156,18 +333,52 @@ class MTATrafficManagerInterface
 private:
     MTATrafficManager _traffic_manager;     // traffic manager
 
-    vector<map<int, MTAPacketDescriptor>>   _unhandled_packets;
+    // descriptors of the packets that have been sent but not handled yet;
+    // PIDs are handed out consecutively, so the descriptors are kept in a
+    // ring indexed by PID that covers the oldest unhandled packet onwards
+    // (each slot owns its descriptor, so growing the ring never moves one)
+    vector<unique_ptr<MTAPacketDescriptor>> _unhandled_packets;
+    vector<int>                             _unhandled_pids;     // -1 if the slot is free
+    vector<int>                             _unhandled_receivers; // destinations yet to handle the packet
+    int                                     _num_unhandled_packets;
+    int                                     _oldest_unhandled_pid;
     vector<int>                             _ongoing_packet_ids;
 
+    // nodes that received a packet since the last poll (each listed once)
+    vector<int>                             _completed_nodes;
+    vector<bool>                            _completion_queued;
+
+    // trace recording (NULL if disabled) and the cycle each node received
+    // its ongoing packet in
+    MTATraceWriter                         *_trace_writer;
+    vector<int>                             _receive_times;
+
+    int  _UnhandledSlot(const int pid) const;
+    void _GrowUnhandledPackets(const int pid);
+    void _AddUnhandledPacket(const int pid, MTAPacketDescriptor &packet_desc, const int receivers);
+    void _Serialize(Checkpoint &cp);
+
 public:
     MTATrafficManagerInterface(const Configuration &config, const vector<Network *> &net);
+    ~MTATrafficManagerInterface();
     int  SendPacket(const int src_id, const int dst_id, int subnet, MTAPacketDescriptor packet_desc);
+    int  SendPackets(vector<MTAPacketRequest> &requests, vector<int> *pids = NULL);
+    int  SendMulticastPacket(const int src_id, const vector<int> &dst_ids, int subnet, MTAPacketDescriptor packet_desc);
     void ReceivePacket(const int dst_id, const int pid);
     void HandlePacket(const int node_id);
     int  GetPID(const int node_id) const;
-    MTAPacketDescriptor GetPacketDescriptor(const int node_id);
+    MTAPacketDescriptor &GetPacketDescriptor(const int node_id);
     bool IsNodeBusy(const int node_id) const;
+    int  PollCompletions(vector<MTACompletion> &completions);
     void Step();
+    void StepUntil(const int target_time);
+    bool AdvanceIdle(const int cycles);
+    bool IsQuiescent() const;
+    const Stats *GetEjectOccupancyStats() const;
+    const Stats *GetEjectWaitStats() const;
+    int  GetTime() const;
+    void SaveCheckpoint(ostream &os);
+    void RestoreCheckpoint(istream &is);
 };
 
 #endif
\ No newline at end of file
@@ -55,8 +55,10 @@
 #include <sstream>
 #include <limits>
 #include <algorithm>
+#include "simulation_globals.hpp"
 //this is a hack, I can't easily get the routing talbe out of the network
-map<int, int>* global_routing_table;
+thread_local map<int, int>* global_routing_table;
+REGISTER_SIMULATION_GLOBAL(global_routing_table);
 
 AnyNet::AnyNet( const Configuration &config, const string & name )
   :  Network( config, name ){
@@ -80,7 +82,7 @@ AnyNet::~AnyNet(){
 void AnyNet::_ComputeSize( const Configuration &config ){
   file_name = config.GetStr("network_file");
   if(file_name==""){
-    cout<<"No network file name provided"<<endl;
+    cerr<<"No network file name provided"<<endl;
     exit(-1);
   }
   //parse the network description file
@@ -209,14 +211,26 @@ void AnyNet::_BuildNet( const Configuration &config ){
 
 void AnyNet::RegisterRoutingFunctions() {
   gRoutingFunctionMap["min_anynet"] = &min_anynet;
+  gRoutingTableCompilerMap[&min_anynet] = &min_anynet_table;
+}
+
+void min_anynet_table( int router, int dest, RoutingTableEntry * entry ){
+  map<int, int>::const_iterator iter = global_routing_table[router].find(dest);
+  entry->port = (iter == global_routing_table[router].end()) ? -1 : iter->second;
 }
 
 void min_anynet( const Router *r, const Flit *f, int in_channel, 
 		 OutputSet *outputs, bool inject ){
   int out_port=-1;
   if(!inject){
-    assert(global_routing_table[r->GetID()].count(f->dest)!=0);
-    out_port=global_routing_table[r->GetID()][f->dest];
+    RoutingTableEntry const * const entry =
+      LookupRoutingTable(&min_anynet, r->GetID(), f->dest);
+    if(entry){
+      out_port=entry->port;
+    } else {
+      assert(global_routing_table[r->GetID()].count(f->dest)!=0);
+      out_port=global_routing_table[r->GetID()][f->dest];
+    }
   }
  
 
@@ -336,7 +350,7 @@ void AnyNet::readFile(){
 
   network_list.open(file_name.c_str());
   if(!network_list.is_open()){
-    cout<<"Anynet:can't open network file "<<file_name<<endl;
+    cerr<<"Anynet:can't open network file "<<file_name<<endl;
     exit(-1);
   }
   
@@ -34,6 +34,7 @@
 #include <string>
 #include <map>
 #include <list>
+#include <set>
 
 class AnyNet : public Network {
 
@@ -66,4 +67,5 @@ public:
 
 void min_anynet( const Router *r, const Flit *f, int in_channel, 
 		      OutputSet *outputs, bool inject );
+void min_anynet_table( int router, int dest, RoutingTableEntry * entry );
 #endif
@@ -46,12 +46,19 @@
 #include "random_utils.hpp"
 #include "misc_utils.hpp"
 #include "cmesh.hpp"
-
-int CMesh::_cX = 0 ;
-int CMesh::_cY = 0 ;
-int CMesh::_memo_NodeShiftX = 0 ;
-int CMesh::_memo_NodeShiftY = 0 ;
-int CMesh::_memo_PortShiftY = 0 ;
+#include "simulation_globals.hpp"
+
+// geometry of the network in use, shared with the routing functions
+static thread_local int _cX = 0 ;
+static thread_local int _cY = 0 ;
+static thread_local int _memo_NodeShiftX = 0 ;
+static thread_local int _memo_NodeShiftY = 0 ;
+static thread_local int _memo_PortShiftY = 0 ;
+REGISTER_SIMULATION_GLOBAL(_cX);
+REGISTER_SIMULATION_GLOBAL(_cY);
+REGISTER_SIMULATION_GLOBAL(_memo_NodeShiftX);
+REGISTER_SIMULATION_GLOBAL(_memo_NodeShiftY);
+REGISTER_SIMULATION_GLOBAL(_memo_PortShiftY);
 
 CMesh::CMesh( const Configuration& config, const string & name ) 
   : Network(config, name) 
@@ -66,6 +73,8 @@ void CMesh::RegisterRoutingFunctions() {
   gRoutingFunctionMap["dor_no_express_cmesh"] = &dor_no_express_cmesh;
   gRoutingFunctionMap["xy_yx_cmesh"] = &xy_yx_cmesh;
   gRoutingFunctionMap["xy_yx_no_express_cmesh"]  = &xy_yx_no_express_cmesh;
+  gRoutingTableCompilerMap[&dor_cmesh] = &dor_cmesh_table;
+  gMulticastRoutingFunctionMap["dor_tree_cmesh"] = &dor_tree_cmesh;
 }
 
 void CMesh::_ComputeSize( const Configuration &config ) {
@@ -720,6 +729,28 @@ int cmesh_next( int cur, int dest ) {
   return -1;
 }
 
+static int dor_cmesh_port( int cur_router, int dest )
+{
+  // Destination Router
+  int dest_router = CMesh::NodeToRouter( dest ) ;  
+
+  if (dest_router == cur_router) {
+
+    // Forward to processing element
+    return CMesh::NodeToPort( dest ) ;
+
+  } else {
+
+    // Forward to neighbouring router
+    return cmesh_next( cur_router, dest_router );
+  }
+}
+
+void dor_cmesh_table( int router, int dest, RoutingTableEntry * entry )
+{
+  entry->port = dor_cmesh_port( router, dest );
+}
+
 void dor_cmesh( const Router *r, const Flit *f, int in_channel, 
 		OutputSet *outputs, bool inject )
 {
@@ -751,19 +782,9 @@ void dor_cmesh( const Router *r, const Flit *f, int in_channel,
     // Current Router
     int cur_router = r->GetID();
 
-    // Destination Router
-    int dest_router = CMesh::NodeToRouter( f->dest ) ;  
-  
-    if (dest_router == cur_router) {
-
-      // Forward to processing element
-      out_port = CMesh::NodeToPort( f->dest ) ;
-
-    } else {
-
-      // Forward to neighbouring router
-      out_port = cmesh_next( cur_router, dest_router );
-    }
+    RoutingTableEntry const * const entry =
+      LookupRoutingTable( &dor_cmesh, cur_router, f->dest );
+    out_port = entry ? entry->port : dor_cmesh_port( cur_router, f->dest );
   }
 
   outputs->Clear();
@@ -771,6 +792,20 @@ void dor_cmesh( const Router *r, const Flit *f, int in_channel,
   outputs->AddRange( out_port, vcBegin, vcEnd);
 }
 
+// multicast packets fork into an XY-tree along the dor_cmesh routes
+static int dor_tree_cmesh_port( int cur_router, int dest )
+{
+  RoutingTableEntry const * const entry =
+    LookupRoutingTable( &dor_cmesh, cur_router, dest );
+  return entry ? entry->port : dor_cmesh_port( cur_router, dest );
+}
+
+void dor_tree_cmesh( const Router *r, const Flit *f, int in_channel, 
+		     vector<MulticastBranch> *branches )
+{
+  SplitMulticast( r, f, &dor_tree_cmesh_port, branches );
+}
+
 //============================================================
 //
 //=====
@@ -57,13 +57,6 @@ public:
 
 private:
 
-  static int _cX ;
-  static int _cY ;
-
-  static int _memo_NodeShiftX ;
-  static int _memo_NodeShiftY ;
-  static int _memo_PortShiftY ;
-
   void _ComputeSize( const Configuration &config );
   void _BuildNet( const Configuration& config );
 
@@ -89,6 +82,11 @@ void xy_yx_no_express_cmesh( const Router *r, const Flit *f, int in_channel,
 void dor_cmesh( const Router *r, const Flit *f, int in_channel, 
 		OutputSet *outputs, bool inject ) ;
 
+void dor_cmesh_table( int router, int dest, RoutingTableEntry * entry ) ;
+
+void dor_tree_cmesh( const Router *r, const Flit *f, int in_channel, 
+		     vector<MulticastBranch> *branches ) ;
+
 void dor_no_express_cmesh( const Router *r, const Flit *f, int in_channel, 
 			   OutputSet *outputs, bool inject ) ;
 
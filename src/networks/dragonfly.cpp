@@ -34,10 +34,14 @@
 #include "random_utils.hpp"
 #include "misc_utils.hpp"
 #include "globals.hpp"
+#include "simulation_globals.hpp"
 
 #define DRAGON_LATENCY
 
-int gP, gA, gG;
+thread_local int gP, gA, gG;
+REGISTER_SIMULATION_GLOBAL(gP);
+REGISTER_SIMULATION_GLOBAL(gA);
+REGISTER_SIMULATION_GLOBAL(gG);
 
 //calculate the hop count between src and estination
 int dragonflynew_hopcnt(int src, int dest) 
@@ -268,7 +272,7 @@ void DragonFlyNew::_BuildNet( const Configuration &config )
 
     //
 
-    if (_n > 1 )  { cout << " ERROR: n>1 dimension NOT supported yet... " << endl; exit(-1); }
+    if (_n > 1 )  { cerr << " ERROR: n>1 dimension NOT supported yet... " << endl; exit(-1); }
 
     //********************************************
     //   connect OUTPUT channels
@@ -340,7 +344,7 @@ void DragonFlyNew::_BuildNet( const Configuration &config )
 	}
 
 	if (_input < 0) {
-	  cout << " ERROR: _input less than zero " << endl;
+	  cerr << " ERROR: _input less than zero " << endl;
 	  exit(-1);
 	}
 
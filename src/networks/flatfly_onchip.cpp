@@ -55,15 +55,20 @@
 #include "random_utils.hpp"
 #include "misc_utils.hpp"
 #include "globals.hpp"
+#include "simulation_globals.hpp"
 
 
 
 //#define DEBUG_FLATFLY
 
-static int _xcount;
-static int _ycount;
-static int _xrouter;
-static int _yrouter;
+static thread_local int _xcount;
+static thread_local int _ycount;
+static thread_local int _xrouter;
+static thread_local int _yrouter;
+REGISTER_SIMULATION_GLOBAL(_xcount);
+REGISTER_SIMULATION_GLOBAL(_ycount);
+REGISTER_SIMULATION_GLOBAL(_xrouter);
+REGISTER_SIMULATION_GLOBAL(_yrouter);
 
 FlatFlyOnChip::FlatFlyOnChip( const Configuration &config, const string & name ) :
   Network( config, name )
@@ -493,7 +498,7 @@ int flatfly_outport_yx(int dest, int rID) {
     rID      = (int) (rID %power);
   }
   if (output == -1) {
-    cout << " ERROR ---- FLATFLY_OUTPORT function : output not found yx" << endl;
+    cerr << " ERROR ---- FLATFLY_OUTPORT function : output not found yx" << endl;
     exit(-1);
   }
   return -1;
@@ -1300,7 +1305,7 @@ int flatfly_outport(int dest, int rID) {
     rID      = (int) (rID / gK);
   }
   if (output == -1) {
-    cout << " ERROR ---- FLATFLY_OUTPORT function : output not found " << endl;
+    cerr << " ERROR ---- FLATFLY_OUTPORT function : output not found " << endl;
     exit(-1);
   }
   return -1;
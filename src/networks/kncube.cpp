@@ -239,7 +239,7 @@ void KNCube::InsertRandomFaults( const Configuration &config )
     int fail_seed;
     if ( config.GetStr( "fail_seed" ) == "time" ) {
       fail_seed = int( time( NULL ) );
-      cout << "SEED: fail_seed=" << fail_seed << endl;
+      *gProgressOut << "SEED: fail_seed=" << fail_seed << endl;
     } else {
       fail_seed = config.GetInt( "fail_seed" );
     }
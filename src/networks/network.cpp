@@ -34,6 +34,9 @@
 
 #include <cassert>
 #include <sstream>
+#include <algorithm>
+#include <map>
+#include <set>
 
 #include "booksim.hpp"
 #include "network.hpp"
@@ -50,16 +53,23 @@
 
 
 Network::Network( const Configuration &config, const string & name ) :
-  TimedModule( 0, name )
+  TimedModule( 0, name ), _shards(1), _workers(NULL), _scheduler_ready(false),
+  _phase(0)
 {
   _size     = -1; 
   _nodes    = -1; 
   _channels = -1;
   _classes  = config.GetInt("classes");
+  _threads  = config.GetInt("network_threads");
+  if ( _threads < 1 ) {
+    Error( "network_threads must be positive." );
+  }
+  _random_streams = ( config.GetInt("random_streams") != 0 );
 }
 
 Network::~Network( )
 {
+  delete _workers;
   for ( int r = 0; r < _size; ++r ) {
     if ( _routers[r] ) delete _routers[r];
   }
@@ -121,6 +131,10 @@ Network * Network::New(const Configuration & config, const string & name)
   if ( n && ( config.GetInt( "link_failures" ) > 0 ) ) {
     n->InsertRandomFaults( config );
   }
+
+  if ( n ) {
+    CompileRoutingTable( config, n->NumRouters( ), n->NumNodes( ) );
+  }
   return n;
 }
 
@@ -179,31 +193,253 @@ void Network::_Alloc( )
   }
 }
 
-void Network::ReadInputs( )
+static bool ScheduleSlotLess( TimedModule const * a, TimedModule const * b )
 {
-  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
-      iter != _timed_modules.end();
-      ++iter) {
-    (*iter)->ReadInputs( );
+  return a->GetScheduleSlot( ) < b->GetScheduleSlot( );
+}
+
+class NetworkShardTask : public WorkerPool::Task {
+  Network * _net;
+  Network::Phase _phase;
+  int _time;
+public:
+  NetworkShardTask( Network * net, Network::Phase phase, int time )
+    : _net( net ), _phase( phase ), _time( time ) { }
+  virtual void Run( int shard ) { _net->_StepShard( _phase, _time, shard ); }
+};
+
+void Network::_InitScheduler( )
+{
+  // hand out contiguous runs of routers in evaluation order, so that an 
+  // ordered parallel sweep over the shards draws random numbers exactly like
+  // a serial sweep over all modules
+  _shards = max( 1, min( _threads, _size ) );
+  map<Module const *, int> shard_of;
+  set<Module const *> const is_router(_routers.begin( ), _routers.end( ));
+  vector<TimedModule *> routers;
+  for(size_t i = 0; i < _timed_modules.size( ); ++i) {
+    if(is_router.count(_timed_modules[i])) {
+      routers.push_back(_timed_modules[i]);
+    }
+  }
+  for(size_t i = 0; i < routers.size( ); ++i) {
+    shard_of[routers[i]] = ( i * _shards ) / routers.size( );
+  }
+  for(int c = 0; c < _channels; ++c) {
+    shard_of[_chan[c]] = shard_of[_chan[c]->GetSink( )];
+    shard_of[_chan_cred[c]] = shard_of[_chan[c]->GetSource( )];
+  }
+  for(int n = 0; n < _nodes; ++n) {
+    shard_of[_inject[n]] = shard_of[_inject[n]->GetSink( )];
+    shard_of[_inject_cred[n]] = shard_of[_inject[n]->GetSink( )];
+    shard_of[_eject[n]] = shard_of[_eject[n]->GetSource( )];
+    shard_of[_eject_cred[n]] = shard_of[_eject[n]->GetSource( )];
+  }
+
+  // every module starts out active; those that turn out to be idle drop out
+  // of the active set at the start of their first cycle
+  _active_modules.assign(_shards, vector<TimedModule *>( ));
+  for(size_t i = 0; i < _timed_modules.size( ); ++i) {
+    TimedModule * const module = _timed_modules[i];
+    map<Module const *, int>::const_iterator iter = shard_of.find(module);
+    int const shard = ( iter == shard_of.end( ) ) ? 0 : iter->second;
+    module->SetScheduler(this, i, shard);
+    module->SetScheduled(true);
+    _active_modules[shard].push_back(module);
+  }
+
+  // modules may have been woken up before we knew about shards
+  vector<TimedModule *> woken;
+  for(int p = 0; p < 2; ++p) {
+    for(size_t t = 0; t < _woken_modules[p].size( ); ++t) {
+      for(size_t s = 0; s < _woken_modules[p][t].size( ); ++s) {
+	woken.insert(woken.end( ), _woken_modules[p][t][s].begin( ),
+		     _woken_modules[p][t][s].end( ));
+      }
+    }
+    _woken_modules[p].assign(_shards, vector<vector<TimedModule *> >(_shards));
+  }
+  for(size_t i = 0; i < woken.size( ); ++i) {
+    _woken_modules[_phase & 1][0][woken[i]->GetScheduleShard( )].push_back(woken[i]);
   }
+
+  if(_shards > 1) {
+    _workers = new WorkerPool(_shards);
+  }
+  _scheduler_ready = true;
 }
 
-void Network::Evaluate( )
+void Network::_Schedule( TimedModule * module )
 {
-  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
-      iter != _timed_modules.end();
-      ++iter) {
-    (*iter)->Evaluate( );
+  assert(module->IsWoken( ));
+  if(!_scheduler_ready) {
+    // not sharded yet; _InitScheduler sorts things out
+    _woken_modules[_phase & 1].resize(1, vector<vector<TimedModule *> >(1));
+    _woken_modules[_phase & 1][0][0].push_back(module);
+    return;
   }
+  int const thread = _workers ? WorkerPool::CurrentThread( ) : 0;
+  assert((thread >= 0) && (thread < _shards));
+  _woken_modules[_phase & 1][thread][module->GetScheduleShard( )].push_back(module);
 }
 
-void Network::WriteOutputs( )
+void Network::_RetireIdleModules( int shard )
 {
-  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
-      iter != _timed_modules.end();
+  // retire modules that have run out of work and have not been handed any 
+  // new inputs during the last cycle
+  vector<TimedModule *> & active = _active_modules[shard];
+  vector<TimedModule *>::iterator next = active.begin();
+  for(vector<TimedModule *>::const_iterator iter = active.begin();
+      iter != active.end();
       ++iter) {
-    (*iter)->WriteOutputs( );
+    TimedModule * const module = *iter;
+    if(!module->IsWoken( ) && module->Idle( )) {
+      module->SetScheduled(false);
+    } else {
+      *next++ = module;
+    }
+  }
+  active.erase(next, active.end());
+}
+
+void Network::_MergeWokenModules( int shard )
+{
+  // wakeups from the previous phase (and from outside of any phase since)
+  vector<vector<vector<TimedModule *> > > & lists = 
+    _woken_modules[(_phase + 1) & 1];
+  vector<TimedModule *> woken;
+  for(size_t t = 0; t < lists.size( ); ++t) {
+    vector<TimedModule *> & list = lists[t][shard];
+    for(vector<TimedModule *>::const_iterator iter = list.begin();
+	iter != list.end();
+	++iter) {
+      TimedModule * const module = *iter;
+      module->ClearWoken( );
+      if(!module->IsScheduled( )) {
+	module->SetScheduled(true);
+	woken.push_back(module);
+      }
+    }
+    list.clear( );
+  }
+  if(woken.empty( )) {
+    return;
   }
+  // keep modules in construction order so that evaluation order (and thus
+  // the sequence of random numbers drawn by the routers) matches a full sweep
+  vector<TimedModule *> & active = _active_modules[shard];
+  sort(woken.begin( ), woken.end( ), ScheduleSlotLess);
+  vector<TimedModule *> merged(active.size( ) + woken.size( ));
+  merge(active.begin( ), active.end( ),
+	woken.begin( ), woken.end( ),
+	merged.begin( ), ScheduleSlotLess);
+  active.swap(merged);
+}
+
+void Network::_StepShard( Phase phase, int time, int shard )
+{
+  if(phase == PHASE_READ_INPUTS) {
+    _RetireIdleModules(shard);
+  }
+  _MergeWokenModules(shard);
+  vector<TimedModule *> const & active = _active_modules[shard];
+  switch(phase) {
+  case PHASE_READ_INPUTS:
+    for(vector<TimedModule *>::const_iterator iter = active.begin();
+	iter != active.end();
+	++iter) {
+      (*iter)->ReadInputs( time );
+    }
+    break;
+  case PHASE_EVALUATE:
+    for(vector<TimedModule *>::const_iterator iter = active.begin();
+	iter != active.end();
+	++iter) {
+      (*iter)->Evaluate( time );
+    }
+    break;
+  case PHASE_WRITE_OUTPUTS:
+    for(vector<TimedModule *>::const_iterator iter = active.begin();
+	iter != active.end();
+	++iter) {
+      (*iter)->WriteOutputs( time );
+    }
+    break;
+  }
+}
+
+void Network::_RunPhase( Phase phase, int time )
+{
+  if(!_scheduler_ready) {
+    _InitScheduler( );
+  }
+  ++_phase;
+  if(_workers) {
+    // routers draw random numbers while they evaluate
+    NetworkShardTask task(this, phase, time);
+    _workers->Run(&task, _shards,
+		  (phase == PHASE_EVALUATE) && !_random_streams);
+  } else {
+    _StepShard(phase, time, 0);
+  }
+}
+
+void Network::ReadInputs( int time )
+{
+  _RunPhase(PHASE_READ_INPUTS, time);
+}
+
+void Network::Evaluate( int time )
+{
+  _RunPhase(PHASE_EVALUATE, time);
+}
+
+void Network::WriteOutputs( int time )
+{
+  _RunPhase(PHASE_WRITE_OUTPUTS, time);
+}
+
+bool Network::Idle( ) const
+{
+  if(!_scheduler_ready) {
+    for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
+	iter != _timed_modules.end();
+	++iter) {
+      if(!(*iter)->Idle( )) {
+	return false;
+      }
+    }
+    return true;
+  }
+  for(int p = 0; p < 2; ++p) {
+    for(int t = 0; t < _shards; ++t) {
+      for(int s = 0; s < _shards; ++s) {
+	if(!_woken_modules[p][t][s].empty( )) {
+	  return false;
+	}
+      }
+    }
+  }
+  // idle modules only get retired at the start of the next cycle
+  for(int s = 0; s < _shards; ++s) {
+    for(vector<TimedModule *>::const_iterator iter = _active_modules[s].begin();
+	iter != _active_modules[s].end();
+	++iter) {
+      if(!(*iter)->Idle( )) {
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+int Network::NumActiveModules( ) const
+{
+  int active = 0;
+  for(size_t s = 0; s < _active_modules.size( ); ++s) {
+    active += _active_modules[s].size( );
+  }
+  return active;
 }
 
 void Network::WriteFlit( Flit *f, int source )
@@ -246,6 +482,31 @@ double Network::Capacity( ) const
   return 1.0;
 }
 
+void Network::Serialize( Checkpoint & cp )
+{
+  cp.Section( FullName( ) );
+  cp.Check( _size, FullName( ) + " routers" );
+  cp.Check( _nodes, FullName( ) + " nodes" );
+  cp.Check( _channels, FullName( ) + " channels" );
+  if ( !cp.Saving( ) && !_scheduler_ready ) {
+    // channels wake up their receivers as they are restored
+    _InitScheduler( );
+  }
+  for ( int r = 0; r < _size; ++r ) {
+    _routers[r]->Serialize( cp );
+  }
+  for ( int n = 0; n < _nodes; ++n ) {
+    _inject[n]->Serialize( cp );
+    _inject_cred[n]->Serialize( cp );
+    _eject[n]->Serialize( cp );
+    _eject_cred[n]->Serialize( cp );
+  }
+  for ( int c = 0; c < _channels; ++c ) {
+    _chan[c]->Serialize( cp );
+    _chan_cred[c]->Serialize( cp );
+  }
+}
+
 /* this function can be heavily modified to display any information
  * neceesary of the network, by default, call display on each router
  * and display the channel utilization rate
@@ -41,6 +41,7 @@
 #include "channel.hpp"
 #include "config_utils.hpp"
 #include "globals.hpp"
+#include "worker_pool.hpp"
 
 typedef Channel<Credit> CreditChannel;
 
@@ -66,11 +67,41 @@ protected:
 
   deque<TimedModule *> _timed_modules;
 
+  // only modules that have pending work are stepped each cycle; modules 
+  // woken up in the middle of a phase join the active set at the next one.
+  // The routers are split into contiguous shards (one per network thread) 
+  // that are stepped in parallel, and each channel goes along with the 
+  // router on its receiving end.
+  int _threads;
+  // routers draw from their own random streams, so shards need not take 
+  // turns drawing random numbers
+  bool _random_streams;
+  int _shards;
+  WorkerPool * _workers;
+  bool _scheduler_ready;
+  int _phase;
+  vector<vector<TimedModule *> > _active_modules;
+  // indexed by phase parity, waking thread and shard of the woken module, so
+  // that no two threads ever push to the same list and no list is drained 
+  // while it is being filled
+  vector<vector<vector<TimedModule *> > > _woken_modules[2];
+
   virtual void _ComputeSize( const Configuration &config ) = 0;
   virtual void _BuildNet( const Configuration &config ) = 0;
 
   void _Alloc( );
 
+  enum Phase { PHASE_READ_INPUTS, PHASE_EVALUATE, PHASE_WRITE_OUTPUTS };
+
+  void _InitScheduler( );
+  void _RunPhase( Phase phase, int time );
+  void _StepShard( Phase phase, int time, int shard );
+  void _RetireIdleModules( int shard );
+  void _MergeWokenModules( int shard );
+  virtual void _Schedule( TimedModule * module );
+
+  friend class NetworkShardTask;
+
 public:
   Network( const Configuration &config, const string & name );
   virtual ~Network( );
@@ -90,9 +121,17 @@ public:
 
   virtual double Capacity( ) const;
 
-  virtual void ReadInputs( );
-  virtual void Evaluate( );
-  virtual void WriteOutputs( );
+  virtual void ReadInputs( int time );
+  virtual void Evaluate( int time );
+  virtual void WriteOutputs( int time );
+
+  virtual bool Idle( ) const;
+
+  // Save or restore the state of the routers and channels. The scheduler
+  // is not saved: a restored network starts out with every module active,
+  // and the idle ones drop out again at the start of the first cycle unless
+  // a channel has data waiting for them.
+  void Serialize( Checkpoint & cp );
 
   void Display( ostream & os = cout ) const;
   void DumpChannelMap( ostream & os = cout, string const & prefix = "" ) const;
@@ -112,6 +151,7 @@ public:
   const vector<Router *> & GetRouters(){return _routers;}
   Router * GetRouter(int index) {return _routers[index];}
   int NumRouters() const {return _size;}
+  int NumActiveModules() const;
 };
 
 #endif 
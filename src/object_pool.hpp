@@ -0,0 +1,206 @@
+/*****************************************************
+ * Slab Allocator for Flits and Credits
+ *****************************************************
+ * Overview
+ *   - Objects are carved out of contiguous chunks that are never given
+ *     back to the heap before the pool itself goes away, so every object
+ *     keeps a stable index (chunk * CHUNK_SIZE + offset) for its lifetime.
+ *   - Each thread keeps a small cache of free objects and only touches
+ *     the shared free list (under a lock) to refill or spill a whole
+ *     batch at a time, so routers stepped on different threads can
+ *     allocate and free concurrently.
+ *   - Reset hands every object back at once by rewinding the chunks;
+ *     per-thread caches notice the new epoch and drop their contents the
+ *     next time they are used.
+ *   - When a thread exits, its cache goes back to the shared free list,
+ *     so short-lived workers do not strand objects until the next Reset.
+ *   - There must be at most one pool per object type, and T has to grant
+ *     the pool access to its constructor, destructor and _pool_index.
+ *
+ * API Description
+ *   - New:                 get an object (its fields are left as they were)
+ *   - Free:                give an object back to the pool
+ *   - Reset:               give all objects back at once
+ *   - OutStanding:         number of objects currently handed out
+ *   - Size:                number of objects carved out of the chunks
+ *   - Get:                 returns the object with the given index
+ */
+
+#ifndef _OBJECT_POOL_HPP_
+#define _OBJECT_POOL_HPP_
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cassert>
+
+#include "booksim.hpp"
+
+template<typename T>
+class ObjectPool {
+
+public:
+
+  ObjectPool( ) : _next( 0 ), _epoch( 0 ), _outstanding( 0 ) { }
+  ~ObjectPool( );
+
+  T * New( );
+  void Free( T * object );
+  void Reset( );
+
+  inline int OutStanding( ) const {
+    return _outstanding.load( memory_order_relaxed );
+  }
+  int Size( ) const;
+  T * Get( int index ) const;
+
+private:
+
+  static int const CHUNK_SIZE = 1024;
+  static int const CACHE_BATCH = 64;
+
+  struct Cache {
+    ObjectPool * pool;
+    unsigned     epoch;
+    vector<T *>  free;
+    Cache( ) : pool( NULL ), epoch( 0 ) { }
+    ~Cache( );
+  };
+
+  static thread_local Cache _cache;
+
+  vector<T *> _chunks;
+  vector<T *> _free;
+  int         _next;
+
+  atomic<unsigned> _epoch;
+  atomic<int>      _outstanding;
+  mutable mutex    _mutex;
+
+  Cache & _LocalCache( );
+  void _Refill( Cache & cache );
+  void _Spill( Cache & cache );
+
+};
+
+template<typename T>
+thread_local typename ObjectPool<T>::Cache ObjectPool<T>::_cache;
+
+template<typename T>
+ObjectPool<T>::~ObjectPool( )
+{
+  for ( size_t c = 0; c < _chunks.size( ); ++c ) {
+    delete [] _chunks[c];
+  }
+}
+
+template<typename T>
+ObjectPool<T>::Cache::~Cache( )
+{
+  if ( !pool || free.empty( ) ) {
+    return;
+  }
+  lock_guard<mutex> lock( pool->_mutex );
+  // objects cached before the last reset may have been handed out again
+  if ( epoch == pool->_epoch.load( memory_order_relaxed ) ) {
+    pool->_free.insert( pool->_free.end( ), free.begin( ), free.end( ) );
+  }
+}
+
+template<typename T>
+inline typename ObjectPool<T>::Cache & ObjectPool<T>::_LocalCache( )
+{
+  Cache & cache = _cache;
+  cache.pool = this;
+  unsigned const epoch = _epoch.load( memory_order_acquire );
+  if ( cache.epoch != epoch ) {
+    // objects cached before the last reset may have been handed out again
+    cache.free.clear( );
+    cache.epoch = epoch;
+  }
+  return cache;
+}
+
+template<typename T>
+inline T * ObjectPool<T>::New( )
+{
+  Cache & cache = _LocalCache( );
+  if ( cache.free.empty( ) ) {
+    _Refill( cache );
+  }
+  T * const object = cache.free.back( );
+  cache.free.pop_back( );
+  _outstanding.fetch_add( 1, memory_order_relaxed );
+  return object;
+}
+
+template<typename T>
+inline void ObjectPool<T>::Free( T * object )
+{
+  Cache & cache = _LocalCache( );
+  cache.free.push_back( object );
+  if ( (int)cache.free.size( ) > 2 * CACHE_BATCH ) {
+    _Spill( cache );
+  }
+  _outstanding.fetch_sub( 1, memory_order_relaxed );
+}
+
+template<typename T>
+void ObjectPool<T>::_Refill( Cache & cache )
+{
+  lock_guard<mutex> lock( _mutex );
+  while ( !_free.empty( ) && ( (int)cache.free.size( ) < CACHE_BATCH ) ) {
+    cache.free.push_back( _free.back( ) );
+    _free.pop_back( );
+  }
+  // carve the rest out of the chunks, in reverse so that consecutive
+  // allocations walk forward through memory
+  int const carve = CACHE_BATCH - (int)cache.free.size( );
+  while ( _next + carve > (int)_chunks.size( ) * CHUNK_SIZE ) {
+    T * const chunk = new T[CHUNK_SIZE];
+    for ( int i = 0; i < CHUNK_SIZE; ++i ) {
+      chunk[i]._pool_index = _chunks.size( ) * CHUNK_SIZE + i;
+    }
+    _chunks.push_back( chunk );
+  }
+  for ( int i = _next + carve - 1; i >= _next; --i ) {
+    cache.free.push_back( &_chunks[i / CHUNK_SIZE][i % CHUNK_SIZE] );
+  }
+  _next += carve;
+}
+
+template<typename T>
+void ObjectPool<T>::_Spill( Cache & cache )
+{
+  lock_guard<mutex> lock( _mutex );
+  _free.insert( _free.end( ), cache.free.end( ) - CACHE_BATCH,
+		cache.free.end( ) );
+  cache.free.resize( cache.free.size( ) - CACHE_BATCH );
+}
+
+template<typename T>
+void ObjectPool<T>::Reset( )
+{
+  lock_guard<mutex> lock( _mutex );
+  _free.clear( );
+  _next = 0;
+  _outstanding = 0;
+  _epoch.fetch_add( 1, memory_order_release );
+}
+
+template<typename T>
+int ObjectPool<T>::Size( ) const
+{
+  lock_guard<mutex> lock( _mutex );
+  return _next;
+}
+
+template<typename T>
+T * ObjectPool<T>::Get( int index ) const
+{
+  lock_guard<mutex> lock( _mutex );
+  assert( ( index >= 0 ) && ( index < _next ) );
+  return &_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+}
+
+#endif
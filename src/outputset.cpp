@@ -34,13 +34,15 @@
  */
 
 #include <cassert>
+#include <cstdlib>
+#include <iostream>
 
 #include "booksim.hpp"
 #include "outputset.hpp"
 
 void OutputSet::Clear( )
 {
-  _outputs.clear( );
+  _num_outputs = 0;
 }
 
 void OutputSet::Add( int output_port, int vc, int pri  )
@@ -50,22 +52,38 @@ void OutputSet::Add( int output_port, int vc, int pri  )
 
 void OutputSet::AddRange( int output_port, int vc_start, int vc_end, int pri )
 {
+  // elements are keyed by priority alone: like the set<sSetElement> this 
+  // replaces, only the first range added at any given priority is kept
+  int pos = 0;
+  while ( ( pos < _num_outputs ) && ( _outputs[pos].pri > pri ) ) {
+    ++pos;
+  }
+  if ( ( pos < _num_outputs ) && ( _outputs[pos].pri == pri ) ) {
+    return;
+  }
+  if ( _num_outputs >= MAX_ELEMENTS ) {
+    cerr << "Error: Too many distinct priorities in output set." << endl;
+    exit(-1);
+  }
+  for ( int i = _num_outputs; i > pos; --i ) {
+    _outputs[i] = _outputs[i-1];
+  }
 
-  sSetElement s;
+  sSetElement & s = _outputs[pos];
 
   s.vc_start = vc_start;
   s.vc_end   = vc_end;
   s.pri      = pri;
   s.output_port = output_port;
-  _outputs.insert( s );
+  ++_num_outputs;
 }
 
-//legacy support, for performance, just use GetSet()
+//legacy support, for performance, just iterate over the set
 int OutputSet::NumVCs( int output_port ) const
 {
   int total = 0;
-  set<sSetElement>::const_iterator i = _outputs.begin( );
-  while(i!=_outputs.end( )){
+  const_iterator i = begin( );
+  while(i!=end( )){
     if(i->output_port == output_port){
       total += (i->vc_end - i->vc_start + 1);
     }
@@ -76,8 +94,8 @@ int OutputSet::NumVCs( int output_port ) const
 
 bool OutputSet::OutputEmpty( int output_port ) const
 {
-  set<sSetElement>::const_iterator i = _outputs.begin( );
-  while(i!=_outputs.end( )){
+  const_iterator i = begin( );
+  while(i!=end( )){
     if(i->output_port == output_port){
       return false;
     }
@@ -86,12 +104,7 @@ bool OutputSet::OutputEmpty( int output_port ) const
   return true;
 }
 
-
-const set<OutputSet::sSetElement> & OutputSet::GetSet() const{
-  return _outputs;
-}
-
-//legacy support, for performance, just use GetSet()
+//legacy support, for performance, just iterate over the set
 int OutputSet::GetVC( int output_port, int vc_index, int *pri ) const
 {
 
@@ -101,8 +114,8 @@ int OutputSet::GetVC( int output_port, int vc_index, int *pri ) const
   
   if ( pri ) { *pri = -1; }
 
-  set<sSetElement>::const_iterator i = _outputs.begin( );
-  while(i!=_outputs.end( )){
+  const_iterator i = begin( );
+  while(i!=end( )){
     if(i->output_port == output_port){
       range = i->vc_end - i->vc_start + 1;
       if ( remaining >= range ) {
@@ -120,7 +133,7 @@ int OutputSet::GetVC( int output_port, int vc_index, int *pri ) const
   return vc;
 }
 
-//legacy support, for performance, just use GetSet()
+//legacy support, for performance, just iterate over the set
 bool OutputSet::GetPortVC( int *out_port, int *out_vc ) const
 {
 
@@ -128,11 +141,11 @@ bool OutputSet::GetPortVC( int *out_port, int *out_vc ) const
   bool single_output = false;
   int  used_outputs  = 0;
 
-  set<sSetElement>::const_iterator i = _outputs.begin( );
-  if(i!=_outputs.end( )){
+  const_iterator i = begin( );
+  if(i!=end( )){
     used_outputs = i->output_port;
   }
-  while(i!=_outputs.end( )){
+  while(i!=end( )){
 
     if ( i->vc_start == i->vc_end ) {
       *out_vc   = i->vc_start;
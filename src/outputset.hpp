@@ -28,8 +28,6 @@
 #ifndef _OUTPUTSET_HPP_
 #define _OUTPUTSET_HPP_
 
-#include <set>
-
 class OutputSet {
 
 
@@ -41,26 +39,32 @@ public:
     int output_port;
   };
 
+  // elements are kept inline, ordered by decreasing priority
+  typedef sSetElement const * const_iterator;
+
+  static int const MAX_ELEMENTS = 8;
+
+  OutputSet( ) : _num_outputs( 0 ) { }
+
   void Clear( );
   void Add( int output_port, int vc, int pri = 0 );
   void AddRange( int output_port, int vc_start, int vc_end, int pri = 0 );
 
   bool OutputEmpty( int output_port ) const;
   int NumVCs( int output_port ) const;
-  
-  const set<sSetElement> & GetSet() const;
+
+  inline const_iterator begin( ) const { return _outputs; }
+  inline const_iterator end( ) const { return _outputs + _num_outputs; }
+  inline int size( ) const { return _num_outputs; }
+  inline bool empty( ) const { return !_num_outputs; }
 
   int  GetVC( int output_port,  int vc_index, int *pri = 0 ) const;
   bool GetPortVC( int *out_port, int *out_vc ) const;
 private:
-  set<sSetElement> _outputs;
+  sSetElement _outputs[MAX_ELEMENTS];
+  int _num_outputs;
 };
 
-inline bool operator<(const OutputSet::sSetElement & se1, 
-	       const OutputSet::sSetElement & se2) {
-  return se1.pri > se2.pri; // higher priorities first!
-}
-
 #endif
 
 
@@ -27,8 +27,8 @@
 
 #include "packet_reply_info.hpp"
 
-stack<PacketReplyInfo*> PacketReplyInfo::_all;
-stack<PacketReplyInfo*> PacketReplyInfo::_free;
+thread_local stack<PacketReplyInfo*> PacketReplyInfo::_all;
+thread_local stack<PacketReplyInfo*> PacketReplyInfo::_free;
 
 PacketReplyInfo * PacketReplyInfo::New()
 {
@@ -54,4 +54,8 @@ void PacketReplyInfo::FreeAll()
     delete _all.top();
     _all.pop();
   }
+  // the free list only ever holds objects we just deleted
+  while(!_free.empty()) {
+    _free.pop();
+  }
 }
@@ -47,8 +47,9 @@ public:
 
 private:
 
-  static stack<PacketReplyInfo*> _all;
-  static stack<PacketReplyInfo*> _free;
+  // per thread, like the simulation that uses them
+  static thread_local stack<PacketReplyInfo*> _all;
+  static thread_local stack<PacketReplyInfo*> _free;
 
   PacketReplyInfo() {}
   ~PacketReplyInfo() {}
@@ -28,6 +28,7 @@
 #include "buffer_monitor.hpp"
 
 #include "flit.hpp"
+#include "checkpoint.hpp"
 
 BufferMonitor::BufferMonitor( int inputs, int classes ) 
 : _cycles(0), _inputs(inputs), _classes(classes) {
@@ -69,3 +70,9 @@ ostream & operator<<( ostream & os, BufferMonitor const & obj ) {
   obj.display(os);
   return os ;
 }
+
+void BufferMonitor::serialize( Checkpoint & cp ) {
+  cp.Item( _cycles ) ;
+  cp.Item( _reads ) ;
+  cp.Item( _writes ) ;
+}
@@ -34,6 +34,7 @@
 using namespace std;
 
 class Flit;
+class Checkpoint;
 
 class BufferMonitor {
   int  _cycles ;
@@ -60,6 +61,7 @@ public:
     return _classes;
   }
   void display(ostream & os) const;
+  void serialize( Checkpoint & cp ) ;
 
 } ;
 
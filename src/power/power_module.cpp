@@ -235,7 +235,7 @@ void Power_Module::calcBuffer(const BufferMonitor *bm){
       double ar = ((double)reads[i* classes+j])/totalTime;
       double aw = ((double)writes[i* classes+j])/totalTime;
       if(ar>1 ||aw >1){
-	cout<<"activity factor is greater than one, soemthing is stomping memory\n"; exit(-1);
+	cerr<<"activity factor is greater than one, soemthing is stomping memory\n"; exit(-1);
       }
       double Pwl =  powerWordLine( channel_width, depth) ;
       double Prd = powerMemoryBitRead( depth ) * channel_width ;
@@ -317,7 +317,7 @@ void Power_Module::calcSwitch(const SwitchMonitor* sm){
 	double a = activity[k+classes*(i+sm->NumOutputs()*j)];
 	a = a/totalTime;
 	if(a>1){
-	  cout<<"Switcht activity factor is greater than 1!!!\n";exit(-1);
+	  cerr<<"Switcht activity factor is greater than 1!!!\n";exit(-1);
 	}
 	double Px = powerCrossbar(channel_width, sm->NumInputs(),sm->NumOutputs(),j,i);
 	switchPower += a*channel_width*Px;
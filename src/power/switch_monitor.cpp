@@ -28,6 +28,7 @@
 #include "switch_monitor.hpp"
 
 #include "flit.hpp"
+#include "checkpoint.hpp"
 
 SwitchMonitor::SwitchMonitor( int inputs, int outputs, int classes )
 : _cycles(0), _inputs(inputs), _outputs(outputs), _classes(classes) {
@@ -65,3 +66,8 @@ ostream & operator<<( ostream & os, SwitchMonitor const & obj ) {
   obj.display(os);
   return os ;
 }
+
+void SwitchMonitor::serialize( Checkpoint & cp ) {
+  cp.Item( _cycles ) ;
+  cp.Item( _event ) ;
+}
@@ -26,21 +26,81 @@
 */
 
 #include "random_utils.hpp"
+#include "simulation_globals.hpp"
+#include "checkpoint.hpp"
 #include <algorithm>
 #include <cassert>
 
-extern long ran_x[];
-extern double ran_u[];
-#define KK 100
+#define KK RandomState::LAG
+
+static RandomState gProcessRandomState;
+
+thread_local RandomState * gRandomState = &gProcessRandomState;
+REGISTER_SIMULATION_GLOBAL(gRandomState);
+
+thread_local tRandomOrderHook gRandomOrderHook = 0;
+
+thread_local RandomStream * gRandomStream = NULL;
+
+RandomStream::RandomStream( std::string const & name )
+  : _id( 14695981039346656037ULL ), _cycle( -1 ), _draws( 0 )
+{
+  // FNV-1a hash of the name
+  for ( size_t i = 0; i < name.size( ); ++i ) {
+    _id = ( _id ^ (unsigned char)name[i] ) * 1099511628211ULL;
+  }
+}
+
+void RandomStream::_NextBlock( )
+{
+  uint64_t const seed = (uint64_t)gRandomState->stream_seed;
+  uint32_t const key[2] = { (uint32_t)seed, (uint32_t)( seed >> 32 ) };
+  _block[0] = _draws >> 2;
+  _block[1] = (uint32_t)_cycle;
+  _block[2] = (uint32_t)_id;
+  _block[3] = (uint32_t)( _id >> 32 );
+  Philox4x32( _block, key );
+}
 
 void SaveRandomState( std::vector<long> & save_x, std::vector<double> & save_u ) {
-  save_x.assign(ran_x, ran_x + KK);
-  save_u.assign(ran_u, ran_u + KK);
+  save_x.assign(gRandomState->ran_x, gRandomState->ran_x + KK);
+  save_u.assign(gRandomState->ran_u, gRandomState->ran_u + KK);
 }
 
 void RestoreRandomState( std::vector<long> const & save_x, std::vector<double> const & save_u) {
   assert(save_x.size() == KK);
-  std::copy(save_x.begin(), save_x.end(), ran_x);
+  std::copy(save_x.begin(), save_x.end(), gRandomState->ran_x);
   assert(save_u.size() == KK);
-  std::copy(save_u.begin(), save_u.end(), ran_u);
+  std::copy(save_u.begin(), save_u.end(), gRandomState->ran_u);
+}
+
+// the read pointers are stored as offsets into the batch, or as -1 and -2
+// for the sentinels that trigger the generation of the first batch
+template<typename T>
+static void SerializeBatchPointer( Checkpoint & cp, T * & ptr, T * buf,
+				   T * dummy, T * started )
+{
+  long offset = ( ptr == dummy ) ? -1 : ( ptr == started ) ? -2 : ( ptr - buf );
+  cp.Item( offset );
+  if ( !cp.Saving( ) ) {
+    ptr = ( offset == -1 ) ? dummy : ( offset == -2 ) ? started : ( buf + offset );
+  }
+}
+
+void SerializeRandomState( Checkpoint & cp ) {
+  RandomState & s = *gRandomState;
+  cp.Section( "random" );
+  cp.Item( s.ran_x );
+  cp.Item( s.ran_arr_buf );
+  cp.Item( s.ran_arr_dummy );
+  cp.Item( s.ran_arr_started );
+  SerializeBatchPointer( cp, s.ran_arr_ptr, s.ran_arr_buf, 
+			 &s.ran_arr_dummy, &s.ran_arr_started );
+  cp.Item( s.ran_u );
+  cp.Item( s.ranf_arr_buf );
+  cp.Item( s.ranf_arr_dummy );
+  cp.Item( s.ranf_arr_started );
+  SerializeBatchPointer( cp, s.ranf_arr_ptr, s.ranf_arr_buf, 
+			 &s.ranf_arr_dummy, &s.ranf_arr_started );
+  cp.Item( s.stream_seed );
 }
@@ -29,6 +29,8 @@
 #define _RANDOM_UTILS_HPP_
 
 #include <vector>
+#include <string>
+#include <cstdint>
 
 // interface to Knuth's RANARRAY RNG
 void   ran_start(long seed);
@@ -36,28 +38,170 @@ long   ran_next( );
 void   ranf_start(long seed);
 double ranf_next( );
 
+// State of both generators. Every thread starts out using one state shared
+// by the whole process; simulations running side by side point their
+// threads at states of their own.
+struct RandomState {
+  static int const LAG     = 100;  // KK in rng.c and rng-double.c
+  static int const QUALITY = 1009;
+
+  long     ran_x[LAG];
+  long     ran_arr_buf[QUALITY];
+  long     ran_arr_dummy, ran_arr_started;
+  long *   ran_arr_ptr;
+
+  double   ran_u[LAG];
+  double   ranf_arr_buf[QUALITY];
+  double   ranf_arr_dummy, ranf_arr_started;
+  double * ranf_arr_ptr;
+
+  // key of the per-component streams (see RandomStream)
+  long     stream_seed;
+
+  constexpr RandomState( )
+    : ran_x( ), ran_arr_buf( ), ran_arr_dummy( -1 ), ran_arr_started( -1 ),
+      ran_arr_ptr( &ran_arr_dummy ), ran_u( ), ranf_arr_buf( ),
+      ranf_arr_dummy( -1.0 ), ranf_arr_started( -1.0 ),
+      ranf_arr_ptr( &ranf_arr_dummy ), stream_seed( 0 ) { }
+private:
+  // the read pointers point into the state itself
+  RandomState( RandomState const & );
+  RandomState & operator=( RandomState const & );
+};
+
+extern thread_local RandomState * gRandomState;
+
+// Parallel engines that must reproduce the draw sequence of a serial run 
+// install a hook here that blocks the calling thread until it is its turn.
+typedef void (*tRandomOrderHook)( );
+extern thread_local tRandomOrderHook gRandomOrderHook;
+
+inline void RandomWaitTurn( ) {
+  if ( gRandomOrderHook ) {
+    gRandomOrderHook( );
+  }
+}
+
+// Philox4x32-10 counter-based generator: encrypts the counter with the 
+// key, so every (key, counter) pair yields four independent random words
+inline void Philox4x32( uint32_t ctr[4], uint32_t const key[2] ) {
+  uint32_t k0 = key[0], k1 = key[1];
+  for ( int round = 0; round < 10; ++round ) {
+    uint64_t const p0 = (uint64_t)0xD2511F53 * ctr[0];
+    uint64_t const p1 = (uint64_t)0xCD9E8D57 * ctr[2];
+    uint32_t const c1 = ctr[1];
+    ctr[0] = (uint32_t)( p1 >> 32 ) ^ c1 ^ k0;
+    ctr[1] = (uint32_t)p1;
+    ctr[2] = (uint32_t)( p0 >> 32 ) ^ ctr[3] ^ k1;
+    ctr[3] = (uint32_t)p0;
+    k0 += 0x9E3779B9;
+    k1 += 0xBB67AE85;
+  }
+}
+
+// Random numbers private to one component (a router, an injection node, 
+// ...). The n-th number a component draws in a given cycle only depends on
+// the seed, the component's name, the cycle and n, so results do not 
+// depend on the order in which components are evaluated.
+class RandomStream {
+  uint64_t _id;
+  long     _cycle;
+  uint32_t _draws;
+  uint32_t _block[4];
+
+public:
+  RandomStream( std::string const & name );
+
+  // starts counting draws from zero whenever a new cycle begins
+  inline void SetCycle( long cycle ) {
+    if ( cycle != _cycle ) {
+      _cycle = cycle;
+      _draws = 0;
+    }
+  }
+
+  inline uint32_t Next( ) {
+    uint32_t const word = _draws & 3;
+    if ( word == 0 ) {
+      _NextBlock( );
+    }
+    ++_draws;
+    return _block[word];
+  }
+
+  // uniform in [0,1) with 53 bits of precision
+  inline double NextFloat( ) {
+    uint32_t const hi = Next( ) >> 5;
+    uint32_t const lo = Next( ) >> 6;
+    return ( hi * 67108864.0 + lo ) * ( 1.0 / 9007199254740992.0 );
+  }
+
+private:
+  void _NextBlock( );
+};
+
+// Stream that random numbers are drawn from instead of the global 
+// generators (NULL to use the latter)
+extern thread_local RandomStream * gRandomStream;
+
+// Draws from the given stream for the lifetime of the scope; does nothing
+// if the stream is NULL
+class RandomStreamScope {
+  RandomStream * _saved;
+public:
+  inline RandomStreamScope( RandomStream * stream, long cycle )
+    : _saved( gRandomStream ) {
+    if ( stream ) {
+      stream->SetCycle( cycle );
+      gRandomStream = stream;
+    }
+  }
+  inline ~RandomStreamScope( ) {
+    gRandomStream = _saved;
+  }
+private:
+  RandomStreamScope( RandomStreamScope const & );
+  RandomStreamScope & operator=( RandomStreamScope const & );
+};
+
 inline void RandomSeed( long seed ) {
   ran_start( seed );
   ranf_start( seed );
 }
 
+inline void RandomStreamSeed( long seed ) {
+  gRandomState->stream_seed = seed;
+}
+
 inline unsigned long RandomIntLong( ) {
+  if ( gRandomStream ) {
+    return ( gRandomStream->Next( ) >> 2 ); // 30 bits, like ran_next
+  }
+  RandomWaitTurn( );
   return ran_next( );
 }
 
 // Returns a random integer in the range [0,max]
 inline int RandomInt( int max ) {
+  if ( gRandomStream ) {
+    return ( gRandomStream->Next( ) % (uint32_t)(max+1) );
+  }
+  RandomWaitTurn( );
   return ( ran_next( ) % (max+1) );
 }
 
 // Returns a random floating-point value in the rage [0,1]
 inline double RandomFloat(  ) {
+  if ( gRandomStream ) {
+    return gRandomStream->NextFloat( );
+  }
+  RandomWaitTurn( );
   return ranf_next( );
 }
 
 // Returns a random floating-point value in the rage [0,max]
 inline double RandomFloat( double max ) {
-  return ( ranf_next( ) * max );
+  return ( RandomFloat( ) * max );
 }
 
 // Saves the current generator state
@@ -66,4 +210,9 @@ void SaveRandomState( std::vector<long> & save_x, std::vector<double> & save_u )
 // Restores the generator state from previously saved values
 void RestoreRandomState( std::vector<long> const & save_x, std::vector<double> const & save_u );
 
+// Saves or restores the complete state of both generators, including the
+// position within the current batch of random numbers
+class Checkpoint;
+void SerializeRandomState( Checkpoint & cp );
+
 #endif
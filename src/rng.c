@@ -22,7 +22,9 @@
 #define MM (1L<<30)                 /* the modulus */
 #define mod_diff(x,y) (((x)-(y))&(MM-1)) /* subtraction mod MM */
 
+#ifndef RAN_STATE_EXTERNAL         /* BookSim keeps it per simulation */
 long ran_x[KK];                    /* the generator state */
+#endif
 
 #ifdef __STDC__
 void ran_array(long aa[],int n)
@@ -43,9 +45,11 @@ void ran_array(aa,n)    /* put n new random numbers in aa */
 /* after calling ran_start, get new randoms by, e.g., "x=ran_arr_next()" */
 
 #define QUALITY 1009 /* recommended quality level for high-res use */
+#ifndef RAN_STATE_EXTERNAL
 long ran_arr_buf[QUALITY];
 long ran_arr_dummy=-1, ran_arr_started=-1;
 long *ran_arr_ptr=&ran_arr_dummy; /* the next random number, or -1 */
+#endif
 
 #define TT  70   /* guaranteed separation between streams */
 #define is_odd(x)  ((x)&1)          /* units bit of x */
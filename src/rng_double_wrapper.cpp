@@ -25,6 +25,15 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "random_utils.hpp"
+
+#define RAN_STATE_EXTERNAL
+#define ran_u            (gRandomState->ran_u)
+#define ranf_arr_buf     (gRandomState->ranf_arr_buf)
+#define ranf_arr_dummy   (gRandomState->ranf_arr_dummy)
+#define ranf_arr_started (gRandomState->ranf_arr_started)
+#define ranf_arr_ptr     (gRandomState->ranf_arr_ptr)
+
 #define main rng_double_main
 #include "rng-double.c"
 
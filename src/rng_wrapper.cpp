@@ -25,6 +25,15 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "random_utils.hpp"
+
+#define RAN_STATE_EXTERNAL
+#define ran_x           (gRandomState->ran_x)
+#define ran_arr_buf     (gRandomState->ran_arr_buf)
+#define ran_arr_dummy   (gRandomState->ran_arr_dummy)
+#define ran_arr_started (gRandomState->ran_arr_started)
+#define ran_arr_ptr     (gRandomState->ran_arr_ptr)
+
 #define main rng_main
 #include "rng.c"
 
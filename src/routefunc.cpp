@@ -49,14 +49,30 @@
 #include "tree4.hpp"
 #include "qtree.hpp"
 #include "cmesh.hpp"
+#include "simulation_globals.hpp"
 
 
 
 map<string, tRoutingFunction> gRoutingFunctionMap;
+map<tRoutingFunction, tRoutingTableCompiler> gRoutingTableCompilerMap;
+map<string, tMulticastRoutingFunction> gMulticastRoutingFunctionMap;
+
+/* Routing table of the routing function in use (if it has been compiled) */
+
+thread_local tRoutingFunction gRoutingTableFunction = NULL;
+thread_local int gRoutingTableNodes = 0;
+thread_local RoutingTableEntry const * gRoutingTable = NULL;
+REGISTER_SIMULATION_GLOBAL(gRoutingTableFunction);
+REGISTER_SIMULATION_GLOBAL(gRoutingTableNodes);
+REGISTER_SIMULATION_GLOBAL(gRoutingTable);
+
+// owned by the thread running the simulation
+static thread_local vector<RoutingTableEntry> tRoutingTableStorage;
 
 /* Global information used by routing functions */
 
-int gNumVCs;
+thread_local int gNumVCs;
+REGISTER_SIMULATION_GLOBAL(gNumVCs);
 
 /* Add more functions here
  *
@@ -64,10 +80,18 @@ int gNumVCs;
 
 // ============================================================
 //  Balfour-Schultz
-int gReadReqBeginVC, gReadReqEndVC;
-int gWriteReqBeginVC, gWriteReqEndVC;
-int gReadReplyBeginVC, gReadReplyEndVC;
-int gWriteReplyBeginVC, gWriteReplyEndVC;
+thread_local int gReadReqBeginVC, gReadReqEndVC;
+thread_local int gWriteReqBeginVC, gWriteReqEndVC;
+thread_local int gReadReplyBeginVC, gReadReplyEndVC;
+thread_local int gWriteReplyBeginVC, gWriteReplyEndVC;
+REGISTER_SIMULATION_GLOBAL(gReadReqBeginVC);
+REGISTER_SIMULATION_GLOBAL(gReadReqEndVC);
+REGISTER_SIMULATION_GLOBAL(gWriteReqBeginVC);
+REGISTER_SIMULATION_GLOBAL(gWriteReqEndVC);
+REGISTER_SIMULATION_GLOBAL(gReadReplyBeginVC);
+REGISTER_SIMULATION_GLOBAL(gReadReplyEndVC);
+REGISTER_SIMULATION_GLOBAL(gWriteReplyBeginVC);
+REGISTER_SIMULATION_GLOBAL(gWriteReplyEndVC);
 
 // ============================================================
 //  QTree: Nearest Common Ancestor
@@ -640,9 +664,19 @@ void dor_next_torus( int cur, int dest, int in_port,
 
 //=============================================================
 
+void dim_order_mesh_table( int router, int dest, RoutingTableEntry * entry )
+{
+  entry->port = dor_next_mesh( router, dest );
+}
+
 void dim_order_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
 {
-  int out_port = inject ? -1 : dor_next_mesh( r->GetID( ), f->dest );
+  int out_port = -1;
+  if ( !inject ) {
+    RoutingTableEntry const * const entry =
+      LookupRoutingTable( &dim_order_mesh, r->GetID( ), f->dest );
+    out_port = entry ? entry->port : dor_next_mesh( r->GetID( ), f->dest );
+  }
   
   int vcBegin = 0, vcEnd = gNumVCs-1;
   if ( f->type == Flit::READ_REQUEST ) {
@@ -677,6 +711,80 @@ void dim_order_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *
   outputs->AddRange( out_port, vcBegin, vcEnd );
 }
 
+//=============================================================
+// Multicast tree routing: every destination of a multicast packet follows
+// its unicast route, and the packet forks wherever the routes part ways.
+// With dimension-order routing on a mesh, this builds an XY-tree.
+
+void SplitMulticast( const Router *r, const Flit *f, 
+		     int (*next_port)( int router, int dest ), 
+		     vector<MulticastBranch> *branches )
+{
+  int vcBegin = 0, vcEnd = gNumVCs-1;
+  if ( f->type == Flit::READ_REQUEST ) {
+    vcBegin = gReadReqBeginVC;
+    vcEnd = gReadReqEndVC;
+  } else if ( f->type == Flit::WRITE_REQUEST ) {
+    vcBegin = gWriteReqBeginVC;
+    vcEnd = gWriteReqEndVC;
+  } else if ( f->type ==  Flit::READ_REPLY ) {
+    vcBegin = gReadReplyBeginVC;
+    vcEnd = gReadReplyEndVC;
+  } else if ( f->type ==  Flit::WRITE_REPLY ) {
+    vcBegin = gWriteReplyBeginVC;
+    vcEnd = gWriteReplyEndVC;
+  }
+  assert((f->vc >= vcBegin) && (f->vc <= vcEnd));
+
+  branches->clear();
+
+  // branches are listed in the order their first destination appears in
+  for ( vector<int>::const_iterator iter = f->dests.begin( );
+	iter != f->dests.end( ); ++iter ) {
+    int const out_port = next_port( r->GetID( ), *iter );
+    vector<MulticastBranch>::iterator branch = branches->begin( );
+    while ( ( branch != branches->end( ) ) && 
+	    ( branch->output_port != out_port ) ) {
+      ++branch;
+    }
+    if ( branch == branches->end( ) ) {
+      branches->push_back( MulticastBranch( ) );
+      branch = branches->end( ) - 1;
+      branch->output_port = out_port;
+      branch->vc_start = vcBegin;
+      branch->vc_end = vcEnd;
+    }
+    branch->dests.push_back( *iter );
+  }
+
+  if ( f->watch ) {
+    for ( vector<MulticastBranch>::const_iterator branch = branches->begin( );
+	  branch != branches->end( ); ++branch ) {
+      *gWatchOut << GetSimTime() << " | " << r->FullName() << " | "
+		 << "Adding branch with VC range [" 
+		 << branch->vc_start << "," 
+		 << branch->vc_end << "]"
+		 << " at output port " << branch->output_port
+		 << " for " << branch->dests.size( ) << " destination(s)"
+		 << " of flit " << f->id
+		 << "." << endl;
+    }
+  }
+}
+
+static int dor_tree_mesh_port( int router, int dest )
+{
+  RoutingTableEntry const * const entry =
+    LookupRoutingTable( &dim_order_mesh, router, dest );
+  return entry ? entry->port : dor_next_mesh( router, dest );
+}
+
+void dor_tree_mesh( const Router *r, const Flit *f, int in_channel, 
+		    vector<MulticastBranch> *branches )
+{
+  SplitMulticast( r, f, &dor_tree_mesh_port, branches );
+}
+
 //=============================================================
 
 void dim_order_ni_mesh( const Router *r, const Flit *f, int in_channel, OutputSet *outputs, bool inject )
@@ -1514,6 +1622,34 @@ void valiant_ni_torus( const Router *r, const Flit *f, int in_channel,
 
 //=============================================================
 
+void dim_order_torus_table( int router, int dest, RoutingTableEntry * entry )
+{
+  // the route taken when turning into the next dimension; a packet that
+  // continues along its current dimension just keeps going straight
+  int dim_left;
+  for ( dim_left = 0; dim_left < gN; ++dim_left ) {
+    if ( ( router % gK ) != ( dest % gK ) ) { break; }
+    router /= gK; dest /= gK;
+  }
+  entry->partition = 0;
+  if ( dim_left == gN ) {
+    entry->port = 2*gN;  // Eject
+    return;
+  }
+  int const cur = router % gK;
+  int const dst = dest % gK;
+  int const dist2 = gK - 2 * ( ( dst - cur + gK ) % gK );
+  if ( dist2 == 0 ) {
+    entry->port = -1;    // both directions are minimal, pick one at random
+  } else if ( dist2 > 0 ) {
+    entry->port = 2*dim_left;     // Right
+    entry->partition = ( cur > dst ) ? 1 : 0;
+  } else {
+    entry->port = 2*dim_left + 1; // Left
+    entry->partition = ( dst < cur ) ? 1 : 0;
+  }
+}
+
 void dim_order_torus( const Router *r, const Flit *f, int in_channel, 
 		      OutputSet *outputs, bool inject )
 {
@@ -1544,8 +1680,19 @@ void dim_order_torus( const Router *r, const Flit *f, int in_channel,
     int cur  = r->GetID( );
     int dest = f->dest;
 
-    dor_next_torus( cur, dest, in_channel,
-		    &out_port, &f->ph, false );
+    RoutingTableEntry const * const entry =
+      LookupRoutingTable( &dim_order_torus, cur, dest );
+    if ( !entry ) {
+      dor_next_torus( cur, dest, in_channel,
+		      &out_port, &f->ph, false );
+    } else if ( entry->port == 2*gN ) {
+      out_port = 2*gN;
+    } else if ( ( in_channel / 2 ) == ( entry->port / 2 ) ) {
+      out_port = in_channel ^ 0x1;
+    } else {
+      out_port = entry->port;
+      f->ph = entry->partition;
+    }
 
 
     // at the destination router, we don't need to separate VCs by ring partition
@@ -1795,6 +1942,23 @@ void min_adapt_torus( const Router *r, const Flit *f, int in_channel, OutputSet
 
 //=============================================================
 
+int dest_tag_fly_port( int router, int dest )
+{
+  int stage = ( router * gK ) / gNodes;
+
+  while( stage < ( gN - 1 ) ) {
+    dest /= gK;
+    ++stage;
+  }
+
+  return dest % gK;
+}
+
+void dest_tag_fly_table( int router, int dest, RoutingTableEntry * entry )
+{
+  entry->port = dest_tag_fly_port( router, dest );
+}
+
 void dest_tag_fly( const Router *r, const Flit *f, int in_channel, 
 		   OutputSet *outputs, bool inject )
 {
@@ -1822,15 +1986,9 @@ void dest_tag_fly( const Router *r, const Flit *f, int in_channel,
 
   } else {
 
-    int stage = ( r->GetID( ) * gK ) / gNodes;
-    int dest  = f->dest;
-
-    while( stage < ( gN - 1 ) ) {
-      dest /= gK;
-      ++stage;
-    }
-
-    out_port = dest % gK;
+    RoutingTableEntry const * const entry =
+      LookupRoutingTable( &dest_tag_fly, r->GetID( ), f->dest );
+    out_port = entry ? entry->port : dest_tag_fly_port( r->GetID( ), f->dest );
   }
 
   outputs->Clear( );
@@ -1996,4 +2154,55 @@ void InitializeRoutingMap( const Configuration & config )
 
   gRoutingFunctionMap["chaos_mesh"]  = &chaos_mesh;
   gRoutingFunctionMap["chaos_torus"] = &chaos_torus;
+
+  /* Register multicast routing functions here */
+
+  gMulticastRoutingFunctionMap["dor_tree_mesh"] = &dor_tree_mesh;
+
+  /* Register routing table compilers here */
+
+  gRoutingTableCompilerMap[&dim_order_mesh]  = &dim_order_mesh_table;
+  gRoutingTableCompilerMap[&dim_order_torus] = &dim_order_torus_table;
+  gRoutingTableCompilerMap[&dest_tag_fly]    = &dest_tag_fly_table;
+
+  // tables are compiled for each network once it has been built
+  gRoutingTableFunction = NULL;
+  gRoutingTableNodes = 0;
+  gRoutingTable = NULL;
+  tRoutingTableStorage.clear( );
+}
+
+void CompileRoutingTable( const Configuration & config, int routers, int nodes )
+{
+  gRoutingTableFunction = NULL;
+  gRoutingTableNodes = 0;
+  gRoutingTable = NULL;
+  tRoutingTableStorage.clear( );
+
+  if ( config.GetInt( "routing_table" ) <= 0 ) {
+    return;
+  }
+
+  string const rf = config.GetStr("routing_function") + "_" + config.GetStr("topology");
+  map<string, tRoutingFunction>::const_iterator rf_iter = gRoutingFunctionMap.find(rf);
+  if ( rf_iter == gRoutingFunctionMap.end( ) ) {
+    return; // the routers will complain about it
+  }
+  map<tRoutingFunction, tRoutingTableCompiler>::const_iterator compiler_iter =
+    gRoutingTableCompilerMap.find( rf_iter->second );
+  if ( compiler_iter == gRoutingTableCompilerMap.end( ) ) {
+    return; // not deterministic, keep computing routes per flit
+  }
+
+  RoutingTableEntry const unknown = { -1, 0 };
+  tRoutingTableStorage.assign( (size_t)routers * nodes, unknown );
+  for ( int r = 0; r < routers; ++r ) {
+    for ( int d = 0; d < nodes; ++d ) {
+      RoutingTableEntry & entry = tRoutingTableStorage[(size_t)r * nodes + d];
+      compiler_iter->second( r, d, &entry );
+    }
+  }
+  gRoutingTable = tRoutingTableStorage.data( );
+  gRoutingTableNodes = nodes;
+  gRoutingTableFunction = rf_iter->second;
 }
@@ -35,14 +35,60 @@
 
 typedef void (*tRoutingFunction)( const Router *, const Flit *, int in_channel, OutputSet *, bool );
 
+// Precomputed route of a deterministic routing function from one router to
+// one destination; a negative port means the route has to be computed per
+// flit (e.g. because it involves a random tie-break)
+struct RoutingTableEntry {
+  short port;
+  short partition;
+};
+
+typedef void (*tRoutingTableCompiler)( int router, int dest, RoutingTableEntry * entry );
+
+// A multicast packet forks into one branch per output port its destinations
+// are routed to; each branch is allocated a VC from its range and carries
+// the destinations that are reached through its port
+struct MulticastBranch {
+  int output_port;
+  int vc_start;
+  int vc_end;
+  vector<int> dests;
+};
+
+typedef void (*tMulticastRoutingFunction)( const Router *, const Flit *, int in_channel, vector<MulticastBranch> * );
+
+// Splits the destinations of a multicast flit among the output ports that
+// next_port( router, dest ) routes them to
+void SplitMulticast( const Router *r, const Flit *f, 
+		     int (*next_port)( int router, int dest ), 
+		     vector<MulticastBranch> *branches );
+
 void InitializeRoutingMap( const Configuration & config );
+void CompileRoutingTable( const Configuration & config, int routers, int nodes );
 
 extern map<string, tRoutingFunction> gRoutingFunctionMap;
+extern map<tRoutingFunction, tRoutingTableCompiler> gRoutingTableCompilerMap;
+extern map<string, tMulticastRoutingFunction> gMulticastRoutingFunctionMap;
+
+extern thread_local tRoutingFunction gRoutingTableFunction;
+extern thread_local int gRoutingTableNodes;
+extern thread_local RoutingTableEntry const * gRoutingTable;
+
+inline RoutingTableEntry const * LookupRoutingTable( tRoutingFunction rf,
+						     int router, int dest )
+{
+  if ( gRoutingTableFunction != rf ) {
+    return NULL;
+  }
+  RoutingTableEntry const * const entry =
+    gRoutingTable + router * gRoutingTableNodes + dest;
+  return ( entry->port >= 0 ) ? entry : NULL;
+}
 
-extern int gNumVCs;
-extern int gReadReqBeginVC, gReadReqEndVC;
-extern int gWriteReqBeginVC, gWriteReqEndVC;
-extern int gReadReplyBeginVC, gReadReplyEndVC;
-extern int gWriteReplyBeginVC, gWriteReplyEndVC;
+extern thread_local int gNumVCs;
+extern thread_local int gReadReqBeginVC, gReadReqEndVC;
+extern thread_local int gWriteReqBeginVC, gWriteReqEndVC;
+extern thread_local int gReadReplyBeginVC, gReadReplyEndVC;
+extern thread_local int gWriteReplyBeginVC, gWriteReplyEndVC;
 
 #endif
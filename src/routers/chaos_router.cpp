@@ -126,7 +126,7 @@ ChaosRouter::~ChaosRouter( )
   }
 }
   
-void ChaosRouter::ReadInputs( )
+void ChaosRouter::ReadInputs( int time )
 {
   Flit   *f;
   Credit *c;
@@ -232,7 +232,7 @@ void ChaosRouter::_InternalStep( )
   _crossbar_pipe->Advance( );
 }
 
-void ChaosRouter::WriteOutputs( )
+void ChaosRouter::WriteOutputs( int time )
 {
   _SendFlits( );
   _SendCredits( );
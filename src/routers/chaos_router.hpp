@@ -111,8 +111,8 @@ public:
 
   virtual ~ChaosRouter( );
 
-  virtual void ReadInputs( );
-  virtual void WriteOutputs( );
+  virtual void ReadInputs( int time );
+  virtual void WriteOutputs( int time );
 
   virtual int GetUsedCredit(int out) const {return 0;}
   virtual int GetBufferOccupancy(int i) const {return 0;}
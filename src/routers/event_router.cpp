@@ -158,7 +158,7 @@ EventRouter::~EventRouter( )
   delete _arrival_pipe;
 }
   
-void EventRouter::ReadInputs( )
+void EventRouter::ReadInputs( int time )
 {
   _ReceiveFlits( );
   _ReceiveCredits( );
@@ -212,7 +212,7 @@ void EventRouter::_InternalStep( )
   _OutputQueuing( );
 }
 
-void EventRouter::WriteOutputs( )
+void EventRouter::WriteOutputs( int time )
 {
   _SendFlits( );
   _SendCredits( );
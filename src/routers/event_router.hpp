@@ -166,8 +166,8 @@ public:
 	       int inputs, int outputs );
   virtual ~EventRouter( );
 
-  virtual void ReadInputs( );
-  virtual void WriteOutputs( );
+  virtual void ReadInputs( int time );
+  virtual void WriteOutputs( int time );
 
   virtual int GetUsedCredit(int o) const {return 0;}
   virtual int GetBufferOccupancy(int i) const {return 0;}
@@ -34,6 +34,7 @@
 #include <cstdlib>
 #include <cassert>
 #include <limits>
+#include <cmath>
 
 #include "globals.hpp"
 #include "random_utils.hpp"
@@ -44,9 +45,91 @@
 #include "buffer_state.hpp"
 #include "roundrobin_arb.hpp"
 #include "allocator.hpp"
+#include "islip.hpp"
+#include "separable_input_first.hpp"
 #include "switch_monitor.hpp"
 #include "buffer_monitor.hpp"
 
+// sets the destinations of a multicast head flit to those of a branch; a
+// branch with a single destination continues as a unicast packet
+static void RestrictToBranch(Flit * f, MulticastBranch const & branch)
+{
+  if(branch.dests.size() == 1) {
+    f->dest = branch.dests.front();
+    f->dests.clear();
+  } else {
+    f->dests = branch.dests;
+  }
+}
+
+struct IQRouter::RuntimePipeline {
+  typedef Allocator tAllocator;
+  static inline bool Speculative(IQRouter const * r) { return r->_speculative; }
+  static inline bool Lookahead(IQRouter const * r) { return !r->_routing_delay; }
+  static inline bool NOQ(IQRouter const * r) { return r->_noq; }
+  static inline bool HoldSwitch(IQRouter const * r) { return r->_hold_switch_for_packet; }
+  static inline bool HasVCAllocator(IQRouter const * r) { return r->_vc_allocator; }
+};
+
+// the VC and switch allocators are both of class A
+template<bool speculative, bool lookahead, bool noq, bool hold_switch, class A>
+struct IQRouter::StaticPipeline {
+  typedef A tAllocator;
+  static inline bool Speculative(IQRouter const *) { return speculative; }
+  static inline bool Lookahead(IQRouter const *) { return lookahead; }
+  static inline bool NOQ(IQRouter const *) { return noq; }
+  static inline bool HoldSwitch(IQRouter const *) { return hold_switch; }
+  static inline bool HasVCAllocator(IQRouter const *) { return true; }
+};
+
+// An IQRouter whose pipeline is compiled for the settings in P.
+template<class P>
+class IQRouterT : public IQRouter {
+
+  virtual void _InternalStep( ) { _Step<P>( ); }
+
+public:
+
+  IQRouterT( Configuration const & config, Module *parent, 
+	     string const & name, int id, int inputs, int outputs )
+    : IQRouter( config, parent, name, id, inputs, outputs ) { }
+
+};
+
+IQRouter * IQRouter::New( Configuration const & config, Module *parent, 
+			  string const & name, int id, 
+			  int inputs, int outputs )
+{
+  string const vc_alloc_type = config.GetStr( "vc_allocator" );
+  string const sw_alloc_type = config.GetStr( "sw_allocator" );
+  // parameters do not change the allocator class
+  string const alloc_name = sw_alloc_type.substr( 0, sw_alloc_type.find( '(' ) );
+  bool const lookahead = ( config.GetInt( "routing_delay" ) == 0 );
+
+  if ( ( config.GetInt( "specialized_pipeline" ) > 0 ) &&
+       ( config.GetInt( "speculative" ) == 0 ) &&
+       ( config.GetInt( "noq" ) == 0 ) &&
+       ( config.GetInt( "hold_switch_for_packet" ) == 0 ) &&
+       ( vc_alloc_type.substr( 0, vc_alloc_type.find( '(' ) ) == alloc_name ) ) {
+    if ( alloc_name == "islip" ) {
+      if ( lookahead ) {
+	return new IQRouterT<StaticPipeline<false, true, false, false, iSLIP_Sparse> >
+	  ( config, parent, name, id, inputs, outputs );
+      }
+      return new IQRouterT<StaticPipeline<false, false, false, false, iSLIP_Sparse> >
+	( config, parent, name, id, inputs, outputs );
+    } else if ( alloc_name == "separable_input_first" ) {
+      if ( lookahead ) {
+	return new IQRouterT<StaticPipeline<false, true, false, false, SeparableInputFirstAllocator> >
+	  ( config, parent, name, id, inputs, outputs );
+      }
+      return new IQRouterT<StaticPipeline<false, false, false, false, SeparableInputFirstAllocator> >
+	( config, parent, name, id, inputs, outputs );
+    }
+  }
+  return new IQRouter( config, parent, name, id, inputs, outputs );
+}
+
 IQRouter::IQRouter( Configuration const & config, Module *parent, 
 		    string const & name, int id, int inputs, int outputs )
 : Router( config, parent, name, id, inputs, outputs ), _active(false)
@@ -80,6 +163,20 @@ IQRouter::IQRouter( Configuration const & config, Module *parent,
   }
   _rf = rf_iter->second;
 
+  _mrf = NULL;
+  string const mrf = config.GetStr("multicast_routing_function");
+  if(mrf != "none") {
+    string const mrf_name = mrf + "_" + config.GetStr("topology");
+    map<string, tMulticastRoutingFunction>::const_iterator mrf_iter
+      = gMulticastRoutingFunctionMap.find(mrf_name);
+    if(mrf_iter == gMulticastRoutingFunctionMap.end()) {
+      Error("Invalid multicast routing function: " + mrf_name);
+    }
+    _mrf = mrf_iter->second;
+  }
+  _mc_branches.resize(_inputs*_vcs);
+  _mc_next.resize(_inputs*_vcs, 0);
+
   // Alloc VC's
   _buf.resize(_inputs);
   for ( int i = 0; i < _inputs; ++i ) {
@@ -168,6 +265,9 @@ IQRouter::IQRouter( Configuration const & config, Module *parent,
   _switch_hold_out.resize(_outputs*_output_speedup, -1);
   _switch_hold_vc.resize(_inputs*_input_speedup, -1);
 
+  _abstract_busy_in.resize(_inputs*_input_speedup, 0);
+  _abstract_busy_out.resize(_outputs, 0);
+
   _bufferMonitor = new BufferMonitor(inputs, _classes);
   _switchMonitor = new SwitchMonitor(inputs, outputs, _classes);
 
@@ -216,7 +316,7 @@ void IQRouter::AddOutputChannel(FlitChannel * channel, CreditChannel * backchann
   Router::AddOutputChannel(channel, backchannel);
 }
 
-void IQRouter::ReadInputs( )
+void IQRouter::ReadInputs( int time )
 {
   bool have_flits = _ReceiveFlits( );
   bool have_credits = _ReceiveCredits( );
@@ -224,49 +324,67 @@ void IQRouter::ReadInputs( )
 }
 
 void IQRouter::_InternalStep( )
+{
+  _Step<RuntimePipeline>( );
+}
+
+template<class P>
+inline typename P::tAllocator * IQRouter::_VCAllocator( ) const
+{
+  return static_cast<typename P::tAllocator *>(_vc_allocator);
+}
+
+template<class P>
+inline typename P::tAllocator * IQRouter::_SWAllocator( ) const
+{
+  return static_cast<typename P::tAllocator *>(_sw_allocator);
+}
+
+template<class P>
+void IQRouter::_Step( )
 {
   if(!_active) {
     return;
   }
 
-  _InputQueuing( );
+  _InputQueuing<P>( );
   bool activity = !_proc_credits.empty();
 
   if(!_route_vcs.empty())
     _RouteEvaluate( );
-  if(_vc_allocator) {
-    _vc_allocator->Clear();
+  if(P::HasVCAllocator(this)) {
+    _VCAllocator<P>()->Clear();
     if(!_vc_alloc_vcs.empty())
-      _VCAllocEvaluate( );
+      _VCAllocEvaluate<P>( );
   }
-  if(_hold_switch_for_packet) {
+  if(P::HoldSwitch(this)) {
     if(!_sw_hold_vcs.empty())
       _SWHoldEvaluate( );
   }
-  _sw_allocator->Clear();
-  if(_spec_sw_allocator)
+  _SWAllocator<P>()->Clear();
+  if(P::Speculative(this) && _spec_sw_allocator)
     _spec_sw_allocator->Clear();
   if(!_sw_alloc_vcs.empty())
-    _SWAllocEvaluate( );
+    _SWAllocEvaluate<P>( );
   if(!_crossbar_flits.empty())
     _SwitchEvaluate( );
 
   if(!_route_vcs.empty()) {
-    _RouteUpdate( );
+    _RouteUpdate<P>( );
     activity = activity || !_route_vcs.empty();
   }
   if(!_vc_alloc_vcs.empty()) {
-    _VCAllocUpdate( );
+    _VCAllocUpdate<P>( );
     activity = activity || !_vc_alloc_vcs.empty();
   }
-  if(_hold_switch_for_packet) {
+  if(P::HoldSwitch(this)) {
     if(!_sw_hold_vcs.empty()) {
-      _SWHoldUpdate( );
+      _SWHoldUpdate<P>( );
       activity = activity || !_sw_hold_vcs.empty();
     }
   }
   if(!_sw_alloc_vcs.empty()) {
-    _SWAllocUpdate( );
+    _SWAllocUpdate<P>( );
     activity = activity || !_sw_alloc_vcs.empty();
   }
   if(!_crossbar_flits.empty()) {
@@ -282,12 +400,35 @@ void IQRouter::_InternalStep( )
   _switchMonitor->cycle( );
 }
 
-void IQRouter::WriteOutputs( )
+void IQRouter::WriteOutputs( int time )
 {
   _SendFlits( );
   _SendCredits( );
 }
 
+bool IQRouter::Idle( ) const
+{
+  // with a fractional internal speedup, skipped cycles would shift the phase
+  // of the internal clock relative to the external one
+  if(_internal_speedup != floor(_internal_speedup)) {
+    return false;
+  }
+  if(_active || !_in_queue_flits.empty() || !_out_queue_credits.empty()) {
+    return false;
+  }
+  for(int output = 0; output < _outputs; ++output) {
+    if(!_output_buffer[output].empty()) {
+      return false;
+    }
+  }
+  for(int input = 0; input < _inputs; ++input) {
+    if(!_credit_buffer[input].empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 
 //------------------------------------------------------------------------------
 // read inputs
@@ -336,6 +477,7 @@ bool IQRouter::_ReceiveCredits( )
 // input queuing
 //------------------------------------------------------------------------------
 
+template<class P>
 void IQRouter::_InputQueuing( )
 {
   for(map<int, Flit *>::const_iterator iter = _in_queue_flits.begin();
@@ -381,7 +523,7 @@ void IQRouter::_InputQueuing( )
       assert(cur_buf->GetOccupancy(vc) == 1);
       assert(f->head);
       assert(_switch_hold_vc[input*_input_speedup + vc%_input_speedup] != vc);
-      if(_routing_delay) {
+      if(!P::Lookahead(this)) {
 	cur_buf->SetState(vc, VC::routing);
 	_route_vcs.push_back(make_pair(-1, make_pair(input, vc)));
       } else {
@@ -394,15 +536,15 @@ void IQRouter::_InputQueuing( )
 	}
 	cur_buf->SetRouteSet(vc, &f->la_route_set);
 	cur_buf->SetState(vc, VC::vc_alloc);
-	if(_speculative) {
+	if(P::Speculative(this)) {
 	  _sw_alloc_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc),
 							  -1)));
 	}
-	if(_vc_allocator) {
+	if(P::HasVCAllocator(this)) {
 	  _vc_alloc_vcs.push_back(make_pair(-1, make_pair(make_pair(input, vc), 
 							  -1)));
 	}
-	if(_noq) {
+	if(P::NOQ(this)) {
 	  _UpdateNOQ(input, vc, f);
 	}
       }
@@ -437,7 +579,7 @@ void IQRouter::_InputQueuing( )
     BufferState * const dest_buf = _next_buf[output];
     
 #ifdef TRACK_FLOWS
-    for(set<int>::const_iterator iter = c->vc.begin(); iter != c->vc.end(); ++iter) {
+    for(VCMask::const_iterator iter = c->vc.begin(); iter != c->vc.end(); ++iter) {
       int const vc = *iter;
       assert(!_outstanding_classes[output][vc].empty());
       int cl = _outstanding_classes[output][vc].front();
@@ -496,9 +638,10 @@ void IQRouter::_RouteEvaluate( )
   }    
 }
 
+template<class P>
 void IQRouter::_RouteUpdate( )
 {
-  assert(_routing_delay);
+  assert(!P::Lookahead(this));
 
   while(!_route_vcs.empty()) {
 
@@ -532,12 +675,16 @@ void IQRouter::_RouteUpdate( )
 		 << ")." << endl;
     }
 
-    cur_buf->Route(vc, _rf, this, f, input);
+    if(f->dests.empty()) {
+      cur_buf->Route(vc, _rf, this, f, input);
+    } else {
+      _RouteMulticast<P>(input, vc, f);
+    }
     cur_buf->SetState(vc, VC::vc_alloc);
-    if(_speculative) {
+    if(P::Speculative(this)) {
       _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second, -1)));
     }
-    if(_vc_allocator) {
+    if(P::HasVCAllocator(this)) {
       _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second, -1)));
     }
     // NOTE: No need to handle NOQ here, as it requires lookahead routing!
@@ -546,13 +693,42 @@ void IQRouter::_RouteUpdate( )
 }
 
 
+// A multicast packet forks into the branches its multicast routing function
+// splits its destinations into, and the input VC sends the whole packet down
+// one branch after the other: it allocates an output VC for the branch, sends
+// copies of the flits, and starts over with the next branch once the tail
+// has gone out. The flits stay in the buffer (and their credits are not
+// returned) until the last branch takes them. As a packet never waits for
+// one branch while holding resources of another, every copy makes progress
+// like a unicast packet would; this is only deadlock-free if the whole
+// packet fits into the VC buffer, though.
+template<class P>
+void IQRouter::_RouteMulticast(int input, int vc, Flit const * f)
+{
+  if(!_mrf) {
+    Error("Multicast packet received without a multicast routing function.");
+  }
+  if(P::Speculative(this) || P::HoldSwitch(this) || !P::HasVCAllocator(this)) {
+    Error("Multicast packets require a separate VC allocator, non-speculative switch allocation and no switch holding.");
+  }
+
+  int const input_and_vc = input*_vcs + vc;
+  vector<MulticastBranch> & branches = _mc_branches[input_and_vc];
+  _mrf(this, f, input, &branches);
+  assert(!branches.empty());
+  _mc_next[input_and_vc] = 0;
+  _buf[input]->RouteBranch(vc, branches.front());
+}
+
+
 //------------------------------------------------------------------------------
 // VC allocation
 //------------------------------------------------------------------------------
 
+template<class P>
 void IQRouter::_VCAllocEvaluate( )
 {
-  assert(_vc_allocator);
+  assert(P::HasVCAllocator(this));
 
   bool watched = false;
 
@@ -593,15 +769,15 @@ void IQRouter::_VCAllocEvaluate( )
     assert(route_set);
 
     int const out_priority = cur_buf->GetPriority(vc);
-    set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+    OutputSet const & setlist = *route_set;
 
     bool elig = false;
     bool cred = false;
     bool reserved = false;
 
-    assert(!_noq || (setlist.size() == 1));
+    assert(!P::NOQ(this) || (setlist.size() == 1));
 
-    for(set<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
+    for(OutputSet::const_iterator iset = setlist.begin();
 	iset != setlist.end();
 	++iset) {
 
@@ -613,8 +789,8 @@ void IQRouter::_VCAllocEvaluate( )
       int vc_start;
       int vc_end;
       
-      if(_noq && _noq_next_output_port[input][vc] >= 0) {
-	assert(!_routing_delay);
+      if(P::NOQ(this) && _noq_next_output_port[input][vc] >= 0) {
+	assert(P::Lookahead(this));
 	vc_start = _noq_next_vc_start[input][vc];
 	vc_end = _noq_next_vc_end[input][vc];
       } else {
@@ -680,8 +856,8 @@ void IQRouter::_VCAllocEvaluate( )
 	    }
 	    int const input_and_vc
 	      = _vc_shuffle_requests ? (vc*_inputs + input) : (input*_vcs + vc);
-	    _vc_allocator->AddRequest(input_and_vc, out_port*_vcs + out_vc, 
-				      0, in_priority, out_priority);
+	    _VCAllocator<P>()->AddRequest(input_and_vc, out_port*_vcs + out_vc, 
+					  0, in_priority, out_priority);
 	  }
 	}
       }
@@ -694,15 +870,15 @@ void IQRouter::_VCAllocEvaluate( )
   }
 
   if(watched) {
-    *gWatchOut << GetSimTime() << " | " << _vc_allocator->FullName() << " | ";
-    _vc_allocator->PrintRequests( gWatchOut );
+    *gWatchOut << GetSimTime() << " | " << _VCAllocator<P>()->FullName() << " | ";
+    _VCAllocator<P>()->PrintRequests( gWatchOut );
   }
 
-  _vc_allocator->Allocate();
+  _VCAllocator<P>()->Allocate();
 
   if(watched) {
-    *gWatchOut << GetSimTime() << " | " << _vc_allocator->FullName() << " | ";
-    _vc_allocator->PrintGrants( gWatchOut );
+    *gWatchOut << GetSimTime() << " | " << _VCAllocator<P>()->FullName() << " | ";
+    _VCAllocator<P>()->PrintGrants( gWatchOut );
   }
 
   for(deque<pair<int, pair<pair<int, int>, int> > >::iterator iter = _vc_alloc_vcs.begin();
@@ -737,7 +913,7 @@ void IQRouter::_VCAllocEvaluate( )
 
     int const input_and_vc
       = _vc_shuffle_requests ? (vc*_inputs + input) : (input*_vcs + vc);
-    int const output_and_vc = _vc_allocator->OutputAssigned(input_and_vc);
+    int const output_and_vc = _VCAllocator<P>()->OutputAssigned(input_and_vc);
 
     if(output_and_vc >= 0) {
 
@@ -837,9 +1013,10 @@ void IQRouter::_VCAllocEvaluate( )
   }
 }
 
+template<class P>
 void IQRouter::_VCAllocUpdate( )
 {
-  assert(_vc_allocator);
+  assert(P::HasVCAllocator(this));
 
   while(!_vc_alloc_vcs.empty()) {
 
@@ -898,7 +1075,7 @@ void IQRouter::_VCAllocUpdate( )
 	
       cur_buf->SetOutput(vc, match_output, match_vc);
       cur_buf->SetState(vc, VC::active);
-      if(!_speculative) {
+      if(!P::Speculative(this)) {
 	_sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first, -1)));
       }
     } else {
@@ -1002,9 +1179,10 @@ void IQRouter::_SWHoldEvaluate( )
   }
 }
 
+template<class P>
 void IQRouter::_SWHoldUpdate( )
 {
-  assert(_hold_switch_for_packet);
+  assert(P::HoldSwitch(this));
 
   while(!_sw_hold_vcs.empty()) {
     
@@ -1079,11 +1257,11 @@ void IQRouter::_SWHoldUpdate( )
       f->hops++;
       f->vc = match_vc;
       
-      if(!_routing_delay && f->head) {
+      if(P::Lookahead(this) && f->head) {
 	const FlitChannel * channel = _output_channels[output];
 	const Router * router = channel->GetSink();
 	if(router) {
-	  if(_noq) {
+	  if(P::NOQ(this)) {
 	    if(f->watch) {
 	      *gWatchOut << GetSimTime() << " | " << FullName() << " | "
 			 << "Updating lookahead routing information for flit " << f->id
@@ -1160,7 +1338,7 @@ void IQRouter::_SWHoldUpdate( )
 	  _switch_hold_vc[expanded_input] = -1;
 	  _switch_hold_in[expanded_input] = -1;
 	  _switch_hold_out[expanded_output] = -1;
-	  if(_routing_delay) {
+	  if(!P::Lookahead(this)) {
 	    cur_buf->SetState(vc, VC::routing);
 	    _route_vcs.push_back(make_pair(-1, item.second.first));
 	  } else {
@@ -1173,15 +1351,15 @@ void IQRouter::_SWHoldUpdate( )
 	    }
 	    cur_buf->SetRouteSet(vc, &nf->la_route_set);
 	    cur_buf->SetState(vc, VC::vc_alloc);
-	    if(_speculative) {
+	    if(P::Speculative(this)) {
 	      _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
 							      -1)));
 	    }
-	    if(_vc_allocator) {
+	    if(P::HasVCAllocator(this)) {
 	      _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
 							      -1)));
 	    }
-	    if(_noq) {
+	    if(P::NOQ(this)) {
 	      _UpdateNOQ(input, vc, nf);
 	    }
 	  }
@@ -1221,6 +1399,7 @@ void IQRouter::_SWHoldUpdate( )
 // switch allocation
 //------------------------------------------------------------------------------
 
+template<class P>
 bool IQRouter::_SWAllocAddReq(int input, int vc, int output)
 {
   assert(input >= 0 && input < _inputs);
@@ -1237,71 +1416,37 @@ bool IQRouter::_SWAllocAddReq(int input, int vc, int output)
   Buffer const * const cur_buf = _buf[input];
   assert(!cur_buf->Empty(vc));
   assert((cur_buf->GetState(vc) == VC::active) || 
-	 (_speculative && (cur_buf->GetState(vc) == VC::vc_alloc)));
+	 (P::Speculative(this) && (cur_buf->GetState(vc) == VC::vc_alloc)));
   
   Flit const * const f = cur_buf->FrontFlit(vc);
   assert(f);
   assert(f->vc == vc);
+
+  if((_abstract_busy_in[expanded_input] > GetSimTime()) ||
+     (_abstract_busy_out[output] > GetSimTime())) {
+    if(f->watch) {
+      *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+		 << "  Ignoring output " << output
+		 << "." << (expanded_output % _output_speedup)
+		 << " while the body flits of an abstract packet pass." << endl;
+    }
+    return false;
+  }
   
   if((_switch_hold_in[expanded_input] < 0) && 
      (_switch_hold_out[expanded_output] < 0)) {
     
-    Allocator * allocator = _sw_allocator;
     int prio = cur_buf->GetPriority(vc);
     
-    if(_speculative && (cur_buf->GetState(vc) == VC::vc_alloc)) {
+    if(P::Speculative(this) && (cur_buf->GetState(vc) == VC::vc_alloc)) {
       if(_spec_sw_allocator) {
-	allocator = _spec_sw_allocator;
-      } else {
-	assert(prio >= 0);
-	prio += numeric_limits<int>::min();
+	return _SWAllocRequest(_spec_sw_allocator, input, vc, output, prio);
       }
+      assert(prio >= 0);
+      prio += numeric_limits<int>::min();
     }
     
-    Allocator::sRequest req;
-    
-    if(allocator->ReadRequest(req, expanded_input, expanded_output)) {
-      if(RoundRobinArbiter::Supersedes(vc, prio, req.label, req.in_pri, 
-				       _sw_rr_offset[expanded_input], _vcs)) {
-	if(f->watch) {
-	  *gWatchOut << GetSimTime() << " | " << FullName() << " | "
-		     << "  Replacing earlier request from VC " << req.label
-		     << " for output " << output 
-		     << "." << (expanded_output % _output_speedup)
-		     << " with priority " << req.in_pri
-		     << " (" << ((cur_buf->GetState(vc) == VC::active) ? 
-				 "non-spec" : 
-				 "spec")
-		     << ", pri: " << prio
-		     << ")." << endl;
-	}
-	allocator->RemoveRequest(expanded_input, expanded_output, req.label);
-	allocator->AddRequest(expanded_input, expanded_output, vc, prio, prio);
-	return true;
-      }
-      if(f->watch) {
-	*gWatchOut << GetSimTime() << " | " << FullName() << " | "
-		   << "  Output " << output
-		   << "." << (expanded_output % _output_speedup)
-		   << " was already requested by VC " << req.label
-		   << " with priority " << req.in_pri
-		   << " (pri: " << prio
-		   << ")." << endl;
-      }
-      return false;
-    }
-    if(f->watch) {
-      *gWatchOut << GetSimTime() << " | " << FullName() << " | "
-		 << "  Requesting output " << output
-		 << "." << (expanded_output % _output_speedup)
-		 << " (" << ((cur_buf->GetState(vc) == VC::active) ? 
-			     "non-spec" : 
-			     "spec")
-		 << ", pri: " << prio
-		 << ")." << endl;
-    }
-    allocator->AddRequest(expanded_input, expanded_output, vc, prio, prio);
-    return true;
+    return _SWAllocRequest(_SWAllocator<P>(), input, vc, output, prio);
   }
   if(f->watch) {
     *gWatchOut << GetSimTime() << " | " << FullName() << " | "
@@ -1324,6 +1469,66 @@ bool IQRouter::_SWAllocAddReq(int input, int vc, int output)
   return false;
 }
 
+// places a switch request with the given allocator, unless an earlier 
+// request for the same input and output takes precedence
+template<class A>
+bool IQRouter::_SWAllocRequest(A * allocator, int input, int vc, int output, 
+			       int prio)
+{
+  int const expanded_input = input * _input_speedup + vc % _input_speedup;
+  int const expanded_output = output * _output_speedup + input % _output_speedup;
+  
+  Buffer const * const cur_buf = _buf[input];
+  Flit const * const f = cur_buf->FrontFlit(vc);
+  assert(f);
+  
+  Allocator::sRequest req;
+  
+  if(allocator->ReadRequest(req, expanded_input, expanded_output)) {
+    if(RoundRobinArbiter::Supersedes(vc, prio, req.label, req.in_pri, 
+				     _sw_rr_offset[expanded_input], _vcs)) {
+      if(f->watch) {
+	*gWatchOut << GetSimTime() << " | " << FullName() << " | "
+		   << "  Replacing earlier request from VC " << req.label
+		   << " for output " << output 
+		   << "." << (expanded_output % _output_speedup)
+		   << " with priority " << req.in_pri
+		   << " (" << ((cur_buf->GetState(vc) == VC::active) ? 
+			       "non-spec" : 
+			       "spec")
+		   << ", pri: " << prio
+		   << ")." << endl;
+      }
+      allocator->RemoveRequest(expanded_input, expanded_output, req.label);
+      allocator->AddRequest(expanded_input, expanded_output, vc, prio, prio);
+      return true;
+    }
+    if(f->watch) {
+      *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+		 << "  Output " << output
+		 << "." << (expanded_output % _output_speedup)
+		 << " was already requested by VC " << req.label
+		 << " with priority " << req.in_pri
+		 << " (pri: " << prio
+		 << ")." << endl;
+    }
+    return false;
+  }
+  if(f->watch) {
+    *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+	       << "  Requesting output " << output
+	       << "." << (expanded_output % _output_speedup)
+	       << " (" << ((cur_buf->GetState(vc) == VC::active) ? 
+			   "non-spec" : 
+			   "spec")
+	       << ", pri: " << prio
+	       << ")." << endl;
+  }
+  allocator->AddRequest(expanded_input, expanded_output, vc, prio, prio);
+  return true;
+}
+
+template<class P>
 void IQRouter::_SWAllocEvaluate( )
 {
   bool watched = false;
@@ -1349,7 +1554,7 @@ void IQRouter::_SWAllocEvaluate( )
     Buffer const * const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
     assert((cur_buf->GetState(vc) == VC::active) || 
-	   (_speculative && (cur_buf->GetState(vc) == VC::vc_alloc)));
+	   (P::Speculative(this) && (cur_buf->GetState(vc) == VC::vc_alloc)));
     
     Flit const * const f = cur_buf->FrontFlit(vc);
     assert(f);
@@ -1382,11 +1587,11 @@ void IQRouter::_SWAllocEvaluate( )
 	iter->second.second = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
 	continue;
       }
-      bool const requested = _SWAllocAddReq(input, vc, dest_output);
+      bool const requested = _SWAllocAddReq<P>(input, vc, dest_output);
       watched |= requested && f->watch;
       continue;
     }
-    assert(_speculative && (cur_buf->GetState(vc) == VC::vc_alloc));
+    assert(P::Speculative(this) && (cur_buf->GetState(vc) == VC::vc_alloc));
     assert(f->head);
       
     // The following models the speculative VC allocation aspects of the 
@@ -1397,11 +1602,11 @@ void IQRouter::_SWAllocEvaluate( )
     OutputSet const * const route_set = cur_buf->GetRouteSet(vc);
     assert(route_set);
     
-    set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+    OutputSet const & setlist = *route_set;
     
-    assert(!_noq || (setlist.size() == 1));
+    assert(!P::NOQ(this) || (setlist.size() == 1));
 
-    for(set<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
+    for(OutputSet::const_iterator iset = setlist.begin();
 	iset != setlist.end();
 	++iset) {
       
@@ -1424,8 +1629,8 @@ void IQRouter::_SWAllocEvaluate( )
 	int vc_start;
 	int vc_end;
 	
-	if(_noq && _noq_next_output_port[input][vc] >= 0) {
-	  assert(!_routing_delay);
+	if(P::NOQ(this) && _noq_next_output_port[input][vc] >= 0) {
+	  assert(P::Lookahead(this));
 	  vc_start = _noq_next_vc_start[input][vc];
 	  vc_end = _noq_next_vc_end[input][vc];
 	} else {
@@ -1464,29 +1669,29 @@ void IQRouter::_SWAllocEvaluate( )
 	}
 	iter->second.second = dest_buf->IsFull() ? STALL_BUFFER_FULL : STALL_BUFFER_RESERVED;
       } else {
-	bool const requested = _SWAllocAddReq(input, vc, dest_output);
+	bool const requested = _SWAllocAddReq<P>(input, vc, dest_output);
 	watched |= requested && f->watch;
       }
     }
   }
   
   if(watched) {
-    *gWatchOut << GetSimTime() << " | " << _sw_allocator->FullName() << " | ";
-    _sw_allocator->PrintRequests(gWatchOut);
-    if(_spec_sw_allocator) {
+    *gWatchOut << GetSimTime() << " | " << _SWAllocator<P>()->FullName() << " | ";
+    _SWAllocator<P>()->PrintRequests(gWatchOut);
+    if(P::Speculative(this) && _spec_sw_allocator) {
       *gWatchOut << GetSimTime() << " | " << _spec_sw_allocator->FullName() << " | ";
       _spec_sw_allocator->PrintRequests(gWatchOut);
     }
   }
   
-  _sw_allocator->Allocate();
-  if(_spec_sw_allocator)
+  _SWAllocator<P>()->Allocate();
+  if(P::Speculative(this) && _spec_sw_allocator)
     _spec_sw_allocator->Allocate();
   
   if(watched) {
-    *gWatchOut << GetSimTime() << " | " << _sw_allocator->FullName() << " | ";
-    _sw_allocator->PrintGrants(gWatchOut);
-    if(_spec_sw_allocator) {
+    *gWatchOut << GetSimTime() << " | " << _SWAllocator<P>()->FullName() << " | ";
+    _SWAllocator<P>()->PrintGrants(gWatchOut);
+    if(P::Speculative(this) && _spec_sw_allocator) {
       *gWatchOut << GetSimTime() << " | " << _spec_sw_allocator->FullName() << " | ";
       _spec_sw_allocator->PrintGrants(gWatchOut);
     }
@@ -1516,7 +1721,7 @@ void IQRouter::_SWAllocEvaluate( )
     Buffer const * const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
     assert((cur_buf->GetState(vc) == VC::active) || 
-	   (_speculative && (cur_buf->GetState(vc) == VC::vc_alloc)));
+	   (P::Speculative(this) && (cur_buf->GetState(vc) == VC::vc_alloc)));
     
     Flit const * const f = cur_buf->FrontFlit(vc);
     assert(f);
@@ -1524,11 +1729,11 @@ void IQRouter::_SWAllocEvaluate( )
 
     int const expanded_input = input * _input_speedup + vc % _input_speedup;
 
-    int expanded_output = _sw_allocator->OutputAssigned(expanded_input);
+    int expanded_output = _SWAllocator<P>()->OutputAssigned(expanded_input);
 
     if(expanded_output >= 0) {
       assert((expanded_output % _output_speedup) == (input % _output_speedup));
-      int const granted_vc = _sw_allocator->ReadRequest(expanded_input, expanded_output);
+      int const granted_vc = _SWAllocator<P>()->ReadRequest(expanded_input, expanded_output);
       if(granted_vc == vc) {
 	if(f->watch) {
 	  *gWatchOut << GetSimTime() << " | " << FullName() << " | "
@@ -1550,12 +1755,12 @@ void IQRouter::_SWAllocEvaluate( )
 	}
 	iter->second.second = STALL_CROSSBAR_CONFLICT;
       }
-    } else if(_spec_sw_allocator) {
+    } else if(P::Speculative(this) && _spec_sw_allocator) {
       expanded_output = _spec_sw_allocator->OutputAssigned(expanded_input);
       if(expanded_output >= 0) {
 	assert((expanded_output % _output_speedup) == (input % _output_speedup));
 	if(_spec_mask_by_reqs && 
-	   _sw_allocator->OutputHasRequests(expanded_output)) {
+	   _SWAllocator<P>()->OutputHasRequests(expanded_output)) {
 	  if(f->watch) {
 	    *gWatchOut << GetSimTime() << " | " << FullName() << " | "
 		       << "Discarding speculative grant for VC " << vc
@@ -1567,7 +1772,7 @@ void IQRouter::_SWAllocEvaluate( )
 	  }
 	  iter->second.second = STALL_CROSSBAR_CONFLICT;
 	} else if(!_spec_mask_by_reqs &&
-		  (_sw_allocator->InputAssigned(expanded_output) >= 0)) {
+		  (_SWAllocator<P>()->InputAssigned(expanded_output) >= 0)) {
 	  if(f->watch) {
 	    *gWatchOut << GetSimTime() << " | " << FullName() << " | "
 		       << "Discarding speculative grant for VC " << vc
@@ -1629,7 +1834,7 @@ void IQRouter::_SWAllocEvaluate( )
     }
   }
   
-  if(!_speculative && (_sw_alloc_delay <= 1)) {
+  if(!P::Speculative(this) && (_sw_alloc_delay <= 1)) {
     return;
   }
 
@@ -1666,7 +1871,7 @@ void IQRouter::_SWAllocEvaluate( )
       Buffer const * const cur_buf = _buf[input];
       assert(!cur_buf->Empty(vc));
       assert((cur_buf->GetState(vc) == VC::active) ||
-	     (_speculative && (cur_buf->GetState(vc) == VC::vc_alloc)));
+	     (P::Speculative(this) && (cur_buf->GetState(vc) == VC::vc_alloc)));
       
       Flit const * const f = cur_buf->FrontFlit(vc);
       assert(f);
@@ -1694,15 +1899,26 @@ void IQRouter::_SWAllocEvaluate( )
 	  *gWatchOut << "." << endl;
 	}
 	iter->second.second = STALL_CROSSBAR_CONFLICT;
-      } else if(_speculative && (cur_buf->GetState(vc) == VC::vc_alloc)) {
+      } else if((_abstract_busy_in[expanded_input] > GetSimTime()) ||
+		(_abstract_busy_out[output] > GetSimTime())) {
+	if(f->watch) {
+	  *gWatchOut << GetSimTime() << " | " << FullName() << " | "
+		     << "Discarding grant from input " << input
+		     << "." << (vc % _input_speedup)
+		     << " to output " << output
+		     << "." << (expanded_output % _output_speedup)
+		     << " due to an abstract packet granted earlier." << endl;
+	}
+	iter->second.second = STALL_CROSSBAR_CONFLICT;
+      } else if(P::Speculative(this) && (cur_buf->GetState(vc) == VC::vc_alloc)) {
 
 	assert(f->head);
 
-	if(_vc_allocator) { // separate VC and switch allocators
+	if(P::HasVCAllocator(this)) { // separate VC and switch allocators
 
 	  int const input_and_vc = 
 	    _vc_shuffle_requests ? (vc*_inputs + input) : (input*_vcs + vc);
-	  int const output_and_vc = _vc_allocator->OutputAssigned(input_and_vc);
+	  int const output_and_vc = _VCAllocator<P>()->OutputAssigned(input_and_vc);
 
 	  if(output_and_vc < 0) {
 	    if(f->watch) {
@@ -1741,15 +1957,15 @@ void IQRouter::_SWAllocEvaluate( )
 	  OutputSet const * const route_set = cur_buf->GetRouteSet(vc);
 	  assert(route_set);
 
-	  set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+	  OutputSet const & setlist = *route_set;
 
 	  bool busy = true;
 	  bool full = true;
 	  bool reserved = false;
 
-	  assert(!_noq || (setlist.size() == 1));
+	  assert(!P::NOQ(this) || (setlist.size() == 1));
 
-	  for(set<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
+	  for(OutputSet::const_iterator iset = setlist.begin();
 	      iset != setlist.end();
 	      ++iset) {
 	    if(iset->output_port == output) {
@@ -1757,8 +1973,8 @@ void IQRouter::_SWAllocEvaluate( )
 	      int vc_start;
 	      int vc_end;
 	      
-	      if(_noq && _noq_next_output_port[input][vc] >= 0) {
-		assert(!_routing_delay);
+	      if(P::NOQ(this) && _noq_next_output_port[input][vc] >= 0) {
+		assert(P::Lookahead(this));
 		vc_start = _noq_next_vc_start[input][vc];
 		vc_end = _noq_next_vc_end[input][vc];
 	      } else {
@@ -1833,6 +2049,7 @@ void IQRouter::_SWAllocEvaluate( )
   }
 }
 
+template<class P>
 void IQRouter::_SWAllocUpdate( )
 {
   while(!_sw_alloc_vcs.empty()) {
@@ -1853,7 +2070,7 @@ void IQRouter::_SWAllocUpdate( )
     Buffer * const cur_buf = _buf[input];
     assert(!cur_buf->Empty(vc));
     assert((cur_buf->GetState(vc) == VC::active) ||
-	   (_speculative && (cur_buf->GetState(vc) == VC::vc_alloc)));
+	   (P::Speculative(this) && (cur_buf->GetState(vc) == VC::vc_alloc)));
     
     Flit * const f = cur_buf->FrontFlit(vc);
     assert(f);
@@ -1883,7 +2100,7 @@ void IQRouter::_SWAllocUpdate( )
 
       int match_vc;
 
-      if(!_vc_allocator && (cur_buf->GetState(vc) == VC::vc_alloc)) {
+      if(!P::HasVCAllocator(this) && (cur_buf->GetState(vc) == VC::vc_alloc)) {
 
 	assert(f->head);
 
@@ -1896,11 +2113,11 @@ void IQRouter::_SWAllocUpdate( )
 	int match_prio = numeric_limits<int>::min();
 
 	const OutputSet * route_set = cur_buf->GetRouteSet(vc);
-	set<OutputSet::sSetElement> const setlist = route_set->GetSet();
+	OutputSet const & setlist = *route_set;
 	
-	assert(!_noq || (setlist.size() == 1));
+	assert(!P::NOQ(this) || (setlist.size() == 1));
 	
-	for(set<OutputSet::sSetElement>::const_iterator iset = setlist.begin();
+	for(OutputSet::const_iterator iset = setlist.begin();
 	    iset != setlist.end();
 	    ++iset) {
 	  if(iset->output_port == output) {
@@ -1908,8 +2125,8 @@ void IQRouter::_SWAllocUpdate( )
 	    int vc_start;
 	    int vc_end;
 	    
-	    if(_noq && _noq_next_output_port[input][vc] >= 0) {
-	      assert(!_routing_delay);
+	    if(P::NOQ(this) && _noq_next_output_port[input][vc] >= 0) {
+	      assert(P::Lookahead(this));
 	      vc_start = _noq_next_vc_start[input][vc];
 	      vc_end = _noq_next_vc_end[input][vc];
 	    } else {
@@ -1977,6 +2194,44 @@ void IQRouter::_SWAllocUpdate( )
 		   << "." << endl;
       }
 
+      if(f->size > 1) {
+	// the body flits follow the head through the switch and the channel
+	_abstract_busy_in[expanded_input] = GetSimTime() + f->size;
+	_abstract_busy_out[output] = GetSimTime() + f->size;
+      }
+
+      int const input_and_vc = input*_vcs + vc;
+      vector<MulticastBranch> & branches = _mc_branches[input_and_vc];
+      if(!branches.empty()) {
+	int & next = _mc_next[input_and_vc];
+	if(next < (int)branches.size() - 1) {
+	  _SendBranchCopy(input, vc, f, expanded_input, expanded_output);
+	  cur_buf->KeepFlit(vc);
+	  if(f->tail) {
+	    // on to the next branch, starting over with the head
+	    ++next;
+	    cur_buf->RestoreKeptFlits(vc);
+	    cur_buf->RouteBranch(vc, branches[next]);
+	    cur_buf->SetState(vc, VC::vc_alloc);
+	    _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
+							    -1)));
+	  } else if(!cur_buf->Empty(vc)) {
+	    _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
+							    -1)));
+	  }
+	  _sw_alloc_vcs.pop_front();
+	  continue;
+	}
+	// the last branch gets the flits themselves
+	if(f->head) {
+	  RestrictToBranch(f, branches.back());
+	}
+	if(f->tail) {
+	  branches.clear();
+	  next = 0;
+	}
+      }
+
       cur_buf->RemoveFlit(vc);
 
 #ifdef TRACK_FLOWS
@@ -1989,11 +2244,11 @@ void IQRouter::_SWAllocUpdate( )
       f->hops++;
       f->vc = match_vc;
 
-      if(!_routing_delay && f->head) {
+      if(P::Lookahead(this) && f->head) {
 	const FlitChannel * channel = _output_channels[output];
 	const Router * router = channel->GetSink();
 	if(router) {
-	  if(_noq) {
+	  if(P::NOQ(this)) {
 	    if(f->watch) {
 	      *gWatchOut << GetSimTime() << " | " << FullName() << " | "
 			 << "Updating lookahead routing information for flit " << f->id
@@ -2048,7 +2303,7 @@ void IQRouter::_SWAllocUpdate( )
 	assert(nf->vc == vc);
 	if(f->tail) {
 	  assert(nf->head);
-	  if(_routing_delay) {
+	  if(!P::Lookahead(this)) {
 	    cur_buf->SetState(vc, VC::routing);
 	    _route_vcs.push_back(make_pair(-1, item.second.first));
 	  } else {
@@ -2061,20 +2316,20 @@ void IQRouter::_SWAllocUpdate( )
 	    }
 	    cur_buf->SetRouteSet(vc, &nf->la_route_set);
 	    cur_buf->SetState(vc, VC::vc_alloc);
-	    if(_speculative) {
+	    if(P::Speculative(this)) {
 	      _sw_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
 							      -1)));
 	    }
-	    if(_vc_allocator) {
+	    if(P::HasVCAllocator(this)) {
 	      _vc_alloc_vcs.push_back(make_pair(-1, make_pair(item.second.first,
 							      -1)));
 	    }
-	    if(_noq) {
+	    if(P::NOQ(this)) {
 	      _UpdateNOQ(input, vc, nf);
 	    }
 	  }
 	} else {
-	  if(_hold_switch_for_packet) {
+	  if(P::HoldSwitch(this)) {
 	    if(f->watch) {
 	      *gWatchOut << GetSimTime() << " | " << FullName() << " | "
 			 << "Setting up switch hold for VC " << vc
@@ -2128,6 +2383,37 @@ void IQRouter::_SWAllocUpdate( )
 }
 
 
+// sends a copy of the front flit of a multicast VC down the current branch
+void IQRouter::_SendBranchCopy(int input, int vc, Flit const * f, 
+			       int expanded_input, int expanded_output)
+{
+  int const input_and_vc = input*_vcs + vc;
+  int const next = _mc_next[input_and_vc];
+  int const output = expanded_output / _output_speedup;
+  assert(_buf[input]->GetOutputPort(vc) == output);
+  assert(_mc_branches[input_and_vc][next].output_port == output);
+
+  Flit * const c = f->Clone();
+  if(c->head) {
+    RestrictToBranch(c, _mc_branches[input_and_vc][next]);
+  }
+
+  _bufferMonitor->read(input, c) ;
+
+  c->hops++;
+  c->vc = _buf[input]->GetOutputVC(vc);
+
+#ifdef TRACK_FLOWS
+  ++_outstanding_credits[c->cl][output];
+  _outstanding_classes[output][c->vc].push(c->cl);
+#endif
+
+  _next_buf[output]->SendingFlit(c);
+
+  _crossbar_flits.push_back(make_pair(-1, make_pair(c, make_pair(expanded_input, expanded_output))));
+}
+
+
 //------------------------------------------------------------------------------
 // switch traversal
 //------------------------------------------------------------------------------
@@ -2285,6 +2571,75 @@ void IQRouter::Display( ostream & os ) const
   }
 }
 
+void IQRouter::Serialize( Checkpoint & cp )
+{
+  _SerializeRouter(cp);
+
+  cp.Item(_active);
+
+  cp.Item(_in_queue_flits);
+  cp.Item(_proc_credits);
+
+  cp.Item(_route_vcs);
+  cp.Item(_vc_alloc_vcs);
+  cp.Item(_sw_hold_vcs);
+  cp.Item(_sw_alloc_vcs);
+  cp.Item(_crossbar_flits);
+
+  cp.Item(_out_queue_credits);
+
+  for(int i = 0; i < _inputs; ++i) {
+    _buf[i]->Serialize(cp);
+  }
+  for(int j = 0; j < _outputs; ++j) {
+    _next_buf[j]->Serialize(cp);
+  }
+
+  if(_vc_allocator) {
+    _vc_allocator->Serialize(cp);
+  }
+  _sw_allocator->Serialize(cp);
+  if(_spec_sw_allocator) {
+    _spec_sw_allocator->Serialize(cp);
+  }
+  cp.Item(_vc_rr_offset);
+  cp.Item(_sw_rr_offset);
+
+  cp.Item(_output_buffer);
+  cp.Item(_credit_buffer);
+
+  cp.Item(_switch_hold_in);
+  cp.Item(_switch_hold_out);
+  cp.Item(_switch_hold_vc);
+  cp.Item(_abstract_busy_in);
+  cp.Item(_abstract_busy_out);
+
+  for(size_t i = 0; i < _mc_branches.size(); ++i) {
+    vector<MulticastBranch> & branches = _mc_branches[i];
+    size_t size = branches.size();
+    cp.Item(size);
+    branches.resize(size);
+    for(size_t b = 0; b < size; ++b) {
+      cp.Item(branches[b].output_port);
+      cp.Item(branches[b].vc_start);
+      cp.Item(branches[b].vc_end);
+      cp.Item(branches[b].dests);
+    }
+  }
+  cp.Item(_mc_next);
+
+  cp.Item(_noq_next_output_port);
+  cp.Item(_noq_next_vc_start);
+  cp.Item(_noq_next_vc_end);
+
+#ifdef TRACK_FLOWS
+  cp.Item(_outstanding_classes);
+#endif
+
+  _switchMonitor->serialize(cp);
+  _bufferMonitor->serialize(cp);
+}
+
 int IQRouter::GetUsedCredit(int o) const
 {
   assert((o >= 0) && (o < _outputs));
@@ -2350,18 +2705,16 @@ void IQRouter::_UpdateNOQ(int input, int vc, Flit const * f) {
   assert(f);
   assert(f->vc == vc);
   assert(f->head);
-  set<OutputSet::sSetElement> sl = f->la_route_set.GetSet();
-  assert(sl.size() == 1);
-  int out_port = sl.begin()->output_port;
+  assert(f->la_route_set.size() == 1);
+  int out_port = f->la_route_set.begin()->output_port;
   const FlitChannel * channel = _output_channels[out_port];
   const Router * router = channel->GetSink();
   if(router) {
     int in_channel = channel->GetSinkPort();
     OutputSet nos;
     _rf(router, f, in_channel, &nos, false);
-    sl = nos.GetSet();
-    assert(sl.size() == 1);
-    OutputSet::sSetElement const & se = *sl.begin();
+    assert(nos.size() == 1);
+    OutputSet::sSetElement const & se = *nos.begin();
     int next_output_port = se.output_port;
     assert(next_output_port >= 0);
     assert(_noq_next_output_port[input][vc] < 0);
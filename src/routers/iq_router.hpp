@@ -91,6 +91,13 @@ class IQRouter : public Router {
   vector<int> _sw_rr_offset;
 
   tRoutingFunction   _rf;
+  tMulticastRoutingFunction _mrf;
+
+  // Multicast packets at the input VCs (indexed by input*_vcs+vc): the 
+  // branches they fork into here (none for unicast packets) and the branch
+  // currently being served
+  vector<vector<MulticastBranch> > _mc_branches;
+  vector<int> _mc_next;
 
   int _output_buffer_size;
   vector<queue<Flit *> > _output_buffer;
@@ -102,6 +109,11 @@ class IQRouter : public Router {
   vector<int> _switch_hold_out;
   vector<int> _switch_hold_vc;
 
+  // cycles until which the body flits of an abstract packet occupy each
+  // (expanded) switch input and each output channel
+  vector<int> _abstract_busy_in;
+  vector<int> _abstract_busy_out;
+
   bool _noq;
   vector<vector<int> > _noq_next_output_port;
   vector<vector<int> > _noq_next_vc_start;
@@ -111,25 +123,44 @@ class IQRouter : public Router {
   vector<vector<queue<int> > > _outstanding_classes;
 #endif
 
+  // Pipeline settings that are fixed once the router has been built. The
+  // pipeline stages are templates over a policy P that provides them: 
+  // RuntimePipeline reads them from the router, while StaticPipeline has 
+  // them (and the allocator class) compiled in, so that unused stages drop 
+  // out and allocator calls are resolved statically (see IQRouterT).
+  struct RuntimePipeline;
+  template<bool speculative, bool lookahead, bool noq, bool hold_switch,
+	   class tAllocator>
+  struct StaticPipeline;
+
   bool _ReceiveFlits( );
   bool _ReceiveCredits( );
 
   virtual void _InternalStep( );
 
-  bool _SWAllocAddReq(int input, int vc, int output);
+  template<class P> typename P::tAllocator * _VCAllocator( ) const;
+  template<class P> typename P::tAllocator * _SWAllocator( ) const;
+
+  template<class P> bool _SWAllocAddReq(int input, int vc, int output);
+  template<class A> bool _SWAllocRequest(A * allocator, int input, int vc, 
+					 int output, int prio);
+
+  template<class P> void _InputQueuing( );
 
-  void _InputQueuing( );
+  template<class P> void _RouteMulticast(int input, int vc, Flit const * f);
+  void _SendBranchCopy(int input, int vc, Flit const * f, int expanded_input,
+		       int expanded_output);
 
   void _RouteEvaluate( );
-  void _VCAllocEvaluate( );
+  template<class P> void _VCAllocEvaluate( );
   void _SWHoldEvaluate( );
-  void _SWAllocEvaluate( );
+  template<class P> void _SWAllocEvaluate( );
   void _SwitchEvaluate( );
 
-  void _RouteUpdate( );
-  void _VCAllocUpdate( );
-  void _SWHoldUpdate( );
-  void _SWAllocUpdate( );
+  template<class P> void _RouteUpdate( );
+  template<class P> void _VCAllocUpdate( );
+  template<class P> void _SWHoldUpdate( );
+  template<class P> void _SWAllocUpdate( );
   void _SwitchUpdate( );
 
   void _OutputQueuing( );
@@ -148,6 +179,10 @@ class IQRouter : public Router {
   SwitchMonitor * _switchMonitor ;
   BufferMonitor * _bufferMonitor ;
   
+protected:
+
+  template<class P> void _Step( );
+
 public:
 
   IQRouter( Configuration const & config,
@@ -155,14 +190,24 @@ public:
 	    int inputs, int outputs );
   
   virtual ~IQRouter( );
+
+  // Builds an IQRouter, using a pipeline specialized for the configuration
+  // if there is one (and specialized_pipeline is set).
+  static IQRouter * New( Configuration const & config,
+			 Module *parent, string const & name, int id,
+			 int inputs, int outputs );
   
   virtual void AddOutputChannel(FlitChannel * channel, CreditChannel * backchannel);
 
-  virtual void ReadInputs( );
-  virtual void WriteOutputs( );
+  virtual void ReadInputs( int time );
+  virtual void WriteOutputs( int time );
+
+  virtual bool Idle( ) const;
   
   void Display( ostream & os = cout ) const;
 
+  virtual void Serialize( Checkpoint & cp );
+
   virtual int GetUsedCredit(int o) const;
   virtual int GetBufferOccupancy(int i) const;
 
@@ -59,7 +59,7 @@ Router::Router( const Configuration& config,
 		Module *parent, const string & name, int id,
 		int inputs, int outputs ) :
 TimedModule( parent, name ), _id( id ), _inputs( inputs ), _outputs( outputs ),
-   _partial_internal_cycles(0.0)
+   _partial_internal_cycles(0.0), _random_stream( FullName( ) )
 {
   _crossbar_delay   = ( config.GetInt( "st_prepare_delay" ) + 
 			config.GetInt( "st_final_delay" ) );
@@ -69,6 +69,8 @@ TimedModule( parent, name ), _id( id ), _inputs( inputs ), _outputs( outputs ),
   _internal_speedup = config.GetFloat( "internal_speedup" );
   _classes          = config.GetInt( "classes" );
 
+  _use_random_stream = ( config.GetInt( "random_streams" ) != 0 );
+
 #ifdef TRACK_FLOWS
   _received_flits.resize(_classes, vector<int>(_inputs, 0));
   _stored_flits.resize(_classes);
@@ -92,6 +94,7 @@ void Router::AddInputChannel( FlitChannel *channel, CreditChannel *backchannel )
   _input_channels.push_back( channel );
   _input_credits.push_back( backchannel );
   channel->SetSink( this, _input_channels.size() - 1 ) ;
+  channel->SetReceiver( this );
 }
 
 void Router::AddOutputChannel( FlitChannel *channel, CreditChannel *backchannel )
@@ -100,10 +103,13 @@ void Router::AddOutputChannel( FlitChannel *channel, CreditChannel *backchannel
   _output_credits.push_back( backchannel );
   _channel_faults.push_back( false );
   channel->SetSource( this, _output_channels.size() - 1 ) ;
+  backchannel->SetReceiver( this );
 }
 
-void Router::Evaluate( )
+void Router::Evaluate( int time )
 {
+  RandomStreamScope random_scope( _use_random_stream ? &_random_stream : NULL,
+				  time );
   _partial_internal_cycles += _internal_speedup;
   while( _partial_internal_cycles >= 1.0 ) {
     _InternalStep( );
@@ -125,6 +131,34 @@ bool Router::IsFaultyOutput( int c ) const
   return _channel_faults[c];
 }
 
+void Router::_SerializeRouter( Checkpoint & cp )
+{
+  cp.Section( FullName() );
+  cp.Check( _inputs, FullName() + " inputs" );
+  cp.Check( _outputs, FullName() + " outputs" );
+  cp.Item( _partial_internal_cycles );
+  cp.Item( _channel_faults );
+#ifdef TRACK_FLOWS
+  cp.Item( _received_flits );
+  cp.Item( _stored_flits );
+  cp.Item( _sent_flits );
+  cp.Item( _outstanding_credits );
+  cp.Item( _active_packets );
+#endif
+#ifdef TRACK_STALLS
+  cp.Item( _buffer_busy_stalls );
+  cp.Item( _buffer_conflict_stalls );
+  cp.Item( _buffer_full_stalls );
+  cp.Item( _buffer_reserved_stalls );
+  cp.Item( _crossbar_conflict_stalls );
+#endif
+}
+
+void Router::Serialize( Checkpoint & cp )
+{
+  Error( "Checkpoints are not supported by this router type." );
+}
+
 /*Router constructor*/
 Router *Router::NewRouter( const Configuration& config,
 			   Module *parent, const string & name, int id,
@@ -133,7 +167,7 @@ Router *Router::NewRouter( const Configuration& config,
   const string type = config.GetStr( "router" );
   Router *r = NULL;
   if ( type == "iq" ) {
-    r = new IQRouter( config, parent, name, id, inputs, outputs );
+    r = IQRouter::New( config, parent, name, id, inputs, outputs );
   } else if ( type == "event" ) {
     r = new EventRouter( config, parent, name, id, inputs, outputs );
   } else if ( type == "chaos" ) {
@@ -37,6 +37,7 @@
 #include "flitchannel.hpp"
 #include "channel.hpp"
 #include "config_utils.hpp"
+#include "random_utils.hpp"
 
 typedef Channel<Credit> CreditChannel;
 
@@ -63,6 +64,10 @@ protected:
   double _internal_speedup;
   double _partial_internal_cycles;
 
+  // random numbers drawn while evaluating come from a stream of our own
+  bool _use_random_stream;
+  RandomStream _random_stream;
+
   int _crossbar_delay;
   int _credit_delay;
   
@@ -90,6 +95,9 @@ protected:
 
   virtual void _InternalStep() = 0;
 
+  // state common to all routers
+  void _SerializeRouter( Checkpoint & cp );
+
 public:
   Router( const Configuration& config,
 	  Module *parent, const string & name, int id,
@@ -111,13 +119,16 @@ public:
     return _output_channels[output];
   }
 
-  virtual void ReadInputs( ) = 0;
-  virtual void Evaluate( );
-  virtual void WriteOutputs( ) = 0;
+  virtual void ReadInputs( int time ) = 0;
+  virtual void Evaluate( int time );
+  virtual void WriteOutputs( int time ) = 0;
 
   void OutChannelFault( int c, bool fault = true );
   bool IsFaultyOutput( int c ) const;
 
+  // Save or restore the state of the router; not supported by all routers
+  virtual void Serialize( Checkpoint & cp );
+
   inline int GetID( ) const {return _id;}
 
 
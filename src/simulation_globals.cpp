@@ -0,0 +1,53 @@
+/*****************************************************
+ * Per-Simulation Global Variables
+ *****************************************************
+ * Overview
+ *   - Registration happens during static initialization, before any
+ *     simulation (and thus any worker thread) exists, so the list of
+ *     variables needs no locking.
+ */
+
+#include <cstring>
+#include <cassert>
+
+#include "simulation_globals.hpp"
+
+vector<SimulationGlobals::Entry> & SimulationGlobals::_Entries( )
+{
+  // constructed on first use, as registrars in other translation units may
+  // run before this one is initialized
+  static vector<Entry> entries;
+  return entries;
+}
+
+SimulationGlobals::Registrar::Registrar( tAddress address, size_t size )
+{
+  Entry const entry = { address, size };
+  _Entries( ).push_back( entry );
+}
+
+void SimulationGlobals::Capture( vector<char> & snapshot )
+{
+  vector<Entry> const & entries = _Entries( );
+  size_t total = 0;
+  for ( size_t i = 0; i < entries.size( ); ++i ) {
+    total += entries[i].size;
+  }
+  snapshot.resize( total );
+  char * pos = snapshot.data( );
+  for ( size_t i = 0; i < entries.size( ); ++i ) {
+    memcpy( pos, entries[i].address( ), entries[i].size );
+    pos += entries[i].size;
+  }
+}
+
+void SimulationGlobals::Install( vector<char> const & snapshot )
+{
+  vector<Entry> const & entries = _Entries( );
+  char const * pos = snapshot.data( );
+  for ( size_t i = 0; i < entries.size( ); ++i ) {
+    memcpy( entries[i].address( ), pos, entries[i].size );
+    pos += entries[i].size;
+  }
+  assert( pos == snapshot.data( ) + snapshot.size( ) );
+}
@@ -0,0 +1,64 @@
+/*****************************************************
+ * Per-Simulation Global Variables
+ *****************************************************
+ * Overview
+ *   - The simulator-wide variables (network geometry, VC ranges, routing
+ *     tables, the traffic manager, the random number generator, ...) are
+ *     thread_local, so independent simulations can run on different
+ *     threads of the same process.
+ *   - A thread that steps part of another thread's simulation (see
+ *     WorkerPool) has to see that thread's values: each such variable is
+ *     registered once with REGISTER_SIMULATION_GLOBAL, and a snapshot of
+ *     all of them taken on the owning thread can be installed on others.
+ *     A host has to build and step a simulation on the same thread.
+ *   - Registered variables must be trivially copyable; anything larger
+ *     is kept behind a registered pointer.
+ *
+ * API Description
+ *   - Capture:             copy the calling thread's registered variables
+ *   - Install:             overwrite them with a captured snapshot
+ */
+
+#ifndef _SIMULATION_GLOBALS_HPP_
+#define _SIMULATION_GLOBALS_HPP_
+
+#include <vector>
+#include <cstddef>
+
+#include "booksim.hpp"
+
+class SimulationGlobals {
+
+public:
+
+  typedef void * (*tAddress)( );
+
+  class Registrar {
+  public:
+    Registrar( tAddress address, size_t size );
+  };
+
+  static void Capture( vector<char> & snapshot );
+  static void Install( vector<char> const & snapshot );
+
+private:
+
+  struct Entry {
+    tAddress address;
+    size_t   size;
+  };
+
+  static vector<Entry> & _Entries( );
+
+};
+
+#define _SIMULATION_GLOBAL_NAME2( line ) _simulation_global_##line
+#define _SIMULATION_GLOBAL_NAME( line ) _SIMULATION_GLOBAL_NAME2( line )
+
+// the address is looked up each time, as it differs between threads
+#define REGISTER_SIMULATION_GLOBAL( var )				\
+  static SimulationGlobals::Registrar const				\
+  _SIMULATION_GLOBAL_NAME( __LINE__ )( []( ) -> void * { return &( var ); }, \
+				       sizeof( var ) )
+
+#endif
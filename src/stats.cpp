@@ -39,13 +39,19 @@
 #include <limits>
 #include <cmath>
 #include <cstdio>
+#include <cassert>
 
 #include "stats.hpp"
 
 Stats::Stats( Module *parent, const string &name,
-	      double bin_size, int num_bins ) :
-  Module( parent, name ), _num_bins( num_bins ), _bin_size( bin_size )
+	      double bin_size, int num_bins, HistMode mode ) :
+  Module( parent, name ), _mode( mode ), _num_bins( num_bins ),
+  _bin_size( bin_size )
 {
+  if ( _mode == LOG_LINEAR ) {
+    // one exact range plus one half-size range per remaining exponent
+    _num_bins = ( 32 - LOG_SUB_BITS + 2 ) << ( LOG_SUB_BITS - 1 );
+  }
   Clear();
 }
 
@@ -98,6 +104,76 @@ int Stats::NumSamples( ) const
   return _num_samples;
 }
 
+double Stats::Percentile( double p ) const
+{
+  if ( _num_samples == 0 ) {
+    return numeric_limits<double>::quiet_NaN();
+  }
+  long long rank = (long long)ceil( p * (double)_num_samples );
+  rank = ( rank < 1 ) ? 1 : ( ( rank > _num_samples ) ? _num_samples : rank );
+
+  int b = 0;
+  for ( long long seen = _hist[0]; seen < rank; seen += _hist[b] ) {
+    ++b;
+  }
+  double const val = _BinValue( b );
+  return ( val > _max ) ? _max : ( ( val < _min ) ? _min : val );
+}
+
+void Stats::Merge( const Stats & other )
+{
+  assert( ( _mode == other._mode ) && ( _num_bins == other._num_bins ) &&
+	  ( _bin_size == other._bin_size ) );
+  if ( other._num_samples == 0 ) {
+    return;
+  }
+  _num_samples += other._num_samples;
+  _sample_sum += other._sample_sum;
+  _sample_squared_sum += other._sample_squared_sum;
+
+  _max = !(other._max <= _max) ? other._max : _max;
+  _min = !(other._min >= _min) ? other._min : _min;
+
+  for ( int b = 0; b < _num_bins; ++b ) {
+    _hist[b] += other._hist[b];
+  }
+}
+
+void Stats::Serialize( Checkpoint & cp )
+{
+  cp.Check( _num_bins, FullName( ) + " bins" );
+  cp.Item( _num_samples );
+  cp.Item( _sample_sum );
+  cp.Item( _sample_squared_sum );
+  cp.Item( _min );
+  cp.Item( _max );
+  cp.Item( _hist );
+}
+
+int Stats::_LogLinearBin( double val ) const
+{
+  double const scaled = fmax( floor( val / _bin_size ), 0.0 );
+  unsigned const v = ( scaled >= 4294967295.0 ) ? 0xffffffffu : (unsigned)scaled;
+  if ( v < ( 1u << LOG_SUB_BITS ) ) {
+    return v;
+  }
+  // keep the top LOG_SUB_BITS bits of the value; its exponent selects the
+  // range and the bits below the leading one the bucket within it
+  int const shift = 32 - __builtin_clz( v ) - LOG_SUB_BITS;
+  return ( shift << ( LOG_SUB_BITS - 1 ) ) + (int)( v >> shift );
+}
+
+double Stats::_BinValue( int b ) const
+{
+  if ( ( _mode == LINEAR ) || ( b < ( 1 << LOG_SUB_BITS ) ) ) {
+    return b * _bin_size;
+  }
+  // report the largest value the bucket holds
+  int const shift = ( b >> ( LOG_SUB_BITS - 1 ) ) - 1;
+  long long const mantissa = b - ( shift << ( LOG_SUB_BITS - 1 ) );
+  return (double)( ( ( mantissa + 1 ) << shift ) - 1 ) * _bin_size;
+}
+
 void Stats::AddSample( double val )
 {
   ++_num_samples;
@@ -107,9 +183,14 @@ void Stats::AddSample( double val )
   _max = !(val <= _max) ? val : _max;
   _min = !(val >= _min) ? val : _min;
 
-  //double clamp between 0 and num_bins-1
-  int b = (int)fmax(floor( val / _bin_size ), 0.0);
-  b = (b >= _num_bins) ? (_num_bins - 1) : b;
+  int b;
+  if ( _mode == LOG_LINEAR ) {
+    b = _LogLinearBin( val );
+  } else {
+    //double clamp between 0 and num_bins-1
+    b = (int)fmax(floor( val / _bin_size ), 0.0);
+    b = (b >= _num_bins) ? (_num_bins - 1) : b;
+  }
 
   _hist[b]++;
 }
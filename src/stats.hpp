@@ -29,8 +29,20 @@
 #define _STATS_HPP_
 
 #include "module.hpp"
+#include "checkpoint.hpp"
 
 class Stats : public Module {
+public:
+  // LINEAR:     num_bins bins of bin_size each, the last one catching
+  //             everything beyond
+  // LOG_LINEAR: HDR-style buckets over the value in units of bin_size:
+  //             exact up to 2^LOG_SUB_BITS, then 2^(LOG_SUB_BITS-1) linear
+  //             buckets per power of two up to 2^32 (num_bins is ignored)
+  enum HistMode { LINEAR, LOG_LINEAR };
+
+  static int const LOG_SUB_BITS = 8;
+
+private:
   int    _num_samples;
   double _sample_sum;
   double _sample_squared_sum;
@@ -39,14 +51,18 @@ class Stats : public Module {
   double _min;
   double _max;
 
-  int    _num_bins;
-  double _bin_size;
+  HistMode _mode;
+  int      _num_bins;
+  double   _bin_size;
 
   vector<int> _hist;
 
+  int    _LogLinearBin( double val ) const;
+  double _BinValue( int b ) const;
+
 public:
   Stats( Module *parent, const string &name,
-	 double bin_size = 1.0, int num_bins = 10 );
+	 double bin_size = 1.0, int num_bins = 10, HistMode mode = LINEAR );
 
   void Clear( );
 
@@ -58,12 +74,22 @@ public:
   double SquaredSum( ) const;
   int    NumSamples( ) const;
 
+  // value below which fraction p of the samples fall, at the resolution of
+  // the bin holding it and never outside [Min, Max]
+  double Percentile( double p ) const;
+
+  // fold in the samples of another instance with the same binning
+  void Merge( const Stats & other );
+
+  void Serialize( Checkpoint & cp );
+
   void AddSample( double val );
   inline void AddSample( int val ) {
     AddSample( (double)val );
   }
 
   int GetBin(int b){ return _hist[b];}
+  int NumBins( ) const { return _num_bins; }
 
   void Display( ostream & os = cout ) const;
 
@@ -0,0 +1,104 @@
+// $Id$
+
+/*
+ Copyright (c) 2007-2015, Trustees of The Leland Stanford Junior University
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+
+ Redistributions of source code must retain the above copyright notice, this 
+ list of conditions and the following disclaimer.
+ Redistributions in binary form must reproduce the above copyright notice, this
+ list of conditions and the following disclaimer in the documentation and/or
+ other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*booksim_sweep.cpp
+ *
+ *Latency/throughput sweep in a single process: parses the configuration
+ *once and simulates all injection rates concurrently, then prints the
+ *print_csv_results rows of every stable point in the order of the rates
+ *
+ *usage: booksim2_sweep [-j threads] configfile [field=value...] rate...
+ */
+
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "booksim.hpp"
+#include "booksim_config.hpp"
+#include "load_sweep.hpp"
+
+static void Usage( char const * program )
+{
+  cerr << "Usage: " << program
+       << " [-j threads] configfile [field=value...] rate..." << endl;
+  exit( -1 );
+}
+
+int main( int argc, char **argv )
+{
+  int threads = thread::hardware_concurrency( );
+  string config_file;
+  string overrides;
+  vector<double> rates;
+  for ( int i = 1; i < argc; ++i ) {
+    char * end;
+    double const rate = strtod( argv[i], &end );
+    if ( !strcmp( argv[i], "-j" ) && ( i + 1 < argc ) ) {
+      threads = atoi( argv[++i] );
+    } else if ( argv[i][0] == '-' ) {
+      Usage( argv[0] );
+    } else if ( strchr( argv[i], '=' ) ) {
+      overrides += string( argv[i] ) + ';';
+    } else if ( *argv[i] && !*end ) {
+      rates.push_back( rate );
+    } else if ( config_file.empty( ) ) {
+      config_file = argv[i];
+    } else {
+      Usage( argv[0] );
+    }
+  }
+  if ( config_file.empty( ) || rates.empty( ) ) {
+    Usage( argv[0] );
+  }
+  if ( threads < 1 ) {
+    threads = 1;
+  }
+
+  BookSimConfig config;
+  ReadSettingsFile( &config, config_file );
+  AssignSettings( &config, overrides );
+
+  vector<LoadSweepPoint> const points = RunLoadSweep( config, rates, threads );
+
+  bool all_stable = true;
+  for ( size_t p = 0; p < points.size( ); ++p ) {
+    if ( points[p].stable ) {
+      cout << points[p].csv;
+    } else {
+      cerr << "injection_rate " << points[p].injection_rate
+	   << ": simulation unstable" << endl;
+      all_stable = false;
+    }
+  }
+  cout.flush( );
+  return all_stable ? 0 : 1;
+}
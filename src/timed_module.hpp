@@ -28,17 +28,62 @@
 #ifndef _TIMED_MODULE_HPP_
 #define _TIMED_MODULE_HPP_
 
+#include <atomic>
+
 #include "module.hpp"
 
 class TimedModule : public Module {
 
+  // activity-driven evaluation: the module that steps us (if any), our
+  // position in its evaluation order, the shard of its modules we belong to,
+  // whether we are currently listed, and whether we have been woken up since
+  // the scheduler last looked at us (the latter may be set concurrently by
+  // modules in other shards)
+  TimedModule * _scheduler;
+  int _schedule_slot;
+  int _schedule_shard;
+  bool _scheduled;
+  atomic<bool> _woken;
+
 public:
-  TimedModule(Module * parent, string const & name) : Module(parent, name) {}
+  TimedModule(Module * parent, string const & name)
+    : Module(parent, name), _scheduler(0), _schedule_slot(-1),
+      _schedule_shard(0), _scheduled(false), _woken(false) {}
   virtual ~TimedModule() {}
   
-  virtual void ReadInputs() = 0;
-  virtual void Evaluate() = 0;
-  virtual void WriteOutputs() = 0;
+  // each cycle is stepped as ReadInputs, Evaluate and WriteOutputs, all of
+  // which are handed the cycle being simulated
+  virtual void ReadInputs(int time) = 0;
+  virtual void Evaluate(int time) = 0;
+  virtual void WriteOutputs(int time) = 0;
+
+  // Returns true if stepping the module would not change its state until 
+  // new inputs arrive; modules that cannot tell must never claim to be idle.
+  virtual bool Idle() const { return false; }
+
+  inline void SetScheduler(TimedModule * scheduler, int slot, int shard = 0) {
+    _scheduler = scheduler;
+    _schedule_slot = slot;
+    _schedule_shard = shard;
+  }
+  inline int GetScheduleSlot() const { return _schedule_slot; }
+  inline int GetScheduleShard() const { return _schedule_shard; }
+  inline bool IsScheduled() const { return _scheduled; }
+  inline void SetScheduled(bool scheduled) { _scheduled = scheduled; }
+  inline bool IsWoken() const { return _woken.load(memory_order_relaxed); }
+  inline void ClearWoken() { _woken.store(false, memory_order_relaxed); }
+
+  // ask our scheduler to (keep) stepping us; racing wakeups from different
+  // threads may both get through, which the scheduler has to tolerate
+  inline void Wake() {
+    if(_scheduler && !_woken.load(memory_order_relaxed)) {
+      _woken.store(true, memory_order_relaxed);
+      _scheduler->_Schedule(this);
+    }
+  }
+
+protected:
+  virtual void _Schedule(TimedModule * module) {}
 };
 
 #endif
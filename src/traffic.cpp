@@ -30,12 +30,13 @@
 #include <ctime>
 #include "random_utils.hpp"
 #include "traffic.hpp"
+#include "globals.hpp"
 
 TrafficPattern::TrafficPattern(int nodes)
 : _nodes(nodes)
 {
   if(nodes <= 0) {
-    cout << "Error: Traffic patterns require at least one node." << endl;
+    cerr << "Error: Traffic patterns require at least one node." << endl;
     exit(-1);
   }
 }
@@ -79,12 +80,12 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
       if(config) {
 	if(config->GetStr("perm_seed") == "time") {
 	  perm_seed = int(time(NULL));
-	  cout << "SEED: perm_seed=" << perm_seed << endl;
+	  *gProgressOut << "SEED: perm_seed=" << perm_seed << endl;
 	} else {
 	  perm_seed = config->GetInt("perm_seed");
 	}
       } else {
-	cout << "Error: Missing parameter for random permutation traffic pattern: " << pattern << endl;
+	cerr << "Error: Missing parameter for random permutation traffic pattern: " << pattern << endl;
 	exit(-1);
       }
     } else {
@@ -125,7 +126,7 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
       n = atoi(params[1].c_str());
     }
     if(missing_params) {
-      cout << "Error: Missing parameters for dragonfly bad permutation traffic pattern: " << pattern << endl;
+      cerr << "Error: Missing parameters for dragonfly bad permutation traffic pattern: " << pattern << endl;
       exit(-1);
     }
     result = new BadPermDFlyTrafficPattern(nodes, k, n);
@@ -163,7 +164,7 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
       xr = atoi(params[2].c_str());
     }
     if(missing_params) {
-      cout << "Error: Missing parameters for digit permutation traffic pattern: " << pattern << endl;
+      cerr << "Error: Missing parameters for digit permutation traffic pattern: " << pattern << endl;
       exit(-1);
     }
     if(pattern_name == "tornado") {
@@ -192,7 +193,7 @@ TrafficPattern * TrafficPattern::New(string const & pattern, int nodes,
     }
     result = new HotSpotTrafficPattern(nodes, hotspots, rates);
   } else {
-    cout << "Error: Unknown traffic pattern: " << pattern << endl;
+    cerr << "Error: Unknown traffic pattern: " << pattern << endl;
     exit(-1);
   }
   return result;
@@ -208,7 +209,7 @@ BitPermutationTrafficPattern::BitPermutationTrafficPattern(int nodes)
   : PermutationTrafficPattern(nodes)
 {
   if((nodes & -nodes) != nodes) {
-    cout << "Error: Bit permutation traffic patterns require the number of "
+    cerr << "Error: Bit permutation traffic patterns require the number of "
 	 << "nodes to be a power of two." << endl;
     exit(-1);
   }
@@ -234,7 +235,7 @@ TransposeTrafficPattern::TransposeTrafficPattern(int nodes)
     ++_shift;
   }
   if(_shift % 2) {
-    cout << "Error: Transpose traffic pattern requires the number of nodes to "
+    cerr << "Error: Transpose traffic pattern requires the number of nodes to "
 	 << "be an even power of two." << endl;
     exit(-1);
   }
@@ -441,7 +442,7 @@ Taper64TrafficPattern::Taper64TrafficPattern(int nodes)
   : RandomTrafficPattern(nodes)
 {
   if(nodes != 64) {
-    cout << "Error: Tthe Taper64 traffic pattern requires the number of nodes "
+    cerr << "Error: Tthe Taper64 traffic pattern requires the number of nodes "
 	 << "to be exactly 64." << endl;
     exit(-1);
   }
@@ -31,6 +31,8 @@
 #include <limits>
 #include <cstdlib>
 #include <ctime>
+#include <algorithm>
+#include <mutex>
 
 #include "booksim.hpp"
 #include "booksim_config.hpp"
@@ -40,6 +42,33 @@
 #include "vc.hpp"
 #include "packet_reply_info.hpp"
 
+// Flits and credits come from process-wide pools, which may only be reset
+// once no traffic manager is left that could still hold any of them.
+static mutex gLiveManagersMutex;
+static int gLiveManagers = 0;
+
+// slots of the timing wheel of sources that skip ahead; sources whose next
+// packet is further out stay in their slot for another round
+static int const INJECT_WHEEL_SLOTS = 1024;
+
+// Steps one phase of a subnet; lets the worker pool hand out whole subnets.
+class SubnetPhaseTask : public WorkerPool::Task {
+    vector<Network *> const & _net;
+    bool const _evaluate;
+    int const _time;
+public:
+    SubnetPhaseTask(vector<Network *> const & net, bool evaluate, int time)
+        : _net(net), _evaluate(evaluate), _time(time) {}
+    virtual void Run(int subnet) {
+        if(_evaluate) {
+            _net[subnet]->Evaluate( _time );
+            _net[subnet]->WriteOutputs( _time );
+        } else {
+            _net[subnet]->ReadInputs( _time );
+        }
+    }
+};
+
 TrafficManager * TrafficManager::New(Configuration const & config,
                                      vector<Network *> const & net)
 {
@@ -58,6 +87,12 @@ TrafficManager * TrafficManager::New(Configuration const & config,
 TrafficManager::TrafficManager( const Configuration &config, const vector<Network *> & net )
     : Module( 0, "traffic_manager" ), _net(net), _empty_network(false), _deadlock_timer(0), _reset_time(0), _drain_time(-1), _cur_id(0), _cur_pid(0), _time(0)
 {
+    {
+        lock_guard<mutex> lock(gLiveManagersMutex);
+        ++gLiveManagers;
+    }
+    _outstanding_credits = 0;
+    Credit::CountOutStanding(&_outstanding_credits);
 
     _nodes = _net[0]->NumNodes( );
     _routers = _net[0]->NumRouters( );
@@ -279,6 +314,17 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
         _partial_packets[s].resize(_classes);
     }
 
+    _skip_ahead.resize(_classes, false);
+    if(config.GetInt("skip_ahead_injection")) {
+        for(int c = 0; c < _classes; ++c) {
+            // replies are injected as requests arrive
+            _skip_ahead[c] = !_use_read_write[c];
+        }
+        if(find(_skip_ahead.begin(), _skip_ahead.end(), true) != _skip_ahead.end()) {
+            _inject_wheel.resize(INJECT_WHEEL_SLOTS);
+        }
+    }
+
     _total_in_flight_flits.resize(_classes);
     _measured_in_flight_flits.resize(_classes);
     _retired_packets.resize(_classes);
@@ -298,15 +344,30 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
         _router[i] = _net[i]->GetRouters();
     }
 
+    int const subnet_threads = min(config.GetInt("subnet_threads"), _subnets);
+    if((subnet_threads > 1) && (config.GetInt("network_threads") > 1)) {
+        Error("subnet_threads and network_threads cannot both be used at once.");
+    }
+    _subnet_workers = (subnet_threads > 1) ? new WorkerPool(subnet_threads) : NULL;
+
     //seed the network
     int seed;
     if(config.GetStr("seed") == "time") {
       seed = int(time(NULL));
-      cout << "SEED: seed=" << seed << endl;
+      *gProgressOut << "SEED: seed=" << seed << endl;
     } else {
       seed = config.GetInt("seed");
     }
     RandomSeed(seed);
+    RandomStreamSeed(seed);
+
+    if(config.GetInt("random_streams")) {
+        for(int n = 0; n < _nodes; ++n) {
+            ostringstream name;
+            name << FullName() << "/node" << n;
+            _node_random_streams.push_back(RandomStream(name.str()));
+        }
+    }
 
     _measure_latency = (config.GetStr("sim_type") == "latency");
 
@@ -354,6 +415,8 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
     _include_queuing = config.GetInt( "include_queuing" );
 
     _print_csv_results = config.GetInt( "print_csv_results" );
+    Stats::HistMode const lat_hist_mode =
+        config.GetInt( "hdr_latency_stats" ) ? Stats::LOG_LINEAR : Stats::LINEAR;
     _deadlock_warn_timeout = config.GetInt( "deadlock_warn_timeout" );
 
     string watch_file = config.GetStr( "watch_file" );
@@ -455,16 +518,19 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
     _overall_min_plat.resize(_classes, 0.0);
     _overall_avg_plat.resize(_classes, 0.0);
     _overall_max_plat.resize(_classes, 0.0);
+    _overall_plat_hist.resize(_classes);
 
     _nlat_stats.resize(_classes);
     _overall_min_nlat.resize(_classes, 0.0);
     _overall_avg_nlat.resize(_classes, 0.0);
     _overall_max_nlat.resize(_classes, 0.0);
+    _overall_nlat_hist.resize(_classes);
 
     _flat_stats.resize(_classes);
     _overall_min_flat.resize(_classes, 0.0);
     _overall_avg_flat.resize(_classes, 0.0);
     _overall_max_flat.resize(_classes, 0.0);
+    _overall_flat_hist.resize(_classes);
 
     _frag_stats.resize(_classes);
     _overall_min_frag.resize(_classes, 0.0);
@@ -515,20 +581,33 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
         ostringstream tmp_name;
 
         tmp_name << "plat_stat_" << c;
-        _plat_stats[c] = new Stats( this, tmp_name.str( ), 1.0, 1000 );
+        _plat_stats[c] = new Stats( this, tmp_name.str( ), 1.0, 1000, lat_hist_mode );
         _stats[tmp_name.str()] = _plat_stats[c];
         tmp_name.str("");
 
         tmp_name << "nlat_stat_" << c;
-        _nlat_stats[c] = new Stats( this, tmp_name.str( ), 1.0, 1000 );
+        _nlat_stats[c] = new Stats( this, tmp_name.str( ), 1.0, 1000, lat_hist_mode );
         _stats[tmp_name.str()] = _nlat_stats[c];
         tmp_name.str("");
 
         tmp_name << "flat_stat_" << c;
-        _flat_stats[c] = new Stats( this, tmp_name.str( ), 1.0, 1000 );
+        _flat_stats[c] = new Stats( this, tmp_name.str( ), 1.0, 1000, lat_hist_mode );
         _stats[tmp_name.str()] = _flat_stats[c];
         tmp_name.str("");
 
+        // latency distributions merged across all simulation runs
+        tmp_name << "overall_plat_stat_" << c;
+        _overall_plat_hist[c] = new Stats( this, tmp_name.str( ), 1.0, 1000, lat_hist_mode );
+        tmp_name.str("");
+
+        tmp_name << "overall_nlat_stat_" << c;
+        _overall_nlat_hist[c] = new Stats( this, tmp_name.str( ), 1.0, 1000, lat_hist_mode );
+        tmp_name.str("");
+
+        tmp_name << "overall_flat_stat_" << c;
+        _overall_flat_hist[c] = new Stats( this, tmp_name.str( ), 1.0, 1000, lat_hist_mode );
+        tmp_name.str("");
+
         tmp_name << "frag_stat_" << c;
         _frag_stats[c] = new Stats( this, tmp_name.str( ), 1.0, 100 );
         _stats[tmp_name.str()] = _frag_stats[c];
@@ -588,6 +667,7 @@ TrafficManager::TrafficManager( const Configuration &config, const vector<Networ
 
 TrafficManager::~TrafficManager( )
 {
+    delete _subnet_workers;
 
     for ( int source = 0; source < _nodes; ++source ) {
         for ( int subnet = 0; subnet < _subnets; ++subnet ) {
@@ -599,6 +679,9 @@ TrafficManager::~TrafficManager( )
         delete _plat_stats[c];
         delete _nlat_stats[c];
         delete _flat_stats[c];
+        delete _overall_plat_hist[c];
+        delete _overall_nlat_hist[c];
+        delete _overall_flat_hist[c];
         delete _frag_stats[c];
         delete _hop_stats[c];
 
@@ -635,8 +718,12 @@ TrafficManager::~TrafficManager( )
 #endif
 
     PacketReplyInfo::FreeAll();
-    Flit::FreeAll();
-    Credit::FreeAll();
+    Credit::CountOutStanding(NULL);
+    lock_guard<mutex> lock(gLiveManagersMutex);
+    if(--gLiveManagers == 0) {
+        Flit::FreeAll();
+        Credit::FreeAll();
+    }
 }
 
 
@@ -683,7 +770,7 @@ void TrafficManager::_RetireFlit( Flit *f, int dest )
         if(f->head) {
             head = f;
         } else {
-            map<int, Flit *>::iterator iter = _retired_packets[f->cl].find(f->pid);
+            IdMap<Flit *>::iterator iter = _retired_packets[f->cl].find(f->pid);
             assert(iter != _retired_packets[f->cl].end());
             head = iter->second;
             _retired_packets[f->cl].erase(iter);
@@ -870,7 +957,7 @@ void TrafficManager::_GeneratePacket( int source, int stype,
         }
     
         if(gTrace){
-            cout<<"New Flit "<<f->src<<endl;
+            *gProgressOut<<"New Flit "<<f->src<<endl;
         }
         f->type = packet_type;
 
@@ -921,11 +1008,19 @@ void TrafficManager::_GeneratePacket( int source, int stype,
 
 void TrafficManager::_Inject(){
 
+    if ( !_inject_wheel.empty() ) {
+        _InjectSkipAhead( );
+        if ( find( _skip_ahead.begin(), _skip_ahead.end(), false ) == _skip_ahead.end() ) {
+            return;
+        }
+    }
+
     for ( int input = 0; input < _nodes; ++input ) {
         for ( int c = 0; c < _classes; ++c ) {
             // Potentially generate packets for any (input,class)
             // that is currently empty
-            if ( _partial_packets[input][c].empty() ) {
+            if ( !_skip_ahead[c] && _partial_packets[input][c].empty() ) {
+                RandomStreamScope random_scope( _NodeRandomStream( input ), _time );
                 bool generated = false;
                 while( !generated && ( _qtime[input][c] <= _time ) ) {
                     int stype = _IssuePacket( input, c );
@@ -951,6 +1046,63 @@ void TrafficManager::_Inject(){
     }
 }
 
+// Sources that skip ahead are only visited when their injection queue runs
+// empty and when their next packet is due, so that the cost of injection
+// is proportional to the number of packets rather than nodes and cycles.
+void TrafficManager::_InjectSkipAhead( )
+{
+    vector<int> due;
+    due.swap(_inject_ready);
+    vector<int> & slot = _inject_wheel[_time % _inject_wheel.size()];
+    for(size_t i = 0; i < slot.size(); ) {
+        int const q = slot[i];
+        if(_qtime[q / _classes][q % _classes] <= _time) {
+            due.push_back(q);
+            slot[i] = slot.back();
+            slot.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    // generate packets in the same order as the per-cycle scan does
+    sort(due.begin(), due.end());
+
+    for(size_t i = 0; i < due.size(); ++i) {
+        int const source = due[i] / _classes;
+        int const c = due[i] % _classes;
+        assert(_partial_packets[source][c].empty());
+        int const time = _qtime[source][c];
+        if(time > _time) {
+            _inject_wheel[time % _inject_wheel.size()].push_back(due[i]);
+            continue;
+        }
+        RandomStreamScope random_scope(_NodeRandomStream(source), _time);
+        ++_requestsOutstanding[source];
+        ++_packet_seq_no[source];
+        _GeneratePacket(source, 1, c, _include_queuing==1 ? time : _time);
+        // the source waits for its next packet once the queue has drained
+        _qtime[source][c] = min(time + 1 + _injection_process[c]->skip(source),
+                                InjectionProcess::NEVER);
+    }
+}
+
+void TrafficManager::_ResetSkipAhead( )
+{
+    for(size_t t = 0; t < _inject_wheel.size(); ++t) {
+        _inject_wheel[t].clear();
+    }
+    _inject_ready.clear();
+    for(int s = 0; s < _nodes; ++s) {
+        RandomStreamScope random_scope(_NodeRandomStream(s), _time);
+        for(int c = 0; c < _classes; ++c) {
+            if(_skip_ahead[c]) {
+                _qtime[s][c] = _injection_process[c]->skip(s);
+                _inject_ready.push_back(s * _classes + c);
+            }
+        }
+    }
+}
+
 void TrafficManager::_Step( )
 {
     bool flits_in_flight = false;
@@ -959,7 +1111,7 @@ void TrafficManager::_Step( )
     }
     if(flits_in_flight && (_deadlock_timer++ >= _deadlock_warn_timeout)){
         _deadlock_timer = 0;
-        cout << "WARNING: Possible network deadlock.\n";
+        *gProgressOut << "WARNING: Possible network deadlock.\n";
     }
 
     vector<map<int, Flit *> > flits(_subnets);
@@ -988,7 +1140,7 @@ void TrafficManager::_Step( )
             Credit * const c = _net[subnet]->ReadCredit( n );
             if ( c ) {
 #ifdef TRACK_FLOWS
-                for(set<int>::const_iterator iter = c->vc.begin(); iter != c->vc.end(); ++iter) {
+                for(VCMask::const_iterator iter = c->vc.begin(); iter != c->vc.end(); ++iter) {
                     int const vc = *iter;
                     assert(!_outstanding_classes[n][subnet][vc].empty());
                     int cl = _outstanding_classes[n][subnet][vc].front();
@@ -1001,8 +1153,8 @@ void TrafficManager::_Step( )
                 c->Free();
             }
         }
-        _net[subnet]->ReadInputs( );
     }
+    _ReadNetworkInputs( );
   
     if ( !_empty_network ) {
         _Inject();
@@ -1012,6 +1164,8 @@ void TrafficManager::_Step( )
 
         for(int n = 0; n < _nodes; ++n) {
 
+            RandomStreamScope random_scope(_NodeRandomStream(n), _time);
+
             Flit * f = NULL;
 
             BufferState * const dest_buf = _buf_states[n][subnet];
@@ -1059,7 +1213,7 @@ void TrafficManager::_Step( )
 	  
                     OutputSet route_set;
                     _rf(NULL, cf, -1, &route_set, true);
-                    set<OutputSet::sSetElement> const & os = route_set.GetSet();
+                    OutputSet const & os = route_set;
                     assert(os.size() == 1);
                     OutputSet::sSetElement const & se = *os.begin();
                     assert(se.output_port == -1);
@@ -1086,7 +1240,7 @@ void TrafficManager::_Step( )
                                        << "Generating lookahead routing info for flit " << cf->id
                                        << " (NOQ)." << endl;
                         }
-                        set<OutputSet::sSetElement> const sl = cf->la_route_set.GetSet();
+                        OutputSet const & sl = cf->la_route_set;
                         assert(sl.size() == 1);
                         int next_output = sl.begin()->output_port;
                         vc_count /= router->NumOutputs();
@@ -1189,6 +1343,9 @@ void TrafficManager::_Step( )
                 _last_class[n][subnet] = c;
 
                 _partial_packets[n][c].pop_front();
+                if(_skip_ahead[c] && _partial_packets[n][c].empty()) {
+                    _inject_ready.push_back(n * _classes + c);
+                }
 
 #ifdef TRACK_FLOWS
                 ++_outstanding_credits[c][subnet][n];
@@ -1262,16 +1419,44 @@ void TrafficManager::_Step( )
             }
         }
         flits[subnet].clear();
-        _net[subnet]->Evaluate( );
-        _net[subnet]->WriteOutputs( );
     }
+    _EvaluateNetworks( );
 
     ++_time;
     assert(_time);
     if(gTrace){
-        cout<<"TIME "<<_time<<endl;
+        *gProgressOut<<"TIME "<<_time<<endl;
+    }
+
+}
+
+// The subnets only share the credit pool (which is thread-safe) and the 
+// random number generator, so they can be stepped concurrently. Draws from
+// the generator are ordered by subnet, which keeps results identical to 
+// those of a serial run (unless the routers draw from streams of their own).
+void TrafficManager::_ReadNetworkInputs( )
+{
+    if(_subnet_workers) {
+        SubnetPhaseTask task(_net, false, _time);
+        _subnet_workers->Run(&task, _subnets);
+    } else {
+        for(int subnet = 0; subnet < _subnets; ++subnet) {
+            _net[subnet]->ReadInputs( _time );
+        }
     }
+}
 
+void TrafficManager::_EvaluateNetworks( )
+{
+    if(_subnet_workers) {
+        SubnetPhaseTask task(_net, true, _time);
+        _subnet_workers->Run(&task, _subnets, _node_random_streams.empty());
+    } else {
+        for(int subnet = 0; subnet < _subnets; ++subnet) {
+            _net[subnet]->Evaluate( _time );
+            _net[subnet]->WriteOutputs( _time );
+        }
+    }
 }
   
 bool TrafficManager::_PacketsOutstanding( ) const
@@ -1281,17 +1466,18 @@ bool TrafficManager::_PacketsOutstanding( ) const
             if ( _measured_in_flight_flits[c].empty() ) {
 	
                 for ( int s = 0; s < _nodes; ++s ) {
-                    if ( !_qdrained[s][c] ) {
+                    // sources that skip ahead know when their next packet is due
+                    if ( _skip_ahead[c] ? ( _qtime[s][c] <= _drain_time ) : !_qdrained[s][c] ) {
 #ifdef DEBUG_DRAIN
-                        cout << "waiting on queue " << s << " class " << c;
-                        cout << ", time = " << _time << " qtime = " << _qtime[s][c] << endl;
+                        *gProgressOut << "waiting on queue " << s << " class " << c;
+                        *gProgressOut << ", time = " << _time << " qtime = " << _qtime[s][c] << endl;
 #endif
                         return true;
                     }
                 }
             } else {
 #ifdef DEBUG_DRAIN
-                cout << "in flight = " << _measured_in_flight_flits[c].size() << endl;
+                *gProgressOut << "in flight = " << _measured_in_flight_flits[c].size() << endl;
 #endif
                 return true;
             }
@@ -1380,36 +1566,38 @@ void TrafficManager::_ComputeStats( const vector<int> & stats, int *sum, int *mi
     }
 }
 
+// lists the lowest IDs in the given table, which is not ordered by ID itself
+static void DisplayIds( ostream & os, IdMap<Flit *> const & flits )
+{
+    vector<int> ids;
+    ids.reserve(flits.size());
+    for(IdMap<Flit *>::const_iterator iter = flits.begin();
+        iter != flits.end();
+        ++iter) {
+        ids.push_back(iter->first);
+    }
+    size_t const shown = min(ids.size(), (size_t)10);
+    partial_sort(ids.begin(), ids.begin() + shown, ids.end());
+    for(size_t i = 0; i < shown; ++i) {
+        os << ids[i] << " ";
+    }
+    if(ids.size() > 10)
+        os << "[...] ";
+    
+    os << "(" << ids.size() << " flits)" << endl;
+}
+
 void TrafficManager::_DisplayRemaining( ostream & os ) const 
 {
     for(int c = 0; c < _classes; ++c) {
 
-        map<int, Flit *>::const_iterator iter;
-        int i;
-
         os << "Class " << c << ":" << endl;
 
         os << "Remaining flits: ";
-        for ( iter = _total_in_flight_flits[c].begin( ), i = 0;
-              ( iter != _total_in_flight_flits[c].end( ) ) && ( i < 10 );
-              iter++, i++ ) {
-            os << iter->first << " ";
-        }
-        if(_total_in_flight_flits[c].size() > 10)
-            os << "[...] ";
-    
-        os << "(" << _total_in_flight_flits[c].size() << " flits)" << endl;
+        DisplayIds(os, _total_in_flight_flits[c]);
     
         os << "Measured flits: ";
-        for ( iter = _measured_in_flight_flits[c].begin( ), i = 0;
-              ( iter != _measured_in_flight_flits[c].end( ) ) && ( i < 10 );
-              iter++, i++ ) {
-            os << iter->first << " ";
-        }
-        if(_measured_in_flight_flits[c].size() > 10)
-            os << "[...] ";
-    
-        os << "(" << _measured_in_flight_flits[c].size() << " flits)" << endl;
+        DisplayIds(os, _measured_in_flight_flits[c]);
     
     }
 }
@@ -1467,7 +1655,7 @@ bool TrafficManager::_SingleSim( )
             double latency = (double)_plat_stats[c]->Sum();
             double count = (double)_plat_stats[c]->NumSamples();
       
-            map<int, Flit *>::const_iterator iter;
+            IdMap<Flit *>::const_iterator iter;
             for(iter = _total_in_flight_flits[c].begin(); 
                 iter != _total_in_flight_flits[c].end(); 
                 iter++) {
@@ -1481,7 +1669,7 @@ bool TrafficManager::_SingleSim( )
                 lat_exc_class = c;
             }
       
-            cout << "latency change    = " << latency_change << endl;
+            *gProgressOut << "latency change    = " << latency_change << endl;
             if(lat_chg_exc_class < 0) {
                 if((_sim_state == warming_up) &&
                    (_warmup_threshold[c] >= 0.0) &&
@@ -1494,7 +1682,7 @@ bool TrafficManager::_SingleSim( )
                 }
             }
       
-            cout << "throughput change = " << accepted_change << endl;
+            *gProgressOut << "throughput change = " << accepted_change << endl;
             if(acc_chg_exc_class < 0) {
                 if((_sim_state == warming_up) &&
                    (_acc_warmup_threshold[c] >= 0.0) &&
@@ -1512,7 +1700,7 @@ bool TrafficManager::_SingleSim( )
         // Fail safe for latency mode, throughput will ust continue
         if ( _measure_latency && ( lat_exc_class >= 0 ) ) {
       
-            cout << "Average latency for class " << lat_exc_class << " exceeded " << _latency_thres[lat_exc_class] << " cycles. Aborting simulation." << endl;
+            *gProgressOut << "Average latency for class " << lat_exc_class << " exceeded " << _latency_thres[lat_exc_class] << " cycles. Aborting simulation." << endl;
             converged = 0; 
             _sim_state = draining;
             _drain_time = _time;
@@ -1528,7 +1716,7 @@ bool TrafficManager::_SingleSim( )
                  ( total_phases + 1 >= _warmup_periods ) :
                  ( ( !_measure_latency || ( lat_chg_exc_class < 0 ) ) &&
                    ( acc_chg_exc_class < 0 ) ) ) {
-                cout << "Warmed up ..." <<  "Time used is " << _time << " cycles" <<endl;
+                *gProgressOut << "Warmed up ..." <<  "Time used is " << _time << " cycles" <<endl;
                 clear_last = true;
                 _sim_state = running;
             }
@@ -1550,7 +1738,7 @@ bool TrafficManager::_SingleSim( )
         _drain_time = _time;
 
         if ( _measure_latency ) {
-            cout << "Draining all recorded packets ..." << endl;
+            *gProgressOut << "Draining all recorded packets ..." << endl;
             int empty_steps = 0;
             while( _PacketsOutstanding( ) ) { 
                 _Step( ); 
@@ -1572,7 +1760,7 @@ bool TrafficManager::_SingleSim( )
                         double acc_latency = _plat_stats[c]->Sum();
                         double acc_count = (double)_plat_stats[c]->NumSamples();
 	    
-                        map<int, Flit *>::const_iterator iter;
+                        IdMap<Flit *>::const_iterator iter;
                         for(iter = _total_in_flight_flits[c].begin(); 
                             iter != _total_in_flight_flits[c].end(); 
                             iter++) {
@@ -1587,7 +1775,7 @@ bool TrafficManager::_SingleSim( )
                     }
 	  
                     if(lat_exc_class >= 0) {
-                        cout << "Average latency for class " << lat_exc_class << " exceeded " << _latency_thres[lat_exc_class] << " cycles. Aborting simulation." << endl;
+                        *gProgressOut << "Average latency for class " << lat_exc_class << " exceeded " << _latency_thres[lat_exc_class] << " cycles. Aborting simulation." << endl;
                         converged = 0; 
                         _sim_state = warming_up;
                         if(_stats_out) {
@@ -1602,7 +1790,7 @@ bool TrafficManager::_SingleSim( )
             }
         }
     } else {
-        cout << "Too many sample periods needed to converge" << endl;
+        *gProgressOut << "Too many sample periods needed to converge" << endl;
     }
   
     return ( converged > 0 );
@@ -1641,14 +1829,17 @@ bool TrafficManager::Run( )
             _traffic_pattern[c]->reset();
             _injection_process[c]->reset();
         }
+        if(!_inject_wheel.empty()) {
+            _ResetSkipAhead( );
+        }
 
         if ( !_SingleSim( ) ) {
-            cout << "Simulation unstable, ending ..." << endl;
+            *gProgressOut << "Simulation unstable, ending ..." << endl;
             return false;
         }
 
         // Empty any remaining packets
-        cout << "Draining remaining packets ..." << endl;
+        *gProgressOut << "Draining remaining packets ..." << endl;
         _empty_network = true;
         int empty_steps = 0;
 
@@ -1672,14 +1863,14 @@ bool TrafficManager::Run( )
             }
         }
         //wait until all the credits are drained as well
-        while(Credit::OutStanding()!=0){
+        while(_outstanding_credits!=0){
             _Step();
         }
         _empty_network = false;
 
         //for the love of god don't ever say "Time taken" anywhere else
         //the power script depend on it
-        cout << "Time taken is " << _time << " cycles" <<endl; 
+        *gProgressOut << "Time taken is " << _time << " cycles" <<endl; 
 
         if(_stats_out) {
             WriteStats(*_stats_out);
@@ -1687,14 +1878,142 @@ bool TrafficManager::Run( )
         _UpdateOverallStats();
     }
   
-    DisplayOverallStats();
+    DisplayOverallStats(*gProgressOut);
     if(_print_csv_results) {
-        DisplayOverallStatsCSV();
+        DisplayOverallStatsCSV(*gProgressOut);
     }
   
     return true;
 }
 
+void TrafficManager::Serialize( Checkpoint & cp )
+{
+    if ( !cp.Saving( ) && ( _time || _cur_id || _cur_pid ) ) {
+        Error( "Checkpoints can only be restored into a new simulation." );
+    }
+
+    cp.Section( FullName( ) );
+    cp.Check( _subnets, "number of subnets" );
+    cp.Check( _nodes, "number of nodes" );
+    cp.Check( _classes, "number of classes" );
+
+    SerializeRandomState( cp );
+    for ( int s = 0; s < _subnets; ++s ) {
+        _net[s]->Serialize( cp );
+    }
+
+    cp.Section( FullName( ) + "/state" );
+    cp.Item( _time );
+    cp.Item( _cur_id );
+    cp.Item( _cur_pid );
+    cp.Item( _sim_state );
+    cp.Item( _reset_time );
+    cp.Item( _drain_time );
+    cp.Item( _total_sims );
+    cp.Item( _deadlock_timer );
+    cp.Item( _empty_network );
+
+    for ( int c = 0; c < _classes; ++c ) {
+        _injection_process[c]->Serialize( cp );
+    }
+    cp.Item( _last_class );
+    cp.Item( _last_vc );
+    cp.Item( _qtime );
+    cp.Item( _qdrained );
+    cp.Item( _partial_packets );
+    cp.Item( _inject_wheel );
+    cp.Item( _inject_ready );
+
+    for ( int n = 0; n < _nodes; ++n ) {
+        for ( int s = 0; s < _subnets; ++s ) {
+            _buf_states[n][s]->Serialize( cp );
+        }
+    }
+#ifdef TRACK_FLOWS
+    cp.Item( _outstanding_classes );
+    cp.Item( _injected_flits );
+    cp.Item( _ejected_flits );
+#endif
+
+    cp.Item( _total_in_flight_flits );
+    cp.Item( _measured_in_flight_flits );
+    cp.Item( _retired_packets );
+
+    cp.Item( _packet_seq_no );
+    cp.Item( _requestsOutstanding );
+    for ( int n = 0; n < _nodes; ++n ) {
+        list<PacketReplyInfo *> & pending = _repliesPending[n];
+        size_t size = pending.size( );
+        cp.Item( size );
+        if ( !cp.Saving( ) ) {
+            for ( size_t i = 0; i < size; ++i ) {
+                pending.push_back( PacketReplyInfo::New( ) );
+            }
+        }
+        for ( list<PacketReplyInfo *>::iterator iter = pending.begin( );
+              iter != pending.end( ); ++iter ) {
+            cp.Item( (*iter)->source );
+            cp.Item( (*iter)->time );
+            cp.Item( (*iter)->record );
+            cp.Item( (*iter)->type );
+        }
+    }
+
+    cp.Section( FullName( ) + "/stats" );
+    for ( map<string, Stats *>::iterator iter = _stats.begin( );
+          iter != _stats.end( ); ++iter ) {
+        iter->second->Serialize( cp );
+    }
+    for ( int c = 0; c < _classes; ++c ) {
+        _overall_plat_hist[c]->Serialize( cp );
+        _overall_nlat_hist[c]->Serialize( cp );
+        _overall_flat_hist[c]->Serialize( cp );
+    }
+    cp.Item( _overall_min_plat );
+    cp.Item( _overall_avg_plat );
+    cp.Item( _overall_max_plat );
+    cp.Item( _overall_min_nlat );
+    cp.Item( _overall_avg_nlat );
+    cp.Item( _overall_max_nlat );
+    cp.Item( _overall_min_flat );
+    cp.Item( _overall_avg_flat );
+    cp.Item( _overall_max_flat );
+    cp.Item( _overall_min_frag );
+    cp.Item( _overall_avg_frag );
+    cp.Item( _overall_max_frag );
+    cp.Item( _overall_hop_stats );
+    cp.Item( _sent_packets );
+    cp.Item( _overall_min_sent_packets );
+    cp.Item( _overall_avg_sent_packets );
+    cp.Item( _overall_max_sent_packets );
+    cp.Item( _accepted_packets );
+    cp.Item( _overall_min_accepted_packets );
+    cp.Item( _overall_avg_accepted_packets );
+    cp.Item( _overall_max_accepted_packets );
+    cp.Item( _sent_flits );
+    cp.Item( _overall_min_sent );
+    cp.Item( _overall_avg_sent );
+    cp.Item( _overall_max_sent );
+    cp.Item( _accepted_flits );
+    cp.Item( _overall_min_accepted );
+    cp.Item( _overall_avg_accepted );
+    cp.Item( _overall_max_accepted );
+#ifdef TRACK_STALLS
+    cp.Item( _buffer_busy_stalls );
+    cp.Item( _buffer_conflict_stalls );
+    cp.Item( _buffer_full_stalls );
+    cp.Item( _buffer_reserved_stalls );
+    cp.Item( _crossbar_conflict_stalls );
+    cp.Item( _overall_buffer_busy_stalls );
+    cp.Item( _overall_buffer_conflict_stalls );
+    cp.Item( _overall_buffer_full_stalls );
+    cp.Item( _overall_buffer_reserved_stalls );
+    cp.Item( _overall_crossbar_conflict_stalls );
+#endif
+    cp.Item( _slowest_packet );
+    cp.Item( _slowest_flit );
+}
+
 void TrafficManager::_UpdateOverallStats() {
     for ( int c = 0; c < _classes; ++c ) {
     
@@ -1711,6 +2030,9 @@ void TrafficManager::_UpdateOverallStats() {
         _overall_min_flat[c] += _flat_stats[c]->Min();
         _overall_avg_flat[c] += _flat_stats[c]->Average();
         _overall_max_flat[c] += _flat_stats[c]->Max();
+        _overall_plat_hist[c]->Merge( *_plat_stats[c] );
+        _overall_nlat_hist[c]->Merge( *_nlat_stats[c] );
+        _overall_flat_hist[c]->Merge( *_flat_stats[c] );
     
         _overall_min_frag[c] += _frag_stats[c]->Min();
         _overall_avg_frag[c] += _frag_stats[c]->Average();
@@ -1978,19 +2300,28 @@ void TrafficManager::DisplayStats(ostream & os) const {
             continue;
         }
     
-        cout << "Class " << c << ":" << endl;
+        *gProgressOut << "Class " << c << ":" << endl;
     
-        cout 
+        *gProgressOut 
             << "Packet latency average = " << _plat_stats[c]->Average() << endl
             << "\tminimum = " << _plat_stats[c]->Min() << endl
             << "\tmaximum = " << _plat_stats[c]->Max() << endl
+            << "\tp50 = " << _plat_stats[c]->Percentile(0.5) << endl
+            << "\tp99 = " << _plat_stats[c]->Percentile(0.99) << endl
+            << "\tp99.9 = " << _plat_stats[c]->Percentile(0.999) << endl
             << "Network latency average = " << _nlat_stats[c]->Average() << endl
             << "\tminimum = " << _nlat_stats[c]->Min() << endl
             << "\tmaximum = " << _nlat_stats[c]->Max() << endl
+            << "\tp50 = " << _nlat_stats[c]->Percentile(0.5) << endl
+            << "\tp99 = " << _nlat_stats[c]->Percentile(0.99) << endl
+            << "\tp99.9 = " << _nlat_stats[c]->Percentile(0.999) << endl
             << "Slowest packet = " << _slowest_packet[c] << endl
             << "Flit latency average = " << _flat_stats[c]->Average() << endl
             << "\tminimum = " << _flat_stats[c]->Min() << endl
             << "\tmaximum = " << _flat_stats[c]->Max() << endl
+            << "\tp50 = " << _flat_stats[c]->Percentile(0.5) << endl
+            << "\tp99 = " << _flat_stats[c]->Percentile(0.99) << endl
+            << "\tp99.9 = " << _flat_stats[c]->Percentile(0.999) << endl
             << "Slowest flit = " << _slowest_flit[c] << endl
             << "Fragmentation average = " << _frag_stats[c]->Average() << endl
             << "\tminimum = " << _frag_stats[c]->Min() << endl
@@ -2008,7 +2339,7 @@ void TrafficManager::DisplayStats(ostream & os) const {
         rate_max = (double)count_max / time_delta;
         rate_avg = rate_sum / (double)_nodes;
         sent_packets = count_sum;
-        cout << "Injected packet rate average = " << rate_avg << endl
+        *gProgressOut << "Injected packet rate average = " << rate_avg << endl
              << "\tminimum = " << rate_min 
              << " (at node " << min_pos << ")" << endl
              << "\tmaximum = " << rate_max
@@ -2019,7 +2350,7 @@ void TrafficManager::DisplayStats(ostream & os) const {
         rate_max = (double)count_max / time_delta;
         rate_avg = rate_sum / (double)_nodes;
         accepted_packets = count_sum;
-        cout << "Accepted packet rate average = " << rate_avg << endl
+        *gProgressOut << "Accepted packet rate average = " << rate_avg << endl
              << "\tminimum = " << rate_min 
              << " (at node " << min_pos << ")" << endl
              << "\tmaximum = " << rate_max
@@ -2030,7 +2361,7 @@ void TrafficManager::DisplayStats(ostream & os) const {
         rate_max = (double)count_max / time_delta;
         rate_avg = rate_sum / (double)_nodes;
         sent_flits = count_sum;
-        cout << "Injected flit rate average = " << rate_avg << endl
+        *gProgressOut << "Injected flit rate average = " << rate_avg << endl
              << "\tminimum = " << rate_min 
              << " (at node " << min_pos << ")" << endl
              << "\tmaximum = " << rate_max
@@ -2041,16 +2372,16 @@ void TrafficManager::DisplayStats(ostream & os) const {
         rate_max = (double)count_max / time_delta;
         rate_avg = rate_sum / (double)_nodes;
         accepted_flits = count_sum;
-        cout << "Accepted flit rate average= " << rate_avg << endl
+        *gProgressOut << "Accepted flit rate average= " << rate_avg << endl
              << "\tminimum = " << rate_min 
              << " (at node " << min_pos << ")" << endl
              << "\tmaximum = " << rate_max
              << " (at node " << max_pos << ")" << endl;
     
-        cout << "Injected packet length average = " << (double)sent_flits / (double)sent_packets << endl
+        *gProgressOut << "Injected packet length average = " << (double)sent_flits / (double)sent_packets << endl
              << "Accepted packet length average = " << (double)accepted_flits / (double)accepted_packets << endl;
 
-        cout << "Total in-flight flits = " << _total_in_flight_flits[c].size()
+        *gProgressOut << "Total in-flight flits = " << _total_in_flight_flits[c].size()
              << " (" << _measured_in_flight_flits[c].size() << " measured)"
              << endl;
     
@@ -2097,6 +2428,9 @@ void TrafficManager::DisplayOverallStats( ostream & os ) const {
            << " (" << _total_sims << " samples)" << endl;
         os << "\tmaximum = " << _overall_max_plat[c] / (double)_total_sims
            << " (" << _total_sims << " samples)" << endl;
+        os << "\tp50 = " << _overall_plat_hist[c]->Percentile(0.5) << endl;
+        os << "\tp99 = " << _overall_plat_hist[c]->Percentile(0.99) << endl;
+        os << "\tp99.9 = " << _overall_plat_hist[c]->Percentile(0.999) << endl;
 
         os << "Network latency average = " << _overall_avg_nlat[c] / (double)_total_sims
            << " (" << _total_sims << " samples)" << endl;
@@ -2104,6 +2438,9 @@ void TrafficManager::DisplayOverallStats( ostream & os ) const {
            << " (" << _total_sims << " samples)" << endl;
         os << "\tmaximum = " << _overall_max_nlat[c] / (double)_total_sims
            << " (" << _total_sims << " samples)" << endl;
+        os << "\tp50 = " << _overall_nlat_hist[c]->Percentile(0.5) << endl;
+        os << "\tp99 = " << _overall_nlat_hist[c]->Percentile(0.99) << endl;
+        os << "\tp99.9 = " << _overall_nlat_hist[c]->Percentile(0.999) << endl;
 
         os << "Flit latency average = " << _overall_avg_flat[c] / (double)_total_sims
            << " (" << _total_sims << " samples)" << endl;
@@ -2111,6 +2448,9 @@ void TrafficManager::DisplayOverallStats( ostream & os ) const {
            << " (" << _total_sims << " samples)" << endl;
         os << "\tmaximum = " << _overall_max_flat[c] / (double)_total_sims
            << " (" << _total_sims << " samples)" << endl;
+        os << "\tp50 = " << _overall_flat_hist[c]->Percentile(0.5) << endl;
+        os << "\tp99 = " << _overall_flat_hist[c]->Percentile(0.99) << endl;
+        os << "\tp99.9 = " << _overall_flat_hist[c]->Percentile(0.999) << endl;
 
         os << "Fragmentation average = " << _overall_avg_frag[c] / (double)_total_sims
            << " (" << _total_sims << " samples)" << endl;
@@ -2205,7 +2545,16 @@ string TrafficManager::_OverallStatsCSV(int c) const
        << ',' << _overall_max_accepted[c] / (double)_total_sims
        << ',' << _overall_avg_sent[c] / _overall_avg_sent_packets[c]
        << ',' << _overall_avg_accepted[c] / _overall_avg_accepted_packets[c]
-       << ',' << _overall_hop_stats[c] / (double)_total_sims;
+       << ',' << _overall_hop_stats[c] / (double)_total_sims
+       << ',' << _overall_plat_hist[c]->Percentile(0.5)
+       << ',' << _overall_plat_hist[c]->Percentile(0.99)
+       << ',' << _overall_plat_hist[c]->Percentile(0.999)
+       << ',' << _overall_nlat_hist[c]->Percentile(0.5)
+       << ',' << _overall_nlat_hist[c]->Percentile(0.99)
+       << ',' << _overall_nlat_hist[c]->Percentile(0.999)
+       << ',' << _overall_flat_hist[c]->Percentile(0.5)
+       << ',' << _overall_flat_hist[c]->Percentile(0.99)
+       << ',' << _overall_flat_hist[c]->Percentile(0.999);
 
 #ifdef TRACK_STALLS
     os << ',' << (double)_overall_buffer_busy_stalls[c] / (double)_total_sims
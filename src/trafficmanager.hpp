@@ -32,6 +32,7 @@
 #include <map>
 #include <set>
 #include <cassert>
+#include <atomic>
 
 #include "module.hpp"
 #include "config_utils.hpp"
@@ -43,6 +44,10 @@
 #include "routefunc.hpp"
 #include "outputset.hpp"
 #include "injection.hpp"
+#include "worker_pool.hpp"
+#include "id_map.hpp"
+#include "checkpoint.hpp"
+#include "random_utils.hpp"
 
 //register the requests to a node
 class PacketReplyInfo;
@@ -113,11 +118,32 @@ protected:
   vector<vector<bool> > _qdrained;
   vector<vector<list<Flit *> > > _partial_packets;
 
-  vector<map<int, Flit *> > _total_in_flight_flits;
-  vector<map<int, Flit *> > _measured_in_flight_flits;
-  vector<map<int, Flit *> > _retired_packets;
+  // classes whose sources sample the time of their next packet up front
+  // instead of testing the injection process every cycle; for those, 
+  // _qtime holds the time of the next packet
+  vector<bool> _skip_ahead;
+  // such sources wait for their next packet in the slot of its time, and
+  // join the ready list once their injection queue runs empty (entries are
+  // source * _classes + class)
+  vector<vector<int> > _inject_wheel;
+  vector<int> _inject_ready;
+
+  // per-node random streams used while injecting (empty if random numbers
+  // come from the global generator)
+  vector<RandomStream> _node_random_streams;
+  inline RandomStream * _NodeRandomStream( int node ) {
+    return _node_random_streams.empty() ? NULL : &_node_random_streams[node];
+  }
+
+  vector<IdMap<Flit *> > _total_in_flight_flits;
+  vector<IdMap<Flit *> > _measured_in_flight_flits;
+  vector<IdMap<Flit *> > _retired_packets;
   bool _empty_network;
 
+  // credits of this simulation; the credit pool may be shared with
+  // simulations on other threads
+  atomic<int> _outstanding_credits;
+
   bool _hold_switch_for_packet;
 
   // ============ physical sub-networks ==========
@@ -126,6 +152,9 @@ protected:
 
   vector<int> _subnet;
 
+  // evaluates the subnets concurrently (NULL if they are stepped serially)
+  WorkerPool * _subnet_workers;
+
   // ============ deadlock ==========
 
   int _deadlock_timer;
@@ -143,16 +172,19 @@ protected:
   vector<double> _overall_min_plat;  
   vector<double> _overall_avg_plat;  
   vector<double> _overall_max_plat;  
+  vector<Stats *> _overall_plat_hist;
 
   vector<Stats *> _nlat_stats;     
   vector<double> _overall_min_nlat;  
   vector<double> _overall_avg_nlat;  
   vector<double> _overall_max_nlat;  
+  vector<Stats *> _overall_nlat_hist;
 
   vector<Stats *> _flat_stats;     
   vector<double> _overall_min_flat;  
   vector<double> _overall_avg_flat;  
   vector<double> _overall_max_flat;  
+  vector<Stats *> _overall_flat_hist;
 
   vector<Stats *> _frag_stats;
   vector<double> _overall_min_frag;
@@ -265,8 +297,13 @@ protected:
   virtual void _RetireFlit( Flit *f, int dest );
 
   void _Inject();
+  void _InjectSkipAhead( );
+  void _ResetSkipAhead( );
   void _Step( );
 
+  void _ReadNetworkInputs( );
+  void _EvaluateNetworks( );
+
   bool _PacketsOutstanding( ) const;
   
   virtual int  _IssuePacket( int source, int cl );
@@ -299,6 +336,12 @@ public:
 
   bool Run( );
 
+  // Save or restore the state of the simulation (traffic manager, networks
+  // and random number generator) in between two cycles. A checkpoint can 
+  // only be restored into a newly constructed traffic manager with the 
+  // same configuration.
+  virtual void Serialize( Checkpoint & cp );
+
   virtual void WriteStats( ostream & os = cout ) const ;
   virtual void UpdateStats( ) ;
   virtual void DisplayStats( ostream & os = cout ) const ;
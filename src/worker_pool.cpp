@@ -0,0 +1,168 @@
+/*****************************************************
+ * Worker Pool for Parallel Network Evaluation
+ *****************************************************
+ * Overview
+ *   - Workers spin for a short while waiting for the next job before
+ *     they fall asleep on a condition variable, so that back-to-back
+ *     phases of the same cycle do not pay for a kernel round trip,
+ *     while a host simulator that stops stepping does not keep the
+ *     cores busy.
+ */
+
+#include <cassert>
+
+#include "worker_pool.hpp"
+#include "random_utils.hpp"
+#include "simulation_globals.hpp"
+
+// pool thread we are (0 outside of jobs) and the shard being processed by
+// it (-1 outside of ordered jobs)
+static thread_local int tThread = 0;
+static thread_local int tOrderedShard = -1;
+// pool whose ordered job the calling thread takes part in (a simulation has
+// at most one in progress at any time)
+static thread_local WorkerPool * tOrderedPool = NULL;
+
+static int const SPIN_ITERATIONS = 1 << 14;
+
+WorkerPool::WorkerPool( int threads )
+  : _threads( threads ), _task( NULL ), _shards( 0 ), _ordered( false ),
+    _generation( 0 ), _pending( 0 ), _turn( 0 ), _sleepers( 0 ),
+    _shutdown( false )
+{
+  assert( _threads >= 1 );
+  for ( int t = 1; t < _threads; ++t ) {
+    _workers.push_back( thread( &WorkerPool::_WorkerLoop, this, t ) );
+  }
+}
+
+WorkerPool::~WorkerPool( )
+{
+  _shutdown = true;
+  {
+    lock_guard<mutex> lock( _mutex );
+    ++_generation;
+  }
+  _wakeup.notify_all( );
+  for ( size_t t = 0; t < _workers.size( ); ++t ) {
+    _workers[t].join( );
+  }
+}
+
+void WorkerPool::Run( Task * task, int shards, bool ordered )
+{
+  assert( task );
+  if ( ( _threads == 1 ) || ( shards <= 1 ) ) {
+    for ( int s = 0; s < shards; ++s ) {
+      task->Run( s );
+    }
+    return;
+  }
+
+  _task    = task;
+  _shards  = shards;
+  _ordered = ordered;
+  _turn    = 0;
+  // the workers step our simulation, so they use our globals
+  SimulationGlobals::Capture( _globals );
+  if ( _ordered ) {
+    assert( !tOrderedPool );
+    tOrderedPool = this;
+    gRandomOrderHook = &WorkerPool::_WaitForRandomTurn;
+  }
+  _pending = _threads - 1;
+
+  // release the workers; the sleeper check pairs with the one in
+  // _WaitForJob so that no wakeup can get lost
+  ++_generation;
+  if ( _sleepers > 0 ) {
+    lock_guard<mutex> lock( _mutex );
+    _wakeup.notify_all( );
+  }
+
+  _RunShards( 0 );
+
+  while ( _pending > 0 ) {
+    this_thread::yield( );
+  }
+
+  if ( _ordered ) {
+    gRandomOrderHook = NULL;
+    tOrderedPool = NULL;
+  }
+  _task = NULL;
+}
+
+int WorkerPool::CurrentThread( )
+{
+  return tThread;
+}
+
+void WorkerPool::_WorkerLoop( int thread_id )
+{
+  tThread = thread_id;
+  unsigned generation = 0;
+  while ( true ) {
+    _WaitForJob( generation );
+    generation = _generation;
+    if ( _shutdown ) {
+      return;
+    }
+    SimulationGlobals::Install( _globals );
+    if ( _ordered ) {
+      tOrderedPool = this;
+      gRandomOrderHook = &WorkerPool::_WaitForRandomTurn;
+    }
+    _RunShards( thread_id );
+    gRandomOrderHook = NULL;
+    tOrderedPool = NULL;
+    --_pending;
+  }
+}
+
+void WorkerPool::_WaitForJob( unsigned generation )
+{
+  for ( int i = 0; i < SPIN_ITERATIONS; ++i ) {
+    if ( _generation != generation ) {
+      return;
+    }
+  }
+  unique_lock<mutex> lock( _mutex );
+  ++_sleepers;
+  while ( _generation == generation ) {
+    _wakeup.wait( lock );
+  }
+  --_sleepers;
+}
+
+void WorkerPool::_RunShards( int thread_id )
+{
+  for ( int s = thread_id; s < _shards; s += _threads ) {
+    if ( _ordered ) {
+      tOrderedShard = s;
+    }
+    _task->Run( s );
+    if ( _ordered ) {
+      // hand the random number generator over to the next shard only once
+      // all shards before us are done as well
+      while ( _turn != s ) {
+	this_thread::yield( );
+      }
+      _turn = s + 1;
+      tOrderedShard = -1;
+    }
+  }
+}
+
+void WorkerPool::_WaitForRandomTurn( )
+{
+  int const shard = tOrderedShard;
+  if ( shard < 0 ) {
+    return;
+  }
+  WorkerPool * const pool = tOrderedPool;
+  assert( pool );
+  while ( pool->_turn != shard ) {
+    this_thread::yield( );
+  }
+}
@@ -0,0 +1,83 @@
+/*****************************************************
+ * Worker Pool for Parallel Network Evaluation
+ *****************************************************
+ * Overview
+ *   - A fixed set of persistent threads that evaluate independent
+ *     shards of work (e.g. subnets) of a single simulation phase.
+ *     The calling thread takes part as thread 0, and Run returns
+ *     only once every shard is done, i.e. each call is a barrier.
+ *   - Shard s is always processed by thread (s % threads), and each
+ *     thread processes its shards in increasing order.
+ *   - In ordered mode, random numbers drawn while processing shard s
+ *     are handed out only after all shards below s are done, which
+ *     reproduces the draw sequence of a serial sweep over the shards.
+ *   - Workers adopt the caller's simulation globals for each job (see
+ *     SimulationGlobals), so one pool only ever serves one simulation
+ *     at a time.
+ *
+ * API Description
+ *   - Run:                 process shards [0, shards) of the given task
+ *   - NumThreads:          number of threads including the caller
+ *   - CurrentThread:       index of the calling thread within the pool
+ *                          whose job it is running (0 outside of jobs)
+ */
+
+#ifndef _WORKER_POOL_HPP_
+#define _WORKER_POOL_HPP_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "booksim.hpp"
+
+class WorkerPool {
+
+public:
+
+  class Task {
+  public:
+    virtual ~Task( ) { }
+    virtual void Run( int shard ) = 0;
+  };
+
+  WorkerPool( int threads );
+  ~WorkerPool( );
+
+  void Run( Task * task, int shards, bool ordered = false );
+
+  inline int NumThreads( ) const { return _threads; }
+
+  static int CurrentThread( );
+
+private:
+
+  int _threads;
+  vector<thread> _workers;
+
+  // current job
+  Task * _task;
+  int    _shards;
+  bool   _ordered;
+  vector<char> _globals;
+
+  atomic<unsigned> _generation;
+  atomic<int>      _pending;
+  atomic<int>      _turn;
+  atomic<int>      _sleepers;
+  atomic<bool>     _shutdown;
+
+  mutex              _mutex;
+  condition_variable _wakeup;
+
+  void _WorkerLoop( int thread_id );
+  void _RunShards( int thread_id );
+  void _WaitForJob( unsigned generation );
+
+  static void _WaitForRandomTurn( );
+
+};
+
+#endif